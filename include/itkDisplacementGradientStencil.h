@@ -0,0 +1,297 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkDisplacementGradientStencil_h
+#define itkDisplacementGradientStencil_h
+
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+#include "itkStrainUnroll.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Central difference of the given order of accuracy along an axis of
+ * spacing h: du/dx = Scale / h * sum_m Ratios[m - 1] * (u[x + m] - u[x - m])
+ * for m in [1, Radius]. */
+template <unsigned int VOrder>
+struct CentralDifferenceCoefficients;
+
+template <>
+struct CentralDifferenceCoefficients<2>
+{
+  static constexpr unsigned int Radius = 1;
+  static constexpr double       Scale = 0.5;
+  static constexpr double       Ratios[Radius] = { 1.0 };
+};
+
+template <>
+struct CentralDifferenceCoefficients<4>
+{
+  static constexpr unsigned int Radius = 2;
+  static constexpr double       Scale = 2.0 / 3.0;
+  static constexpr double       Ratios[Radius] = { 1.0, -1.0 / 8.0 };
+};
+
+template <>
+struct CentralDifferenceCoefficients<6>
+{
+  static constexpr unsigned int Radius = 3;
+  static constexpr double       Scale = 3.0 / 4.0;
+  static constexpr double       Ratios[Radius] = { 1.0, -1.0 / 5.0, 1.0 / 45.0 };
+};
+} // end namespace StrainDetail
+
+/** \class DisplacementGradientStencil
+ *
+ * \brief Central difference displacement gradients of the scanlines of a
+ * displacement field image.
+ *
+ * The displacements are read directly from the buffer of the image, either
+ * the Vector pixels of an Image or the pixels of a VectorImage with
+ * ImageDimension components, so that a VectorImage that views an external
+ * array is not copied first.  With
+ * the default second order of accuracy, the result matches
+ * itk::GradientImageFilter applied to each displacement component: the image
+ * spacing and direction are taken into account, and neighbors outside of the
+ * buffered region are replaced by the nearest pixel of the region, i.e. a
+ * zero flux Neumann boundary condition is applied.  The fourth and sixth
+ * order stencils read 2 and 3 neighbors on each side, with the same boundary
+ * condition.
+ *
+ * The taps are unrolled at compile time.  Each scanline is split into the
+ * interior pixels, whose neighbors along the scanline are all buffered, and
+ * the pixels near its ends, so that only the latter clamp their neighbors.
+ *
+ * The image must not be modified while the stencil is used.  ComputeLine() is
+ * const and can be called concurrently.
+ *
+ * \tparam TDisplacementFieldImage An Image of displacement Vectors, or a
+ * VectorImage with ImageDimension components.
+ *
+ * \tparam TOperatorValueType The value type of the differences.
+ *
+ * \tparam VOrder The order of accuracy of the central differences: 2, 4, or
+ * 6.
+ *
+ * \sa StrainImageFilter
+ * \sa TransformToStrainFilter
+ *
+ * \ingroup Strain
+ */
+template <typename TDisplacementFieldImage, typename TOperatorValueType, unsigned int VOrder = 2>
+class DisplacementGradientStencil
+{
+public:
+  static constexpr unsigned int ImageDimension = TDisplacementFieldImage::ImageDimension;
+
+  using CoefficientsType = StrainDetail::CentralDifferenceCoefficients<VOrder>;
+
+  /** Number of neighbors read on each side of a pixel along each axis. */
+  static constexpr unsigned int Radius = CoefficientsType::Radius;
+
+  using DisplacementFieldImageType = TDisplacementFieldImage;
+  using PixelType = typename DisplacementFieldImageType::PixelType;
+  using ValueType = typename NumericTraits<PixelType>::ValueType;
+  using IndexType = typename DisplacementFieldImageType::IndexType;
+
+  explicit DisplacementGradientStencil(const DisplacementFieldImageType * displacementField)
+    : m_Buffer(reinterpret_cast<const ValueType *>(displacementField->GetBufferPointer()))
+  {
+    // The strides between neighbors, in values, with ImageDimension values
+    // per pixel.
+    const OffsetValueType * offsetTable = displacementField->GetOffsetTable();
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      m_Strides[j] = offsetTable[j] * ImageDimension;
+    }
+    const typename DisplacementFieldImageType::RegionType & bufferedRegion = displacementField->GetBufferedRegion();
+    m_BufferedStart = bufferedRegion.GetIndex();
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      m_BufferedEnd[j] = m_BufferedStart[j] + static_cast<IndexValueType>(bufferedRegion.GetSize(j)) - 1;
+    }
+
+    // m_Weights[k][j] maps the central difference along index axis j to the
+    // physical gradient component k.
+    const typename DisplacementFieldImageType::SpacingType &   spacing = displacementField->GetSpacing();
+    const typename DisplacementFieldImageType::DirectionType & direction = displacementField->GetDirection();
+    for (unsigned int k = 0; k < ImageDimension; ++k)
+    {
+      for (unsigned int j = 0; j < ImageDimension; ++j)
+      {
+        m_Weights[k][j] = static_cast<TOperatorValueType>(CoefficientsType::Scale * direction[k][j] / spacing[j]);
+      }
+    }
+  }
+
+  /** Compute the gradients of the lineLength pixels of the scanline that
+   * starts at lineIndex, which must lie in the buffered region, into a
+   * structure of arrays: lineGradients[(i * ImageDimension + k) * lineLength +
+   * n] = du_i/dx_k at pixel n of the scanline. */
+  template <typename TLineValue>
+  void
+  ComputeLine(const IndexType & lineIndex, SizeValueType lineLength, TLineValue * lineGradients) const
+  {
+    const ValueType * lineStart = m_Buffer;
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      lineStart += (lineIndex[j] - m_BufferedStart[j]) * m_Strides[j];
+    }
+
+    // Offsets of the neighbors at distance m + 1, clamped to the buffered
+    // region.  Along the other axes, they are the same for the whole
+    // scanline.
+    OffsetValueType next[ImageDimension][Radius];
+    OffsetValueType previous[ImageDimension][Radius];
+    for (unsigned int j = 1; j < ImageDimension; ++j)
+    {
+      for (unsigned int m = 0; m < Radius; ++m)
+      {
+        const IndexValueType distance = m + 1;
+        next[j][m] = (std::min(lineIndex[j] + distance, m_BufferedEnd[j]) - lineIndex[j]) * m_Strides[j];
+        previous[j][m] = (lineIndex[j] - std::max(lineIndex[j] - distance, m_BufferedStart[j])) * m_Strides[j];
+      }
+    }
+
+    // The pixels [interiorBegin, interiorEnd) of the scanline have all their
+    // neighbors along the scanline in the buffered region.
+    const IndexValueType x0 = lineIndex[0];
+    const auto           length = static_cast<IndexValueType>(lineLength);
+    const auto           radius = static_cast<IndexValueType>(Radius);
+    const IndexValueType interiorBegin = std::clamp<IndexValueType>(m_BufferedStart[0] + radius - x0, 0, length);
+    const IndexValueType interiorEnd =
+      std::clamp<IndexValueType>(m_BufferedEnd[0] - radius + 1 - x0, interiorBegin, length);
+
+    const auto clampFirstAxis = [this, &next, &previous](IndexValueType x) {
+      for (unsigned int m = 0; m < Radius; ++m)
+      {
+        const IndexValueType distance = m + 1;
+        next[0][m] = (std::min(x + distance, m_BufferedEnd[0]) - x) * m_Strides[0];
+        previous[0][m] = (x - std::max(x - distance, m_BufferedStart[0])) * m_Strides[0];
+      }
+    };
+
+    IndexValueType n = 0;
+    for (; n < interiorBegin; ++n)
+    {
+      clampFirstAxis(x0 + n);
+      this->ComputePixel(lineStart + n * m_Strides[0], next, previous, n, lineLength, lineGradients);
+    }
+    for (unsigned int m = 0; m < Radius; ++m)
+    {
+      next[0][m] = (m + 1) * m_Strides[0];
+      previous[0][m] = (m + 1) * m_Strides[0];
+    }
+    for (; n < interiorEnd; ++n)
+    {
+      this->ComputePixel(lineStart + n * m_Strides[0], next, previous, n, lineLength, lineGradients);
+    }
+    for (; n < length; ++n)
+    {
+      clampFirstAxis(x0 + n);
+      this->ComputePixel(lineStart + n * m_Strides[0], next, previous, n, lineLength, lineGradients);
+    }
+  }
+
+private:
+  template <typename TLineValue>
+  inline void
+  ComputePixel(const ValueType *     center,
+               const OffsetValueType (&next)[ImageDimension][Radius],
+               const OffsetValueType (&previous)[ImageDimension][Radius],
+               SizeValueType         n,
+               SizeValueType         lineLength,
+               TLineValue *          lineGradients) const
+  {
+    // gradient[i][k] = du_i/dx_k
+    TOperatorValueType gradient[ImageDimension][ImageDimension] = {};
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      TOperatorValueType difference[ImageDimension];
+      StrainDetail::Unroll<Radius>([&](auto mm) {
+        constexpr unsigned int m = decltype(mm)::value;
+        const ValueType *      forward = center + next[j][m];
+        const ValueType *      backward = center - previous[j][m];
+        for (unsigned int i = 0; i < ImageDimension; ++i)
+        {
+          if constexpr (m == 0)
+          {
+            difference[i] = static_cast<TOperatorValueType>(forward[i] - backward[i]);
+          }
+          else
+          {
+            constexpr auto ratio = static_cast<TOperatorValueType>(CoefficientsType::Ratios[m]);
+            difference[i] += ratio * static_cast<TOperatorValueType>(forward[i] - backward[i]);
+          }
+        }
+      });
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        for (unsigned int k = 0; k < ImageDimension; ++k)
+        {
+          gradient[i][k] += m_Weights[k][j] * difference[i];
+        }
+      }
+    }
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      for (unsigned int k = 0; k < ImageDimension; ++k)
+      {
+        lineGradients[(i * ImageDimension + k) * lineLength + n] = static_cast<TLineValue>(gradient[i][k]);
+      }
+    }
+  }
+
+  const ValueType *  m_Buffer;
+  OffsetValueType    m_Strides[ImageDimension];
+  IndexType          m_BufferedStart;
+  IndexType          m_BufferedEnd;
+  TOperatorValueType m_Weights[ImageDimension][ImageDimension];
+};
+
+/** Call functor(std::integral_constant<unsigned int, order>()), so that a
+ * filter selects the DisplacementGradientStencil of its order of accuracy
+ * once per region.  Returns false, without calling the functor, when the
+ * order is not 2, 4, or 6. */
+template <typename TFunctor>
+inline bool
+DispatchFiniteDifferenceOrder(unsigned int order, TFunctor && functor)
+{
+  switch (order)
+  {
+    case 2:
+      functor(std::integral_constant<unsigned int, 2>());
+      return true;
+    case 4:
+      functor(std::integral_constant<unsigned int, 4>());
+      return true;
+    case 6:
+      functor(std::integral_constant<unsigned int, 6>());
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // end namespace itk
+
+#endif
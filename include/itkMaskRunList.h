@@ -0,0 +1,250 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMaskRunList_h
+#define itkMaskRunList_h
+
+#include "itkImageRegion.h"
+#include "itkImageScanlineConstIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+/** \class MaskRunList
+ *
+ * \brief Run-length encoding of the pixels of a mask image in a region.
+ *
+ * The nonzero pixels of each scanline of the region are grouped into runs,
+ * and the number of mask pixels before each run is kept, so that any range
+ * of the mask pixels, numbered in buffer order, is found by binary search.
+ * The work can then be split into ranges of equal numbers of mask pixels,
+ * however irregular the mask is.
+ *
+ * \ingroup Strain
+ */
+template <unsigned int VDimension>
+class MaskRunList
+{
+public:
+  using IndexType = Index<VDimension>;
+  using RegionType = ImageRegion<VDimension>;
+
+  struct RunType
+  {
+    IndexType     Index;
+    SizeValueType Length;
+
+    /** Offset of the first pixel of the run in the region, in buffer order. */
+    OffsetValueType Offset;
+  };
+
+  /** Encode the nonzero pixels of the mask in the region, which must be
+   * buffered. */
+  template <typename TMaskImage>
+  void
+  Compute(const TMaskImage * mask, const RegionType & region)
+  {
+    this->Clear();
+    m_NumberOfRegionPixels = region.GetNumberOfPixels();
+    using MaskPixelType = typename TMaskImage::PixelType;
+    ImageScanlineConstIterator<TMaskImage> maskIt(mask, region);
+    OffsetValueType                        lineOffset = 0;
+    while (!maskIt.IsAtEnd())
+    {
+      const IndexType lineIndex = maskIt.GetIndex();
+      SizeValueType   runLength = 0;
+      for (SizeValueType n = 0; !maskIt.IsAtEndOfLine(); ++maskIt, ++n)
+      {
+        if (maskIt.Get() != NumericTraits<MaskPixelType>::ZeroValue())
+        {
+          ++runLength;
+        }
+        else if (runLength > 0)
+        {
+          this->AddRun(lineIndex, lineOffset, n - runLength, runLength);
+          runLength = 0;
+        }
+      }
+      if (runLength > 0)
+      {
+        this->AddRun(lineIndex, lineOffset, region.GetSize(0) - runLength, runLength);
+      }
+      lineOffset += static_cast<OffsetValueType>(region.GetSize(0));
+      maskIt.NextLine();
+    }
+  }
+
+  void
+  Clear()
+  {
+    m_Runs.clear();
+    m_RunStarts.assign(1, 0);
+    m_MaximumRunLength = 0;
+    m_NumberOfRegionPixels = 0;
+    m_BoundingRegion = RegionType();
+  }
+
+  SizeValueType
+  GetNumberOfPixels() const
+  {
+    return m_RunStarts.empty() ? 0 : m_RunStarts.back();
+  }
+
+  const std::vector<RunType> &
+  GetRuns() const
+  {
+    return m_Runs;
+  }
+
+  SizeValueType
+  GetMaximumRunLength() const
+  {
+    return m_MaximumRunLength;
+  }
+
+  /** Smallest region that contains all the mask pixels, empty if there are
+   * none. */
+  const RegionType &
+  GetBoundingRegion() const
+  {
+    return m_BoundingRegion;
+  }
+
+  /** Call function(index, length, ordinal) for each part of a run that covers
+   * the mask pixels [begin, end), in order, where index is the first pixel of
+   * the part and ordinal its number among the mask pixels. */
+  template <typename TFunction>
+  void
+  ForEachRun(SizeValueType begin, SizeValueType end, TFunction && function) const
+  {
+    if (begin >= end)
+    {
+      return;
+    }
+    auto          run = std::upper_bound(m_RunStarts.begin(), m_RunStarts.end(), begin) - m_RunStarts.begin() - 1;
+    SizeValueType ordinal = begin;
+    while (ordinal < end)
+    {
+      const SizeValueType offset = ordinal - m_RunStarts[run];
+      const SizeValueType length = std::min(m_Runs[run].Length - offset, end - ordinal);
+      IndexType           index = m_Runs[run].Index;
+      index[0] += static_cast<IndexValueType>(offset);
+      function(static_cast<const IndexType &>(index), length, ordinal);
+      ordinal += length;
+      ++run;
+    }
+  }
+
+  /** Call function(offset, length) for each gap between the runs whose first
+   * pixel is among the mask pixels [begin, end), and the run before it, or
+   * the start of the region.  The range that ends with the last mask pixel
+   * also has the gap after the last run.  The offsets are in the region, in
+   * buffer order, so that the ranges of ParallelizePixels() visit each pixel
+   * outside the mask exactly once. */
+  template <typename TFunction>
+  void
+  ForEachGap(SizeValueType begin, SizeValueType end, TFunction && function) const
+  {
+    auto run = std::lower_bound(m_RunStarts.begin(), m_RunStarts.end() - 1, begin) - m_RunStarts.begin();
+    for (; run < static_cast<OffsetValueType>(m_Runs.size()) && m_RunStarts[run] < end; ++run)
+    {
+      const OffsetValueType gapStart =
+        run > 0 ? m_Runs[run - 1].Offset + static_cast<OffsetValueType>(m_Runs[run - 1].Length) : 0;
+      if (m_Runs[run].Offset > gapStart)
+      {
+        function(gapStart, static_cast<SizeValueType>(m_Runs[run].Offset - gapStart));
+      }
+    }
+    if (end == this->GetNumberOfPixels())
+    {
+      const OffsetValueType gapStart =
+        m_Runs.empty() ? 0 : m_Runs.back().Offset + static_cast<OffsetValueType>(m_Runs.back().Length);
+      if (static_cast<OffsetValueType>(m_NumberOfRegionPixels) > gapStart)
+      {
+        function(gapStart, m_NumberOfRegionPixels - static_cast<SizeValueType>(gapStart));
+      }
+    }
+  }
+
+  /** Split the mask pixels into numberOfRanges ranges of equal sizes, and call
+   * function(begin, end) for each range with the threader. */
+  template <typename TFunction>
+  void
+  ParallelizePixels(MultiThreaderBase * threader,
+                    SizeValueType       numberOfRanges,
+                    const TFunction &   function,
+                    ProcessObject *     filter) const
+  {
+    const SizeValueType numberOfPixels = this->GetNumberOfPixels();
+    numberOfRanges = std::max<SizeValueType>(std::min(numberOfRanges, numberOfPixels), 1);
+    threader->ParallelizeArray(
+      0,
+      numberOfRanges,
+      [numberOfPixels, numberOfRanges, &function](SizeValueType range) {
+        function(range * numberOfPixels / numberOfRanges, (range + 1) * numberOfPixels / numberOfRanges);
+      },
+      filter);
+  }
+
+private:
+  void
+  AddRun(const IndexType & lineIndex, OffsetValueType lineOffset, SizeValueType offset, SizeValueType length)
+  {
+    RunType run;
+    run.Index = lineIndex;
+    run.Index[0] += static_cast<IndexValueType>(offset);
+    run.Length = length;
+    run.Offset = lineOffset + static_cast<OffsetValueType>(offset);
+    m_Runs.push_back(run);
+    m_RunStarts.push_back(m_RunStarts.back() + length);
+    m_MaximumRunLength = std::max(m_MaximumRunLength, length);
+
+    RegionType runRegion(run.Index, Size<VDimension>::Filled(1));
+    runRegion.SetSize(0, length);
+    if (m_BoundingRegion.GetNumberOfPixels() == 0)
+    {
+      m_BoundingRegion = runRegion;
+      return;
+    }
+    for (unsigned int j = 0; j < VDimension; ++j)
+    {
+      const IndexValueType lower = std::min(m_BoundingRegion.GetIndex(j), runRegion.GetIndex(j));
+      const IndexValueType upper = std::max(m_BoundingRegion.GetUpperIndex()[j], runRegion.GetUpperIndex()[j]);
+      m_BoundingRegion.SetIndex(j, lower);
+      m_BoundingRegion.SetSize(j, static_cast<SizeValueType>(upper - lower + 1));
+    }
+  }
+
+  std::vector<RunType> m_Runs;
+
+  /** Number of mask pixels before each run, and in total. */
+  std::vector<SizeValueType> m_RunStarts{ 0 };
+
+  SizeValueType m_MaximumRunLength{ 0 };
+
+  SizeValueType m_NumberOfRegionPixels{ 0 };
+
+  RegionType m_BoundingRegion;
+};
+
+} // end namespace itk
+
+#endif
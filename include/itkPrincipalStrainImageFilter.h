@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPrincipalStrainImageFilter_h
+#define itkPrincipalStrainImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkVector.h"
+
+namespace itk
+{
+
+/** \class PrincipalStrainImageFilter
+ *
+ * \brief Generate principal strain and principal direction images from a
+ * displacement field image.
+ *
+ * The strain tensor of each pixel is computed as with the FusedGradient of
+ * StrainImageFilter, with a central difference stencil of the
+ * FiniteDifferenceOrder, and its eigenvalues and eigenvectors are computed in
+ * the same pass with the closed form solver of SymmetricEigenKernel, one
+ * scanline at a time.  The strain tensor image is never allocated.  The
+ * GradientFilter and the VectorGradientFilter of StrainImageFilter are not
+ * available here, since the gradients are never stored; for smoothed
+ * gradients, compute the strain tensor image with StrainImageFilter first.
+ *
+ * The first output holds the principal strains of each pixel in ascending
+ * order.  When ComputePrincipalDirections is enabled, output k + 1 holds the
+ * unit principal direction of principal strain k, in physical space.  The
+ * principal directions are otherwise not allocated.
+ *
+ * \tparam TInputImage An image of displacement vectors.
+ *
+ * \tparam TOperatorValueType The value type used in the derivative operator
+ * (defaults to float).
+ *
+ * \tparam TOutputValueType The value type of the output pixels (defaults to
+ * float).
+ *
+ * \sa StrainImageFilter
+ * \sa SymmetricEigenKernel
+ *
+ * \ingroup Strain
+ *
+ */
+template <typename TInputImage, typename TOperatorValueType = float, typename TOutputValueType = float>
+class PrincipalStrainImageFilter
+  : public ImageToImageFilter<TInputImage,
+                              Image<Vector<TOutputValueType, TInputImage::ImageDimension>, TInputImage::ImageDimension>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(PrincipalStrainImageFilter);
+
+  /** ImageDimension enumeration. */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  using InputImageType = TInputImage;
+  using OutputPixelType = Vector<TOutputValueType, ImageDimension>;
+  using OutputImageType = Image<OutputPixelType, ImageDimension>;
+  using OutputRegionType = typename OutputImageType::RegionType;
+  using TensorType = SymmetricSecondRankTensor<TOutputValueType, ImageDimension>;
+
+  /** Standard class type alias. */
+  using Self = PrincipalStrainImageFilter;
+  using Superclass = ImageToImageFilter<InputImageType, OutputImageType>;
+
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(PrincipalStrainImageFilter);
+
+  /** The strain forms of StrainImageFilter. */
+  enum StrainFormType
+  {
+    INFINITESIMAL = 0,
+    GREENLAGRANGIAN = 1,
+    EULERIANALMANSI = 2,
+    HENCKY = 3,
+    BIOT = 4
+  };
+
+  itkSetMacro(StrainForm, StrainFormType);
+  itkGetConstMacro(StrainForm, StrainFormType);
+
+  /** Order of accuracy of the central differences: 2, 4, or 6, as the
+   * FiniteDifferenceOrder of StrainImageFilter.  2 by default. */
+  itkSetMacro(FiniteDifferenceOrder, unsigned int);
+  itkGetConstMacro(FiniteDifferenceOrder, unsigned int);
+
+  /** Set/Get whether the principal direction outputs are computed.  Off by
+   * default. */
+  itkSetMacro(ComputePrincipalDirections, bool);
+  itkGetConstMacro(ComputePrincipalDirections, bool);
+  itkBooleanMacro(ComputePrincipalDirections);
+
+  /** Get the principal strains, in ascending order. */
+  OutputImageType *
+  GetPrincipalStrainOutput()
+  {
+    return this->GetOutput(0);
+  }
+
+  /** Get the direction of the principal strain of the given index. */
+  OutputImageType *
+  GetPrincipalDirectionOutput(unsigned int principalStrain)
+  {
+    return this->GetOutput(principalStrain + 1);
+  }
+
+protected:
+  PrincipalStrainImageFilter();
+
+  /** The input requested region is the output requested region padded by the
+   * radius of the stencil of the FiniteDifferenceOrder. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Do not allocate the principal directions unless they are computed. */
+  void
+  AllocateOutputs() override;
+
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputRegionType & outputRegion) override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  StrainFormType m_StrainForm;
+
+  unsigned int m_FiniteDifferenceOrder{ 2 };
+
+  bool m_ComputePrincipalDirections{ false };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkPrincipalStrainImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPrincipalStrainImageFilter_hxx
+#define itkPrincipalStrainImageFilter_hxx
+
+
+#include "itkDisplacementGradientStencil.h"
+#include "itkImageScanlineIterator.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+#include "itkSymmetricEigenKernel.h"
+
+#include <vector>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::PrincipalStrainImageFilter()
+  : m_StrainForm(INFINITESIMAL)
+{
+  this->SetNumberOfIndexedOutputs(ImageDimension + 1);
+
+  // ImageSource only does this for the first output.
+  for (unsigned int i = 1; i < ImageDimension + 1; ++i)
+  {
+    this->SetNthOutput(i, this->MakeOutput(i));
+  }
+
+  this->DynamicMultiThreadingOn();
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateInputRequestedRegion()
+{
+  // Call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input == nullptr)
+  {
+    return;
+  }
+
+  typename InputImageType::RegionType inputRegion = this->GetOutput()->GetRequestedRegion();
+  inputRegion.PadByRadius(this->m_FiniteDifferenceOrder / 2);
+  inputRegion.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(inputRegion);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AllocateOutputs()
+{
+  const unsigned int numberOfOutputs = this->m_ComputePrincipalDirections ? ImageDimension + 1 : 1;
+  for (unsigned int i = 0; i < numberOfOutputs; ++i)
+  {
+    OutputImageType * output = this->GetOutput(i);
+    if (output != nullptr)
+    {
+      output->SetBufferedRegion(output->GetRequestedRegion());
+      output->Allocate();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::BeforeThreadedGenerateData()
+{
+  const StrainFormType strainForm = this->GetStrainForm();
+  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI &&
+      strainForm != HENCKY && strainForm != BIOT)
+  {
+    itkExceptionMacro("Invalid StrainForm!");
+  }
+  if (this->m_FiniteDifferenceOrder != 2 && this->m_FiniteDifferenceOrder != 4 && this->m_FiniteDifferenceOrder != 6)
+  {
+    itkExceptionMacro("Invalid FiniteDifferenceOrder!");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::DynamicThreadedGenerateData(
+  const OutputRegionType & region)
+{
+  using EigenKernelType = SymmetricEigenKernel<ImageDimension, TOutputValueType>;
+
+  OutputImageType * output = this->GetOutput();
+
+  // Only the tensors of one scanline are held at a time, and the principal
+  // strains and directions are written directly to the outputs.
+  const SizeValueType           lineLength = region.GetSize(0);
+  std::vector<TOutputValueType> lineGradients(ImageDimension * ImageDimension * lineLength);
+  const TOutputValueType *      lineGradientComponents[ImageDimension * ImageDimension];
+  for (unsigned int k = 0; k < ImageDimension * ImageDimension; ++k)
+  {
+    lineGradientComponents[k] = lineGradients.data() + k * lineLength;
+  }
+  std::vector<TensorType> lineTensors(lineLength);
+  TOutputValueType *      lineDirections[ImageDimension];
+
+  // Each order of accuracy has its own stencil, and scanline loop.
+  bool knownStrainForm = false;
+  DispatchFiniteDifferenceOrder(this->m_FiniteDifferenceOrder, [&](auto order) {
+    const DisplacementGradientStencil<InputImageType, TOperatorValueType, decltype(order)::value> stencil(
+      this->GetInput());
+    knownStrainForm =
+      DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+        using BatchKernelType = StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValueType>;
+
+        ImageScanlineIterator<OutputImageType> outputIt(output, region);
+        while (!outputIt.IsAtEnd())
+        {
+          const typename OutputImageType::IndexType lineIndex = outputIt.GetIndex();
+          stencil.ComputeLine(lineIndex, lineLength, lineGradients.data());
+          auto * tensors = reinterpret_cast<TOutputValueType *>(lineTensors.data());
+          BatchKernelType::Compute(lineGradientComponents, tensors, lineLength);
+
+          auto * principalStrains =
+            reinterpret_cast<TOutputValueType *>(output->GetBufferPointer() + output->ComputeOffset(lineIndex));
+          if (this->m_ComputePrincipalDirections)
+          {
+            for (unsigned int k = 0; k < ImageDimension; ++k)
+            {
+              OutputImageType * directionImage = this->GetOutput(k + 1);
+              lineDirections[k] = reinterpret_cast<TOutputValueType *>(directionImage->GetBufferPointer() +
+                                                                       directionImage->ComputeOffset(lineIndex));
+            }
+            EigenKernelType::ComputeEigenSystem(tensors, principalStrains, lineDirections, lineLength);
+          }
+          else
+          {
+            EigenKernelType::ComputeEigenValues(tensors, principalStrains, lineLength);
+          }
+          outputIt.NextLine();
+        }
+      });
+  });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+PrincipalStrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::PrintSelf(std::ostream & os,
+                                                                                        Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
+     << std::endl;
+  os << indent << "FiniteDifferenceOrder: " << m_FiniteDifferenceOrder << std::endl;
+  os << indent << "ComputePrincipalDirections: " << (m_ComputePrincipalDirections ? "On" : "Off") << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -20,6 +20,11 @@
 
 #include "itkFixedArray.h"
 #include "itkImageToImageFilter.h"
+#include "itkNthElementImageAdaptor.h"
+#include "itkVectorImage.h"
+#include "itkVectorImageToImageAdaptor.h"
+
+#include <type_traits>
 
 namespace itk
 {
@@ -35,6 +40,17 @@ namespace itk
  *
  * It puts an image on every output corresponding to each component.
  *
+ * When the input is an Image of such fixed size pixels, or a VectorImage,
+ * and the outputs are scalar Images, the components are read directly from
+ * the input buffer and written to the output buffers one scanline at a time.
+ * The loop over the components is unrolled at compile time when all of them
+ * are extracted, and the ComponentsMask is only evaluated once per scanline
+ * otherwise.
+ *
+ * Consumers that only read a component can use GetComponentView() instead,
+ * which returns an image adaptor that reads the component from the input
+ * buffer with a stride, without running the filter or copying the input.
+ *
  * \ingroup Strain
  *
  * \sa VectorImageToImageAdaptor
@@ -70,6 +86,20 @@ public:
 
   using ComponentsMaskType = FixedArray<bool, TComponents>;
 
+  /** Value type of the components of the input pixels. */
+  using InputValueType = typename NumericTraits<InputPixelType>::ValueType;
+
+  /** Whether the input is a VectorImage, whose buffer holds the components
+   * of each pixel contiguously. */
+  static constexpr bool InputIsVectorImage =
+    std::is_same<InputImageType, VectorImage<InputValueType, ImageDimension>>::value;
+
+  /** Read-only view of a component of the input, see GetComponentView(). */
+  using ComponentViewType =
+    typename std::conditional<InputIsVectorImage,
+                              VectorImageToImageAdaptor<InputValueType, ImageDimension>,
+                              NthElementImageAdaptor<InputImageType, OutputPixelType>>::type;
+
   /** Run-time type information (and related methods). */
   itkOverrideGetNameOfClassMacro(SplitComponentsImageFilter);
 
@@ -82,6 +112,13 @@ public:
   itkSetMacro(ComponentsMask, ComponentsMaskType);
   itkGetConstReferenceMacro(ComponentsMask, ComponentsMaskType);
 
+  /** An adaptor that reads the given component of the pixels of the current
+   * input in place.  The filter does not need to be updated, and nothing is
+   * copied: the view follows the input buffer, which must be up to date and
+   * must outlive the view.  The view is for reading only. */
+  typename ComponentViewType::Pointer
+  GetComponentView(unsigned int component) const;
+
 protected:
   SplitComponentsImageFilter();
   ~SplitComponentsImageFilter() override = default;
@@ -97,6 +134,21 @@ protected:
   PrintSelf(std::ostream & os, Indent indent) const override;
 
 private:
+  /** Whether the components are read directly from the buffer of the input,
+   * as contiguous values, and written directly to the buffers of the outputs.
+   */
+  static constexpr bool SplitBuffers =
+    (InputIsVectorImage || (std::is_same<InputImageType, Image<InputPixelType, ImageDimension>>::value &&
+                            sizeof(InputPixelType) % sizeof(InputValueType) == 0 &&
+                            sizeof(InputPixelType) / sizeof(InputValueType) >= Components)) &&
+    std::is_same<OutputImageType, Image<OutputPixelType, ImageDimension>>::value;
+
+  /** Split the scanlines of the region with the buffer pointers, pixelValues
+   * being the number of values per input pixel. */
+  template <typename TPixelValues>
+  void
+  SplitScanlines(const OutputRegionType & outputRegion, TPixelValues pixelValues);
+
   ComponentsMaskType m_ComponentsMask;
 };
 
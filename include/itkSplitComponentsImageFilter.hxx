@@ -21,6 +21,8 @@
 
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
+#include "itkImageScanlineConstIterator.h"
+#include "itkStrainUnroll.h"
 
 namespace itk
 {
@@ -68,11 +70,54 @@ SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::AllocateOutp
   }
 }
 
+template <typename TInputImage, typename TOutputImage, unsigned int TComponents>
+auto
+SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::GetComponentView(unsigned int component) const ->
+  typename ComponentViewType::Pointer
+{
+  if (component >= Components)
+  {
+    itkExceptionMacro("Component " << component << " is out of range!");
+  }
+
+  auto view = ComponentViewType::New();
+  view->SetImage(const_cast<InputImageType *>(this->GetInput()));
+  if constexpr (InputIsVectorImage)
+  {
+    view->SetExtractComponentIndex(component);
+  }
+  else
+  {
+    view->SelectNthElement(component);
+  }
+  return view;
+}
+
 template <typename TInputImage, typename TOutputImage, unsigned int TComponents>
 void
 SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::DynamicThreadedGenerateData(
   const OutputRegionType & outputRegion)
 {
+  if constexpr (SplitBuffers)
+  {
+    if constexpr (InputIsVectorImage)
+    {
+      const SizeValueType pixelValues = this->GetInput()->GetNumberOfComponentsPerPixel();
+      if (pixelValues < Components)
+      {
+        itkExceptionMacro("The input has fewer than " << Components << " components per pixel!");
+      }
+      this->SplitScanlines(outputRegion, pixelValues);
+    }
+    else
+    {
+      this->SplitScanlines(outputRegion,
+                           std::integral_constant<SizeValueType, sizeof(InputPixelType) / sizeof(InputValueType)>());
+    }
+    return;
+  }
+
+  // Other pixel and image types are split through their iterators.
   typename InputImageType::ConstPointer input = this->GetInput();
   ProcessObject::DataObjectPointerArray outputs = this->GetOutputs();
   const ComponentsMaskType              componentsMask = this->m_ComponentsMask;
@@ -104,6 +149,78 @@ SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::DynamicThrea
   }
 }
 
+template <typename TInputImage, typename TOutputImage, unsigned int TComponents>
+template <typename TPixelValues>
+void
+SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::SplitScanlines(
+  const OutputRegionType & outputRegion,
+  TPixelValues             pixelValues)
+{
+  const InputImageType * input = this->GetInput();
+  const auto *           inputBuffer = reinterpret_cast<const InputValueType *>(input->GetBufferPointer());
+
+  // The mask is evaluated once: the extracted components, and their outputs.
+  unsigned int      components[Components];
+  OutputImageType * outputs[Components];
+  unsigned int      numberOfComponents = 0;
+  for (unsigned int ii = 0; ii < Components; ++ii)
+  {
+    if (this->m_ComponentsMask[ii])
+    {
+      components[numberOfComponents] = ii;
+      outputs[numberOfComponents] = static_cast<OutputImageType *>(this->ProcessObject::GetOutput(ii));
+      ++numberOfComponents;
+    }
+  }
+  if (numberOfComponents == 0)
+  {
+    return;
+  }
+
+  const SizeValueType lineLength = outputRegion.GetSize(0);
+
+  ImageScanlineConstIterator<InputImageType> inIt(input, outputRegion);
+  while (!inIt.IsAtEnd())
+  {
+    const typename InputImageType::IndexType lineIndex = inIt.GetIndex();
+    const InputValueType * inputLine = inputBuffer + input->ComputeOffset(lineIndex) * pixelValues;
+
+    OutputPixelType * outputLines[Components];
+    for (unsigned int kk = 0; kk < numberOfComponents; ++kk)
+    {
+      outputLines[kk] = outputs[kk]->GetBufferPointer() + outputs[kk]->ComputeOffset(lineIndex);
+    }
+
+    if (numberOfComponents == Components)
+    {
+      // Each output is written sequentially, and each input pixel is read
+      // once.
+      for (SizeValueType n = 0; n < lineLength; ++n)
+      {
+        const InputValueType * inputPixel = inputLine + n * pixelValues;
+        StrainDetail::Unroll<Components>([&](auto cc) {
+          constexpr unsigned int c = decltype(cc)::value;
+          outputLines[c][n] = static_cast<OutputPixelType>(inputPixel[c]);
+        });
+      }
+    }
+    else
+    {
+      for (unsigned int kk = 0; kk < numberOfComponents; ++kk)
+      {
+        const InputValueType * inputComponent = inputLine + components[kk];
+        OutputPixelType *      outputLine = outputLines[kk];
+        for (SizeValueType n = 0; n < lineLength; ++n)
+        {
+          outputLine[n] = static_cast<OutputPixelType>(inputComponent[n * pixelValues]);
+        }
+      }
+    }
+
+    inIt.NextLine();
+  }
+}
+
 template <typename TInputImage, typename TOutputImage, unsigned int TComponents>
 void
 SplitComponentsImageFilter<TInputImage, TOutputImage, TComponents>::PrintSelf(std::ostream & os, Indent indent) const
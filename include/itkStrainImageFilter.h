@@ -20,8 +20,14 @@
 
 #include "itkCovariantVector.h"
 #include "itkImageToImageFilter.h"
+#include "itkMaskRunList.h"
+#include "itkStrainOutputLayout.h"
+#include "itkStrainStageStatistics.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkSplitComponentsImageFilter.h"
+#include "itkVectorImage.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -39,7 +45,9 @@ namespace itk
  * each output corresponding to each Vector component.
  *
  * \tparam TInputImage The first template parameter is the input image type. It should
- * be an image of displacement vectors.
+ * be an image of displacement vectors, or a VectorImage with ImageDimension
+ * components per pixel, e.g. a view of a NumPy array.  The FusedGradient
+ * reads the buffer of either directly.
  *
  * \tparam TOperatorValueType The second template parameter defines the value
  * type used in the derivative operator (defaults to float).
@@ -52,9 +60,46 @@ namespace itk
  * Three different types of strains can be calculated, infinitesimal (default), aka
  * engineering strain, which is appropriate for small strains, Green-Lagrangian,
  * which uses a material reference system, and Eulerian-Almansi, which uses a
- * spatial reference system.  This is set with SetStrainForm().
+ * spatial reference system.  This is set with SetStrainForm().  For large
+ * deformations, the Hencky, or logarithmic, strain ln(U) and the Biot strain
+ * U - I of the right stretch tensor U = sqrt(F^T F) are also available.  They
+ * are computed in the same pass as the Green-Lagrangian strain, from its closed
+ * form eigen system in 2D and 3D.
+ *
+ * The gradient images are only held while the filter executes.  With
+ * SetLowMemory(), they are computed and consumed one component at a time, and
+ * ComputeIntermediateMemorySize() reports the peak memory they require.
+ *
+ * The filter supports streaming.  The input requested region is the output
+ * requested region padded by the region the gradient filter requires, which
+ * is queried from the configured gradient filter, or by the radius of the
+ * fused stencil.  Only that region of the input is processed.
+ *
+ * Except in LowMemory mode, the gradients of each output scanline are
+ * gathered into a structure of arrays, and the tensors are assembled by a
+ * StrainTensorBatchKernel with the widest SIMD instructions the processor
+ * supports.
+ *
+ * With a MaskImage, the strain is only computed at the nonzero pixels of the
+ * mask.  The output is zero elsewhere, or, with CompactMaskedOutput, it is not
+ * allocated and the strain of the mask pixels is returned in a list.
+ *
+ * With SetOutputLayout(), the independent components of the tensors are
+ * written directly to separate scalar images, or to a VectorImage, in Voigt
+ * order, instead of the tensor image.
+ *
+ * With CollectStageStatistics, the wall time, the allocated bytes, and the
+ * threads of the component split, the gradient, and the tensor assembly
+ * stages are measured, and reported by GetStageStatistics() and by a
+ * StrainStageEvent per stage.
  *
  * \sa TransformToStrainFilter
+ * \sa StrainTensorBatchKernel
+ * \sa StrainInvariantImageFilter
+ * \sa PrincipalStrainImageFilter
+ * \sa StrainPointEvaluator
+ * \sa StrainSequenceImageFilter
+ * \sa VectorGradientRecursiveGaussianImageFilter
  *
  * \ingroup Strain
  *
@@ -74,8 +119,17 @@ public:
   using InputImageType = TInputImage;
   using OutputPixelType = SymmetricSecondRankTensor<TOutputValueType, ImageDimension>;
   using OutputImageType = Image<OutputPixelType, ImageDimension>;
+  using OutputRegionType = typename OutputImageType::RegionType;
+  using OutputIndexType = typename OutputImageType::IndexType;
   using OperatorImageType = Image<TOperatorValueType, ImageDimension>;
 
+  /** Number of independent components of a strain tensor. */
+  static constexpr unsigned int TensorComponents = OutputPixelType::InternalDimension;
+
+  /** Types of the outputs of the COMPONENTIMAGES and VOIGTIMAGE layouts. */
+  using ComponentImageType = Image<TOutputValueType, ImageDimension>;
+  using VoigtImageType = VectorImage<TOutputValueType, ImageDimension>;
+
   /** Standard class type alias. */
   using Self = StrainImageFilter;
   using Superclass = ImageToImageFilter<InputImageType, OutputImageType>;
@@ -106,49 +160,357 @@ public:
   /** Set the filter used to calculate the gradients internally.  This filter
    * should take a Vector image as input and produce a CovariantVector gradient
    * image on each output corresponding to every Vector component.  If this
-   * filter is non-NULL, it is used instead of the GradientFilter. */
+   * filter is non-NULL, it is used instead of the GradientFilter.
+   * VectorGradientRecursiveGaussianImageFilter is such a filter, that smooths
+   * all the components together. */
   itkSetObjectMacro(VectorGradientFilter, VectorGradientFilterType);
   itkGetConstObjectMacro(VectorGradientFilter, VectorGradientFilterType);
 
+  /** Compute the displacement gradients with a built-in central difference
+   * stencil that reads the Vector input directly, and assemble the strain
+   * tensor in the same pass.  No component or gradient images are allocated.
+   * With the default FiniteDifferenceOrder, the result matches the default
+   * itk::GradientImageFilter: the image spacing and direction are taken into
+   * account, and a zero flux Neumann boundary condition is applied.  When
+   * enabled, the GradientFilter and the VectorGradientFilter are not used.
+   * Off by default. */
+  itkSetMacro(FusedGradient, bool);
+  itkGetConstMacro(FusedGradient, bool);
+  itkBooleanMacro(FusedGradient);
+
+  /** Order of accuracy of the central differences of the FusedGradient: 2,
+   * 4, or 6.  The fourth and sixth order stencils read 2 and 3 neighbors on
+   * each side of a pixel, instead of 1, and are specialized at compile time,
+   * so that each order runs its own unrolled loop.  They are more accurate on
+   * smooth displacements, but amplify noise more.  2 by default, which
+   * matches the default itk::GradientImageFilter. */
+  itkSetMacro(FiniteDifferenceOrder, unsigned int);
+  itkGetConstMacro(FiniteDifferenceOrder, unsigned int);
+
+  /** Compute the gradient of one displacement component at a time with the
+   * GradientFilter, and add its contribution to the strain before the next
+   * component is split.  Only one component image and one gradient image are
+   * allocated at any time, instead of ImageDimension of each.  This does not
+   * apply to the VectorGradientFilter, which produces all the gradients at
+   * once, nor to the FusedGradient, which does not allocate any.  Off by
+   * default. */
+  itkSetMacro(LowMemory, bool);
+  itkGetConstMacro(LowMemory, bool);
+  itkBooleanMacro(LowMemory);
+
+  /** Run the ImageDimension component gradient pipelines concurrently, each
+   * with an equal share of the work units of this filter, instead of updating
+   * the GradientFilter once per component in sequence.  Each component needs
+   * its own gradient filter, see SetComponentGradientFilter().  This does not
+   * apply to the VectorGradientFilter, the FusedGradient, or in LowMemory
+   * mode.  Off by default. */
+  itkSetMacro(ConcurrentGradients, bool);
+  itkGetConstMacro(ConcurrentGradients, bool);
+  itkBooleanMacro(ConcurrentGradients);
+
+  /** Set the filter used to calculate the gradient of one component with
+   * ConcurrentGradients, configured like the GradientFilter.  The filters of
+   * the components must be distinct.  A component without its own filter uses
+   * the GradientFilter for the first component, and a new
+   * itk::GradientImageFilter for the others as long as the default
+   * GradientFilter is kept.  The settings of another GradientFilter cannot be
+   * copied, so an exception is thrown when the filter of a component other
+   * than the first is missing. */
+  virtual void
+  SetComponentGradientFilter(unsigned int component, GradientFilterType * gradientFilter);
+  virtual const GradientFilterType *
+  GetComponentGradientFilter(unsigned int component) const;
+
+  /** Peak size in bytes of the intermediate component and gradient images
+   * allocated to compute the given output region with the current settings.
+   * The input information must be available, e.g. after
+   * UpdateOutputInformation().  The gradient images are sized from the
+   * region the gradient filter produces, which may be larger than the output
+   * region.  The input, the output, and the memory used internally by the
+   * gradient filters are not included. */
+  SizeValueType
+  ComputeIntermediateMemorySize(const OutputRegionType & outputRegion) const;
+
   /**
    * Three different types of strains can be calculated, infinitesimal (default), aka
    * engineering strain, which is appropriate for small strains, Green-Lagrangian,
    * which uses a material reference system, and Eulerian-Almansi, which uses a
-   * spatial reference system.  This is set with SetStrainForm(). */
+   * spatial reference system.  This is set with SetStrainForm().  HENCKY and
+   * BIOT are the logarithmic and Biot strains, in the material reference
+   * system, for large deformations. */
   enum StrainFormType
   {
     INFINITESIMAL = 0,
     GREENLAGRANGIAN = 1,
-    EULERIANALMANSI = 2
+    EULERIANALMANSI = 2,
+    HENCKY = 3,
+    BIOT = 4
   };
 
   itkSetMacro(StrainForm, StrainFormType);
   itkGetConstMacro(StrainForm, StrainFormType);
 
-protected:
-  using OutputRegionType = typename OutputImageType::RegionType;
+  /** Type of the image that restricts the computation to its nonzero pixels. */
+  using MaskImageType = Image<unsigned char, ImageDimension>;
+
+  /** Compute the strain only at the nonzero pixels of the mask, which must
+   * have the geometry of the input.  The output is zero at the other pixels.
+   * The mask pixels are grouped into runs along the first axis, and the work
+   * units are given equal numbers of mask pixels, so that they stay balanced
+   * however irregular the mask is.  The FusedGradient and the LowMemory
+   * accumulation only visit the mask pixels, plus the neighbors the stencil
+   * reads, while the GradientFilter and the VectorGradientFilter produce their
+   * gradient images on the bounding region of the mask.  Not set by
+   * default. */
+  itkSetInputMacro(MaskImage, MaskImageType);
+  itkGetInputMacro(MaskImage, MaskImageType);
+
+  /** With a MaskImage, do not allocate the output image, and store the strain
+   * of the mask pixels in GetMaskedTensors(), at the indices listed by
+   * GetMaskedIndices(), in buffer order.  Off by default. */
+  itkSetMacro(CompactMaskedOutput, bool);
+  itkGetConstMacro(CompactMaskedOutput, bool);
+  itkBooleanMacro(CompactMaskedOutput);
+
+  using MaskedIndicesType = std::vector<OutputIndexType>;
+  using MaskedTensorsType = std::vector<OutputPixelType>;
 
+  /** Indices and strain tensors of the mask pixels after an update with
+   * CompactMaskedOutput.  Empty otherwise. */
+  itkGetConstReferenceMacro(MaskedIndices, MaskedIndicesType);
+  itkGetConstReferenceMacro(MaskedTensors, MaskedTensorsType);
+
+  /** Where the strain is written.  TENSORIMAGE (default) fills the first
+   * output, an image of SymmetricSecondRankTensor pixels.  COMPONENTIMAGES
+   * fills GetComponentOutput(k), one contiguous scalar image per independent
+   * component, and VOIGTIMAGE fills GetVoigtOutput(), a VectorImage with
+   * TensorComponents components per pixel.  Both use the Voigt order: xx, yy,
+   * zz, yz, xz, xy in 3D, and xx, yy, xy in 2D.  The shear components are the
+   * tensor components, not the engineering shear strains.  Only the outputs
+   * of the layout are allocated, and the components are written by the same
+   * pass that computes them, so no tensor image is split afterwards.  The
+   * list of CompactMaskedOutput is not affected. */
+  enum OutputLayoutType
+  {
+    TENSORIMAGE = 0,
+    COMPONENTIMAGES = 1,
+    VOIGTIMAGE = 2
+  };
+
+  itkSetMacro(OutputLayout, OutputLayoutType);
+  itkGetConstMacro(OutputLayout, OutputLayoutType);
+
+  /** Image of the component of the given Voigt index, filled with the
+   * COMPONENTIMAGES layout. */
+  ComponentImageType *
+  GetComponentOutput(unsigned int voigtIndex)
+  {
+    return dynamic_cast<ComponentImageType *>(this->ProcessObject::GetOutput(1 + voigtIndex));
+  }
+
+  /** VectorImage of the components in Voigt order, filled with the VOIGTIMAGE
+   * layout. */
+  VoigtImageType *
+  GetVoigtOutput()
+  {
+    return dynamic_cast<VoigtImageType *>(this->ProcessObject::GetOutput(1 + TensorComponents));
+  }
+
+  /** Stages of an update.  COMPONENTSPLIT splits the displacement components
+   * for the GradientFilter, GRADIENT runs the gradient filters, or the fused
+   * stencil, and TENSORASSEMBLY assembles the strain from the gradients.
+   * With the FusedGradient, the gradient and the assembly alternate on every
+   * scanline. */
+  enum StageType
+  {
+    COMPONENTSPLIT = 0,
+    GRADIENT = 1,
+    TENSORASSEMBLY = 2
+  };
+  static constexpr unsigned int NumberOfStages = 3;
+
+  /** Measure the wall time, the allocated bytes, and the threads of each
+   * stage, and invoke a StrainStageEvent for each at the end of the update.
+   * When off, nothing is measured and the statistics are zero.  Off by
+   * default. */
+  itkSetMacro(CollectStageStatistics, bool);
+  itkGetConstMacro(CollectStageStatistics, bool);
+  itkBooleanMacro(CollectStageStatistics);
+
+  /** Statistics of a stage in the last update with CollectStageStatistics. */
+  const StrainStageStatistics &
+  GetStageStatistics(StageType stage) const
+  {
+    return m_StageStatistics[stage];
+  }
+
+  /** Name of a stage, as given by StrainStageEvent::GetStageName(). */
+  static const char *
+  GetStageName(StageType stage)
+  {
+    constexpr const char * names[NumberOfStages] = { "ComponentSplit", "Gradient", "TensorAssembly" };
+    return stage < NumberOfStages ? names[stage] : "";
+  }
+
+protected:
   StrainImageFilter();
 
+  /** The output 0 is the tensor image, the outputs 1 to TensorComponents the
+   * component images, and the last output the Voigt image. */
+  using Superclass::MakeOutput;
+  ProcessObject::DataObjectPointer
+  MakeOutput(ProcessObject::DataObjectPointerArraySizeType idx) override;
+
+  /** The Voigt image has TensorComponents components per pixel. */
+  void
+  GenerateOutputInformation() override;
+
+  /** Only the outputs of the OutputLayout are allocated, and none with
+   * CompactMaskedOutput. */
+  void
+  AllocateOutputs() override;
+
+  /** With a MaskImage, the work is split over the mask pixels instead of the
+   * output region. */
+  void
+  GenerateData() override;
+
+  /** The input requested region is the output requested region padded by the
+   * region required by the gradient computation. */
+  void
+  GenerateInputRequestedRegion() override;
+
   void
   BeforeThreadedGenerateData() override;
 
   void
   DynamicThreadedGenerateData(const OutputRegionType & outputRegion) override;
 
+  /** Release the gradient images. */
+  void
+  AfterThreadedGenerateData() override;
+
   using InputComponentsImageFilterType = itk::SplitComponentsImageFilter<InputImageType, OperatorImageType>;
 
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
 private:
+  using InputRegionType = typename InputImageType::RegionType;
+
+  /** Region of the input required to compute the given output region.  When a
+   * gradient filter is used, it is queried by propagating the output region
+   * through it on an image that only carries the input information.  The
+   * input and the output requested region of the gradient filter are
+   * restored afterwards.  If gradientRegion is not null, it receives the
+   * region of the gradient images, which the gradient filter may enlarge. */
+  InputRegionType
+  ComputeInputRequestedRegion(const OutputRegionType & outputRegion,
+                              OutputRegionType *       gradientRegion = nullptr) const;
+
+  /** Compute the gradient of every component of the input concurrently. */
+  void
+  ComputeConcurrentGradients(const InputImageType * input, const OutputRegionType & outputRegion);
+
+  /** Wall time accumulator of a stage, or null when the statistics are not
+   * collected. */
+  double *
+  GetStageSeconds(StageType stage)
+  {
+    return this->m_CollectStageStatistics ? &this->m_StageStatistics[stage].WallTime : nullptr;
+  }
+
+  /** Point m_OutputBuffers to the buffers of the OutputLayout, or to the
+   * compact list. */
+  void
+  SetUpOutputBuffers();
+
+  /** Where the tensors of a scanline are written. */
+  using TensorLineType = StrainTensorLine<TOutputValueType, ImageDimension>;
+
+  /** Call lineFunction(lineIndex, lineLength, lineTensors) for each scanline
+   * of the region, where lineTensors is the TensorLineType of the output
+   * pixels of the scanline. */
+  template <typename TLineFunction>
+  void
+  ForEachRegionLine(const OutputRegionType & region, const TLineFunction & lineFunction);
+
+  /** Split the region, or the mask pixels in the region when a MaskImage is
+   * set, into shares of the work units, and call
+   * generateLines(forEachLine, maximumLineLength) for each share, where
+   * forEachLine(lineFunction) visits the scanlines of the share, or the runs
+   * of mask pixels, as ForEachRegionLine does, and lineTensors refers to the
+   * output pixels or the compact list.  With fillMaskGaps, each share also
+   * zeroes the output pixels outside the mask between its runs. */
+  template <typename TGenerateLines>
+  void
+  ParallelizeLines(const OutputRegionType & region,
+                   const TGenerateLines &   generateLines,
+                   ProcessObject *          filter,
+                   bool                     fillMaskGaps);
+
+  /** Compute the strain of the scanlines visited by forEachLine, from the
+   * fused stencil or from the gradient images. */
+  template <typename TForEachLine>
+  void
+  GenerateLines(const TForEachLine & forEachLine, SizeValueType maximumLineLength);
+
+  /** Add the contribution of the gradient of one displacement component to
+   * the scanlines visited by forEachLine.  The output is overwritten when
+   * first is true, and completed with the last component. */
+  template <typename TForEachLine>
+  void
+  AddComponentGradient(unsigned int                    component,
+                       const GradientOutputImageType * gradientImage,
+                       const TForEachLine &            forEachLine,
+                       bool                            first);
+
   typename InputComponentsImageFilterType::Pointer m_InputComponentsFilter;
 
   typename GradientFilterType::Pointer m_GradientFilter;
 
+  /** The GradientFilter made by the constructor, whose settings are known. */
+  typename GradientFilterType::Pointer m_DefaultGradientFilter;
+
+  std::vector<typename GradientFilterType::Pointer> m_ComponentGradientFilters;
+
   typename VectorGradientFilterType::Pointer m_VectorGradientFilter;
 
+  /** Gradient of each displacement component, only held during the update. */
+  std::vector<typename GradientOutputImageType::Pointer> m_GradientImages;
+
   StrainFormType m_StrainForm;
+
+  bool m_FusedGradient{ false };
+
+  unsigned int m_FiniteDifferenceOrder{ 2 };
+
+  bool m_LowMemory{ false };
+
+  bool m_ConcurrentGradients{ false };
+
+  bool m_CompactMaskedOutput{ false };
+
+  /** Runs of mask pixels in the output requested region, only used during the
+   * update. */
+  MaskRunList<ImageDimension> m_MaskRuns;
+
+  MaskedIndicesType m_MaskedIndices;
+  MaskedTensorsType m_MaskedTensors;
+
+  OutputLayoutType m_OutputLayout{ TENSORIMAGE };
+
+  /** Buffers of the OutputLayout, or the compact list, set up before the
+   * threads start. */
+  StrainOutputBuffers<TOutputValueType, ImageDimension> m_OutputBuffers;
+
+  bool m_CollectStageStatistics{ false };
+
+  StrainStageStatistics m_StageStatistics[NumberOfStages];
+
+  /** Shares the wall time of the threaded section between the gradient of the
+   * FusedGradient and the assembly. */
+  StrainDetail::SharedStageTimer m_ThreadedStageTimer;
 };
 
 } // end namespace itk
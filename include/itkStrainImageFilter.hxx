@@ -19,9 +19,16 @@
 #define itkStrainImageFilter_hxx
 
 
+#include "itkDisplacementGradientStencil.h"
 #include "itkGradientImageFilter.h"
-#include "itkImageRegionConstIterator.h"
-#include "itkImageRegionIterator.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <vector>
 
 namespace itk
 {
@@ -31,152 +38,824 @@ StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::StrainImag
   : m_InputComponentsFilter(InputComponentsImageFilterType::New())
   , m_StrainForm(INFINITESIMAL)
 {
-  // The first output is only of interest to the user.  The rest of the outputs
-  // are GradientImageFilter outputs used internally, but put on the output so
-  // memory management capabilities of the pipeline can be taken advantage of.
-  this->SetNumberOfIndexedOutputs(1 + ImageDimension);
-  for (unsigned int i = 1; i < ImageDimension + 1; i++)
-  {
-    this->SetNthOutput(i, GradientOutputImageType::New().GetPointer());
-  }
-
   using GradientImageFilterType = GradientImageFilter<OperatorImageType, TOperatorValueType, TOperatorValueType>;
   this->m_GradientFilter = GradientImageFilterType::New().GetPointer();
+  this->m_DefaultGradientFilter = this->m_GradientFilter;
+  this->m_ComponentGradientFilters.resize(ImageDimension);
+
+  this->AddOptionalInputName("MaskImage");
+
+  // ImageSource only makes the tensor image.
+  this->SetNumberOfIndexedOutputs(TensorComponents + 2);
+  for (unsigned int idx = 1; idx < TensorComponents + 2; ++idx)
+  {
+    this->SetNthOutput(idx, this->MakeOutput(idx));
+  }
 
   this->DynamicMultiThreadingOn();
 }
 
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+ProcessObject::DataObjectPointer
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::MakeOutput(
+  ProcessObject::DataObjectPointerArraySizeType idx)
+{
+  if (idx == 0)
+  {
+    return OutputImageType::New().GetPointer();
+  }
+  if (idx <= TensorComponents)
+  {
+    return ComponentImageType::New().GetPointer();
+  }
+  return VoigtImageType::New().GetPointer();
+}
+
 template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
 void
-StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::BeforeThreadedGenerateData()
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::SetComponentGradientFilter(
+  unsigned int         component,
+  GradientFilterType * gradientFilter)
 {
-  typename InputImageType::ConstPointer input = this->GetInput();
+  if (component >= ImageDimension)
+  {
+    itkExceptionMacro("Component " << component << " is out of range, the input has " << ImageDimension
+                                   << " components.");
+  }
+  if (this->m_ComponentGradientFilters[component] != gradientFilter)
+  {
+    this->m_ComponentGradientFilters[component] = gradientFilter;
+    this->Modified();
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+auto
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GetComponentGradientFilter(
+  unsigned int component) const -> const GradientFilterType *
+{
+  if (component >= ImageDimension)
+  {
+    itkExceptionMacro("Component " << component << " is out of range, the input has " << ImageDimension
+                                   << " components.");
+  }
+  return this->m_ComponentGradientFilters[component].GetPointer();
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+
+  this->GetVoigtOutput()->SetNumberOfComponentsPerPixel(TensorComponents);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+auto
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::ComputeInputRequestedRegion(
+  const OutputRegionType & outputRegion,
+  OutputRegionType *       gradientRegion) const -> InputRegionType
+{
+  const InputImageType * input = this->GetInput();
+
+  if (this->m_FusedGradient)
+  {
+    InputRegionType inputRegion = outputRegion;
+    inputRegion.PadByRadius(this->m_FiniteDifferenceOrder / 2);
+    inputRegion.Crop(input->GetLargestPossibleRegion());
+    if (gradientRegion != nullptr)
+    {
+      *gradientRegion = outputRegion;
+    }
+    return inputRegion;
+  }
+
+  // The gradient filter is connected to an image that only carries the input
+  // information while the region is propagated, and its previous input and
+  // output requested region are restored afterwards.
+  const auto propagate = [&](auto * gradientFilter, auto informationImage) -> InputRegionType {
+    const auto *              previousInput = gradientFilter->GetInput();
+    GradientOutputImageType * gradientOutput = gradientFilter->GetOutput();
+    const OutputRegionType    previousRegion = gradientOutput->GetRequestedRegion();
+
+    informationImage->CopyInformation(input);
+    gradientFilter->SetInput(informationImage);
+    gradientOutput->SetRequestedRegion(outputRegion);
+    gradientFilter->PropagateRequestedRegion(gradientOutput);
+    const InputRegionType inputRegion = informationImage->GetRequestedRegion();
+    if (gradientRegion != nullptr)
+    {
+      *gradientRegion = gradientOutput->GetRequestedRegion();
+    }
+
+    gradientFilter->SetInput(previousInput);
+    gradientOutput->SetRequestedRegion(previousRegion);
+    return inputRegion;
+  };
 
   if (this->m_VectorGradientFilter.GetPointer() != nullptr)
   {
-    this->m_VectorGradientFilter->SetInput(input);
-    for (unsigned int i = 1; i < ImageDimension + 1; ++i)
+    return propagate(this->m_VectorGradientFilter.GetPointer(), InputImageType::New());
+  }
+  return propagate(this->m_GradientFilter.GetPointer(), OperatorImageType::New());
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateInputRequestedRegion()
+{
+  // Call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input == nullptr)
+  {
+    return;
+  }
+
+  input->SetRequestedRegion(this->ComputeInputRequestedRegion(this->GetOutput()->GetRequestedRegion()));
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AllocateOutputs()
+{
+  const bool compact = this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput;
+  for (unsigned int idx = 0; idx < this->GetNumberOfIndexedOutputs(); ++idx)
+  {
+    auto * output = dynamic_cast<ImageBase<ImageDimension> *>(this->ProcessObject::GetOutput(idx));
+    if (output == nullptr)
     {
-      this->m_VectorGradientFilter->GraftNthOutput(
-        i - 1, dynamic_cast<GradientOutputImageType *>(this->ProcessObject::GetOutput(i)));
+      continue;
     }
-    this->m_VectorGradientFilter->Update();
-    for (unsigned int i = 1; i < ImageDimension + 1; ++i)
+    bool filled = false;
+    switch (this->m_OutputLayout)
     {
-      this->GraftNthOutput(i, this->m_VectorGradientFilter->GetOutput(i - 1));
+      case TENSORIMAGE:
+        filled = idx == 0;
+        break;
+      case COMPONENTIMAGES:
+        filled = idx >= 1 && idx <= TensorComponents;
+        break;
+      case VOIGTIMAGE:
+        filled = idx == TensorComponents + 1;
+        break;
+    }
+    if (filled && !compact)
+    {
+      output->SetBufferedRegion(output->GetRequestedRegion());
+      output->Allocate();
+    }
+    else
+    {
+      // Release the buffer of a previous update.
+      output->Initialize();
     }
   }
-  else
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::SetUpOutputBuffers()
+{
+  if (this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput)
   {
-    this->m_InputComponentsFilter->SetInput(input);
+    this->m_OutputBuffers.SetTensors(nullptr, reinterpret_cast<TOutputValueType *>(this->m_MaskedTensors.data()));
+    return;
+  }
 
-    for (unsigned int i = 1; i < ImageDimension + 1; ++i)
+  switch (this->m_OutputLayout)
+  {
+    case TENSORIMAGE:
     {
-      this->m_GradientFilter->SetInput(this->m_InputComponentsFilter->GetOutput(i - 1));
-      this->m_GradientFilter->GraftOutput(dynamic_cast<GradientOutputImageType *>(this->ProcessObject::GetOutput(i)));
-      this->m_GradientFilter->Update();
-      this->GraftNthOutput(i, this->m_GradientFilter->GetOutput());
+      OutputImageType * output = this->GetOutput();
+      this->m_OutputBuffers.SetTensors(output, reinterpret_cast<TOutputValueType *>(output->GetBufferPointer()));
+      return;
     }
+    case COMPONENTIMAGES:
+    {
+      TOutputValueType * buffers[TensorComponents];
+      for (unsigned int k = 0; k < TensorComponents; ++k)
+      {
+        buffers[k] = this->GetComponentOutput(k)->GetBufferPointer();
+      }
+      this->m_OutputBuffers.SetComponents(this->GetComponentOutput(0), buffers);
+      return;
+    }
+    case VOIGTIMAGE:
+    {
+      VoigtImageType * output = this->GetVoigtOutput();
+      this->m_OutputBuffers.SetVoigt(output, output->GetBufferPointer());
+      return;
+    }
+    default:
+      itkExceptionMacro("Invalid OutputLayout!");
   }
+}
 
-  const StrainFormType strainForm = this->GetStrainForm();
-  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI)
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateData()
+{
+  if (this->GetMaskImage() == nullptr)
   {
-    itkExceptionMacro("Invalid StrainForm!");
+    Superclass::GenerateData();
+    return;
   }
 
-  OutputImageType * output = this->GetOutput();
-  output->FillBuffer(NumericTraits<OutputPixelType>::ZeroValue());
+  this->AllocateOutputs();
+  this->BeforeThreadedGenerateData();
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  const OutputRegionType & outputRegion = this->GetOutput()->GetRequestedRegion();
+  if (this->m_MaskRuns.GetNumberOfPixels() == 0)
+  {
+    // No mask pixel, the whole output is zero.
+    if (!this->m_CompactMaskedOutput)
+    {
+      this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+        outputRegion,
+        [this](const OutputRegionType & share) {
+          StrainDetail::ForEachScanline(share, [this, &share](const OutputIndexType & lineIndex) {
+            this->m_OutputBuffers.FillZero(lineIndex, share.GetSize(0));
+          });
+        },
+        this);
+    }
+  }
+  else if (this->m_FusedGradient || (!this->m_GradientImages.empty() && this->m_GradientImages[0].IsNotNull()))
+  {
+    this->ParallelizeLines(
+      outputRegion,
+      [this](const auto & forEachLine, SizeValueType maximumLineLength) {
+        this->GenerateLines(forEachLine, maximumLineLength);
+      },
+      this,
+      !this->m_CompactMaskedOutput);
+  }
+  this->AfterThreadedGenerateData();
 }
 
 template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
 void
-StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::DynamicThreadedGenerateData(
-  const OutputRegionType & region)
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::BeforeThreadedGenerateData()
 {
-  typename InputImageType::ConstPointer input = this->GetInput();
+  const StrainFormType strainForm = this->GetStrainForm();
+  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI &&
+      strainForm != HENCKY && strainForm != BIOT)
+  {
+    itkExceptionMacro("Invalid StrainForm!");
+  }
+  if (this->m_FusedGradient && this->m_FiniteDifferenceOrder != 2 && this->m_FiniteDifferenceOrder != 4 &&
+      this->m_FiniteDifferenceOrder != 6)
+  {
+    itkExceptionMacro("Invalid FiniteDifferenceOrder!");
+  }
+  if (this->m_OutputLayout != TENSORIMAGE && this->m_OutputLayout != COMPONENTIMAGES &&
+      this->m_OutputLayout != VOIGTIMAGE)
+  {
+    itkExceptionMacro("Invalid OutputLayout!");
+  }
+  if (this->GetInput()->GetNumberOfComponentsPerPixel() != ImageDimension)
+  {
+    itkExceptionMacro("The input must have ImageDimension components per pixel!");
+  }
+  std::fill(std::begin(this->m_StageStatistics), std::end(this->m_StageStatistics), StrainStageStatistics());
 
-  OutputImageType * output = this->GetOutput();
+  const OutputRegionType & outputRegion = this->GetOutput()->GetRequestedRegion();
+  OutputRegionType         gradientRegion = outputRegion;
 
-  ImageRegionIterator<OutputImageType> outputIt(output, region);
+  this->m_MaskRuns.Clear();
+  this->m_MaskedIndices.clear();
+  this->m_MaskedTensors.clear();
+  const MaskImageType * mask = this->GetMaskImage();
+  if (mask != nullptr)
+  {
+    this->m_MaskRuns.Compute(mask, outputRegion);
+    gradientRegion = this->m_MaskRuns.GetBoundingRegion();
+    if (this->m_CompactMaskedOutput)
+    {
+      this->m_MaskedIndices.reserve(this->m_MaskRuns.GetNumberOfPixels());
+      for (const auto & run : this->m_MaskRuns.GetRuns())
+      {
+        OutputIndexType index = run.Index;
+        for (SizeValueType n = 0; n < run.Length; ++n, ++index[0])
+        {
+          this->m_MaskedIndices.push_back(index);
+        }
+      }
+      this->m_MaskedTensors.resize(this->m_MaskRuns.GetNumberOfPixels());
+    }
+  }
+  this->SetUpOutputBuffers();
 
-  // e_ij += 1/2( du_i/dx_j + du_j/dx_i )
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+  if (this->m_FusedGradient || gradientRegion.GetNumberOfPixels() == 0)
+  {
+    // The gradients are computed and consumed in DynamicThreadedGenerateData,
+    // and every output pixel is written exactly once, or there are no mask
+    // pixels.
+    if (this->m_CollectStageStatistics)
+    {
+      this->m_StageStatistics[GRADIENT].Threads = this->m_FusedGradient ? this->GetNumberOfWorkUnits() : 0;
+      this->m_ThreadedStageTimer.Start();
+    }
+    return;
+  }
+
+  // The internal filters run on an image without a source that only spans
+  // the buffered input region, so that they never request more from the
+  // pipeline than GenerateInputRequestedRegion asked for.
+  typename InputImageType::Pointer input = InputImageType::New();
+  input->Graft(this->GetInput());
+
+  this->m_GradientImages.assign(ImageDimension, nullptr);
+
+  if (this->m_VectorGradientFilter.GetPointer() != nullptr)
+  {
+    this->m_VectorGradientFilter->SetInput(input);
+    this->m_VectorGradientFilter->GetOutput()->SetRequestedRegion(gradientRegion);
+    {
+      const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(GRADIENT));
+      this->m_VectorGradientFilter->Update();
+    }
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      this->m_GradientImages[i] = this->m_VectorGradientFilter->GetOutput(i);
+      this->m_GradientImages[i]->DisconnectPipeline();
+    }
+    if (this->m_CollectStageStatistics)
+    {
+      StrainStageStatistics & gradientStatistics = this->m_StageStatistics[GRADIENT];
+      gradientStatistics.Threads = this->m_VectorGradientFilter->GetNumberOfWorkUnits();
+      for (const auto & gradientImage : this->m_GradientImages)
+      {
+        gradientStatistics.BytesAllocated += StrainDetail::ImageBufferSize(gradientImage.GetPointer());
+      }
+    }
+  }
+  else if (this->m_ConcurrentGradients && !this->m_LowMemory)
   {
-    ImageRegionConstIterator<GradientOutputImageType> gradientIt(
-      reinterpret_cast<GradientOutputImageType *>(
-        dynamic_cast<GradientOutputImageType *>(this->ProcessObject::GetOutput(i + 1))),
-      region);
-    for (outputIt.GoToBegin(), gradientIt.GoToBegin(); !gradientIt.IsAtEnd(); ++outputIt, ++gradientIt)
+    this->ComputeConcurrentGradients(input, gradientRegion);
+  }
+  else
+  {
+    this->m_InputComponentsFilter->SetInput(input);
+
+    typename InputComponentsImageFilterType::ComponentsMaskType componentsMask;
+    componentsMask.Fill(true);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
     {
-      typename OutputImageType::PixelType outputPixel = outputIt.Get();
-      const GradientOutputPixelType       gradientPixel = gradientIt.Get();
-      for (unsigned int j = 0; j < i; ++j)
+      if (this->m_LowMemory)
       {
-        outputPixel(i, j) += gradientPixel[j] / static_cast<TOutputValueType>(2);
+        componentsMask.Fill(false);
+        componentsMask[i] = true;
       }
-      // j == i
-      outputPixel(i, i) += gradientPixel[i];
-      for (unsigned int j = i + 1; j < ImageDimension; ++j)
+      this->m_InputComponentsFilter->SetComponentsMask(componentsMask);
+
+      this->m_GradientFilter->SetInput(this->m_InputComponentsFilter->GetOutput(i));
+      this->m_GradientFilter->GetOutput()->SetRequestedRegion(gradientRegion);
+      if (this->m_CollectStageStatistics)
       {
-        outputPixel(i, j) += gradientPixel[j] / static_cast<TOutputValueType>(2);
+        // Update the split on its own, so that it is timed apart from the
+        // gradient, which then finds its input up to date.
+        {
+          const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(COMPONENTSPLIT));
+          GradientOutputImageType * gradientOutput = this->m_GradientFilter->GetOutput();
+          gradientOutput->UpdateOutputInformation();
+          gradientOutput->PropagateRequestedRegion();
+          this->m_InputComponentsFilter->GetOutput(i)->UpdateOutputData();
+        }
+        StrainStageStatistics & splitStatistics = this->m_StageStatistics[COMPONENTSPLIT];
+        splitStatistics.Threads = this->m_InputComponentsFilter->GetNumberOfWorkUnits();
+        splitStatistics.BytesAllocated += StrainDetail::ImageBufferSize(this->m_InputComponentsFilter->GetOutput(i));
       }
-      outputIt.Set(outputPixel);
+      {
+        const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(GRADIENT));
+        this->m_GradientFilter->Update();
+      }
+      typename GradientOutputImageType::Pointer gradientImage = this->m_GradientFilter->GetOutput();
+      gradientImage->DisconnectPipeline();
+      if (this->m_CollectStageStatistics)
+      {
+        StrainStageStatistics & gradientStatistics = this->m_StageStatistics[GRADIENT];
+        gradientStatistics.Threads = this->m_GradientFilter->GetNumberOfWorkUnits();
+        gradientStatistics.BytesAllocated += StrainDetail::ImageBufferSize(gradientImage.GetPointer());
+      }
+
+      if (this->m_LowMemory)
+      {
+        this->m_InputComponentsFilter->GetOutput(i)->ReleaseData();
+        const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(TENSORASSEMBLY));
+        this->ParallelizeLines(
+          outputRegion,
+          [this, i, &gradientImage](const auto & forEachLine, SizeValueType) {
+            this->AddComponentGradient(i, gradientImage.GetPointer(), forEachLine, i == 0);
+          },
+          nullptr,
+          i == 0 && !this->m_CompactMaskedOutput);
+      }
+      else
+      {
+        this->m_GradientImages[i] = gradientImage;
+      }
+    }
+
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      this->m_InputComponentsFilter->GetOutput(i)->ReleaseData();
     }
   }
-  switch (m_StrainForm)
+
+  if (this->m_CollectStageStatistics)
+  {
+    this->m_ThreadedStageTimer.Start();
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::DynamicThreadedGenerateData(
+  const OutputRegionType & region)
+{
+  if (!this->m_FusedGradient && (this->m_GradientImages.empty() || this->m_GradientImages[0].IsNull()))
   {
-    case INFINITESIMAL:
-      break;
-    // e_ij += 1/2 du_m/du_i du_m/du_j
-    case GREENLAGRANGIAN:
-      for (unsigned int i = 0; i < ImageDimension; ++i)
+    // LowMemory: the output was generated in BeforeThreadedGenerateData.
+    return;
+  }
+
+  this->GenerateLines(
+    [this, &region](const auto & lineFunction) { this->ForEachRegionLine(region, lineFunction); }, region.GetSize(0));
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+template <typename TLineFunction>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::ForEachRegionLine(
+  const OutputRegionType & region,
+  const TLineFunction &    lineFunction)
+{
+  // The output image may not be allocated, depending on the OutputLayout.
+  StrainDetail::ForEachScanline(region, [this, &region, &lineFunction](const OutputIndexType & lineIndex) {
+    lineFunction(lineIndex, region.GetSize(0), this->m_OutputBuffers.GetLine(lineIndex));
+  });
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+template <typename TGenerateLines>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::ParallelizeLines(
+  const OutputRegionType & region,
+  const TGenerateLines &   generateLines,
+  ProcessObject *          filter,
+  bool                     fillMaskGaps)
+{
+  if (this->GetMaskImage() == nullptr)
+  {
+    this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+      region,
+      [this, &generateLines](const OutputRegionType & share) {
+        generateLines([this, &share](const auto & lineFunction) { this->ForEachRegionLine(share, lineFunction); },
+                      share.GetSize(0));
+      },
+      filter);
+    return;
+  }
+
+  // The shares have equal numbers of mask pixels, and the runs that straddle
+  // two shares are split between them.
+  this->m_MaskRuns.ParallelizePixels(
+    this->GetMultiThreader(),
+    this->GetNumberOfWorkUnits(),
+    [this, &generateLines, fillMaskGaps](SizeValueType begin, SizeValueType end) {
+      if (fillMaskGaps)
+      {
+        this->m_MaskRuns.ForEachGap(begin, end, [this](OffsetValueType offset, SizeValueType length) {
+          this->m_OutputBuffers.FillZero(offset, length);
+        });
+      }
+      generateLines(
+        [this, begin, end](const auto & lineFunction) {
+          this->m_MaskRuns.ForEachRun(
+            begin,
+            end,
+            [this, &lineFunction](const OutputIndexType & lineIndex, SizeValueType lineLength, SizeValueType ordinal) {
+              lineFunction(lineIndex,
+                           lineLength,
+                           this->m_CompactMaskedOutput
+                             ? this->m_OutputBuffers.GetLine(static_cast<OffsetValueType>(ordinal))
+                             : this->m_OutputBuffers.GetLine(lineIndex));
+            });
+        },
+        this->m_MaskRuns.GetMaximumRunLength());
+    },
+    filter);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+template <typename TForEachLine>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateLines(const TForEachLine & forEachLine,
+                                                                                     SizeValueType maximumLineLength)
+{
+  // The gradients of each scanline are gathered into a structure of arrays,
+  // lineGradients[(i * ImageDimension + k) * lineLength + n] = du_i/dx_k,
+  // either by the fused stencil or by transposing the gradient images, and
+  // the tensors are assembled from them in SIMD batches.
+  std::vector<TOutputValueType> lineGradients(ImageDimension * ImageDimension * maximumLineLength);
+
+  // The fused stencil alternates with the assembly on every scanline, so the
+  // work unit reports the time of the stencil.
+  StrainDetail::WorkUnitStageTimer workUnitTimer(
+    this->m_CollectStageStatistics && this->m_FusedGradient ? &this->m_ThreadedStageTimer : nullptr);
+  double * const                   gradientSeconds = workUnitTimer.GetPartSeconds();
+
+  const bool knownStrainForm =
+    DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+      using BatchKernelType =
+        StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValueType>;
+
+      const auto generateLines = [&](const auto & computeLineGradients) {
+        forEachLine(
+          [&](const OutputIndexType & lineIndex, SizeValueType lineLength, const TensorLineType & lineTensors) {
+            computeLineGradients(lineIndex, lineLength);
+
+            const TOutputValueType * lineGradientComponents[ImageDimension * ImageDimension];
+            for (unsigned int k = 0; k < ImageDimension * ImageDimension; ++k)
+            {
+              lineGradientComponents[k] = lineGradients.data() + k * lineLength;
+            }
+            BatchKernelType::Compute(lineGradientComponents, lineTensors.Component, lineTensors.Stride, lineLength);
+          });
+      };
+
+      if (this->m_FusedGradient)
       {
-        ImageRegionConstIterator<GradientOutputImageType> gradientIt(
-          reinterpret_cast<GradientOutputImageType *>(
-            dynamic_cast<GradientOutputImageType *>(this->ProcessObject::GetOutput(i + 1))),
-          region);
-        for (outputIt.GoToBegin(), gradientIt.GoToBegin(); !gradientIt.IsAtEnd(); ++outputIt, ++gradientIt)
+        // Each order of accuracy has its own stencil, and scanline loop.
+        DispatchFiniteDifferenceOrder(this->m_FiniteDifferenceOrder, [&](auto order) {
+          const DisplacementGradientStencil<InputImageType, TOperatorValueType, decltype(order)::value> stencil(
+            this->GetInput());
+          generateLines([&](const OutputIndexType & lineIndex, SizeValueType lineLength) {
+            const StrainDetail::ScopedStageTimer timer(gradientSeconds);
+            stencil.ComputeLine(lineIndex, lineLength, lineGradients.data());
+          });
+        });
+        return;
+      }
+
+      generateLines([&](const OutputIndexType & lineIndex, SizeValueType lineLength) {
+        for (unsigned int i = 0; i < ImageDimension; ++i)
         {
-          typename OutputImageType::PixelType outputPixel = outputIt.Get();
-          const GradientOutputPixelType       gradientPixel = gradientIt.Get();
+          const GradientOutputImageType * gradientImage = this->m_GradientImages[i];
+          const GradientOutputPixelType * gradientLine =
+            gradientImage->GetBufferPointer() + gradientImage->ComputeOffset(lineIndex);
           for (unsigned int j = 0; j < ImageDimension; ++j)
           {
-            for (unsigned int k = 0; k <= j; ++k)
+            TOutputValueType * component = lineGradients.data() + (i * ImageDimension + j) * lineLength;
+            for (SizeValueType n = 0; n < lineLength; ++n)
             {
-              outputPixel(j, k) += gradientPixel[j] * gradientPixel[k] / static_cast<TOutputValueType>(2);
+              component[n] = static_cast<TOutputValueType>(gradientLine[n][j]);
             }
           }
-          outputIt.Set(outputPixel);
         }
-      }
-      break;
-    // e_ij -= 1/2 du_m/du_i du_m/du_j
-    case EULERIANALMANSI:
-      for (unsigned int i = 0; i < ImageDimension; ++i)
+      });
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AfterThreadedGenerateData()
+{
+  this->m_GradientImages.clear();
+  this->m_MaskRuns.Clear();
+
+  if (this->m_CollectStageStatistics)
+  {
+    this->m_ThreadedStageTimer.Stop(this->m_StageStatistics[GRADIENT], this->m_StageStatistics[TENSORASSEMBLY]);
+    StrainStageStatistics & assemblyStatistics = this->m_StageStatistics[TENSORASSEMBLY];
+    assemblyStatistics.Threads = this->GetNumberOfWorkUnits();
+    assemblyStatistics.BytesAllocated =
+      this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput
+        ? this->m_MaskedTensors.size() * sizeof(OutputPixelType)
+        : this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() * TensorComponents * sizeof(TOutputValueType);
+    for (unsigned int stage = 0; stage < NumberOfStages; ++stage)
+    {
+      const auto stageType = static_cast<StageType>(stage);
+      this->InvokeEvent(StrainStageEvent(stage, GetStageName(stageType), this->m_StageStatistics[stage]));
+    }
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::ComputeConcurrentGradients(
+  const InputImageType *   input,
+  const OutputRegionType & outputRegion)
+{
+  // The settings of a GradientFilter other than the default one cannot be
+  // copied, its Clone() only creates another instance.
+  std::vector<typename GradientFilterType::Pointer> gradientFilters(ImageDimension);
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    gradientFilters[i] = this->m_ComponentGradientFilters[i];
+    if (gradientFilters[i].IsNotNull())
+    {
+      continue;
+    }
+    if (i == 0)
+    {
+      gradientFilters[i] = this->m_GradientFilter;
+    }
+    else if (this->m_GradientFilter == this->m_DefaultGradientFilter)
+    {
+      using GradientImageFilterType = GradientImageFilter<OperatorImageType, TOperatorValueType, TOperatorValueType>;
+      gradientFilters[i] = GradientImageFilterType::New().GetPointer();
+    }
+    else
+    {
+      itkExceptionMacro("ConcurrentGradients needs the gradient filter of component "
+                        << i << ", see SetComponentGradientFilter(), with a GradientFilter other than the default.");
+    }
+  }
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    for (unsigned int j = 0; j < i; ++j)
+    {
+      if (gradientFilters[i] == gradientFilters[j])
       {
-        ImageRegionConstIterator<GradientOutputImageType> gradientIt(
-          reinterpret_cast<GradientOutputImageType *>(
-            dynamic_cast<GradientOutputImageType *>(this->ProcessObject::GetOutput(i + 1))),
-          region);
-        for (outputIt.GoToBegin(), gradientIt.GoToBegin(); !gradientIt.IsAtEnd(); ++outputIt, ++gradientIt)
+        itkExceptionMacro("Components " << j << " and " << i << " share the same gradient filter.");
+      }
+    }
+  }
+
+  typename InputComponentsImageFilterType::ComponentsMaskType componentsMask;
+  componentsMask.Fill(true);
+  this->m_InputComponentsFilter->SetComponentsMask(componentsMask);
+  this->m_InputComponentsFilter->SetInput(input);
+  this->m_InputComponentsFilter->GetOutput()->SetRequestedRegion(input->GetBufferedRegion());
+  {
+    const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(COMPONENTSPLIT));
+    this->m_InputComponentsFilter->Update();
+  }
+  if (this->m_CollectStageStatistics)
+  {
+    StrainStageStatistics & splitStatistics = this->m_StageStatistics[COMPONENTSPLIT];
+    splitStatistics.Threads = this->m_InputComponentsFilter->GetNumberOfWorkUnits();
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      splitStatistics.BytesAllocated += StrainDetail::ImageBufferSize(this->m_InputComponentsFilter->GetOutput(i));
+    }
+  }
+
+  // Each pipeline starts from its own image without a source, so that no
+  // filter is shared between the threads.
+  const ThreadIdType        workUnitsPerComponent = std::max(this->GetNumberOfWorkUnits() / ImageDimension, 1u);
+  std::vector<ThreadIdType> gradientFilterWorkUnits(ImageDimension);
+
+  std::vector<typename OperatorImageType::Pointer> componentImages(ImageDimension);
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    componentImages[i] = OperatorImageType::New();
+    componentImages[i]->Graft(this->m_InputComponentsFilter->GetOutput(i));
+    gradientFilters[i]->SetInput(componentImages[i]);
+    gradientFilterWorkUnits[i] = gradientFilters[i]->GetNumberOfWorkUnits();
+    gradientFilters[i]->SetNumberOfWorkUnits(workUnitsPerComponent);
+    gradientFilters[i]->GetOutput()->SetRequestedRegion(outputRegion);
+  }
+
+  std::vector<std::exception_ptr> exceptions(ImageDimension);
+  {
+    const StrainDetail::ScopedStageTimer timer(this->GetStageSeconds(GRADIENT));
+    std::vector<std::thread>             threads;
+    threads.reserve(ImageDimension);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      threads.emplace_back([&gradientFilters, &exceptions, i]() {
+        try
         {
-          typename OutputImageType::PixelType outputPixel = outputIt.Get();
-          const GradientOutputPixelType       gradientPixel = gradientIt.Get();
-          for (unsigned int j = 0; j < ImageDimension; ++j)
+          gradientFilters[i]->Update();
+        }
+        catch (...)
+        {
+          exceptions[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto & thread : threads)
+    {
+      thread.join();
+    }
+  }
+  // The component images share the buffers of the split outputs, and the
+  // gradient filters, or their internal filters, may hold them.  Both are
+  // released so that the buffers are freed before the tensor assembly.
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    gradientFilters[i]->SetNumberOfWorkUnits(gradientFilterWorkUnits[i]);
+    gradientFilters[i]->SetInput(nullptr);
+    componentImages[i]->ReleaseData();
+    this->m_InputComponentsFilter->GetOutput(i)->ReleaseData();
+  }
+  componentImages.clear();
+  for (const auto & exception : exceptions)
+  {
+    if (exception)
+    {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    this->m_GradientImages[i] = gradientFilters[i]->GetOutput();
+    this->m_GradientImages[i]->DisconnectPipeline();
+  }
+  if (this->m_CollectStageStatistics)
+  {
+    StrainStageStatistics & gradientStatistics = this->m_StageStatistics[GRADIENT];
+    gradientStatistics.Threads = ImageDimension * workUnitsPerComponent;
+    for (const auto & gradientImage : this->m_GradientImages)
+    {
+      gradientStatistics.BytesAllocated += StrainDetail::ImageBufferSize(gradientImage.GetPointer());
+    }
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+template <typename TForEachLine>
+void
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AddComponentGradient(
+  unsigned int                    component,
+  const GradientOutputImageType * gradientImage,
+  const TForEachLine &            forEachLine,
+  bool                            first)
+{
+  const bool last = component + 1 == ImageDimension;
+  const bool knownStrainForm = DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(
+    this->m_StrainForm, [component, gradientImage, &forEachLine, first, last](auto kernel) {
+      using KernelType = decltype(kernel);
+
+      forEachLine([&](const OutputIndexType & lineIndex, SizeValueType lineLength, const TensorLineType & lineTensors) {
+        const GradientOutputPixelType * gradientLine =
+          gradientImage->GetBufferPointer() + gradientImage->ComputeOffset(lineIndex);
+        for (SizeValueType n = 0; n < lineLength; ++n)
+        {
+          auto tensor = lineTensors.GetPixel(n);
+          if (first)
           {
-            for (unsigned int k = 0; k <= j; ++k)
-            {
-              outputPixel(j, k) -= gradientPixel[j] * gradientPixel[k] / static_cast<TOutputValueType>(2);
-            }
+            tensor.Fill(NumericTraits<TOutputValueType>::ZeroValue());
+          }
+          KernelType::AddComponent(component, gradientLine[n], tensor);
+          if (last)
+          {
+            KernelType::Finalize(tensor);
           }
-          outputIt.Set(outputPixel);
         }
-      }
-      break;
-    default:
-      itkExceptionMacro(<< "Unknown strain form.");
+      });
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+SizeValueType
+StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::ComputeIntermediateMemorySize(
+  const OutputRegionType & outputRegion) const
+{
+  if (this->GetInput() == nullptr)
+  {
+    itkExceptionMacro("Input image not set!");
   }
+
+  if (this->m_FusedGradient)
+  {
+    return 0;
+  }
+
+  // The gradient filters may enlarge their output beyond the requested
+  // region, e.g. to the largest possible region for the recursive Gaussian.
+  OutputRegionType      gradientRegion;
+  const InputRegionType inputRegion = this->ComputeInputRequestedRegion(outputRegion, &gradientRegion);
+
+  const SizeValueType gradientImageSize = gradientRegion.GetNumberOfPixels() * sizeof(GradientOutputPixelType);
+  if (this->m_VectorGradientFilter.GetPointer() != nullptr)
+  {
+    return ImageDimension * gradientImageSize;
+  }
+
+  const SizeValueType componentImageSize = inputRegion.GetNumberOfPixels() * sizeof(TOperatorValueType);
+  if (this->m_LowMemory)
+  {
+    return componentImageSize + gradientImageSize;
+  }
+  // All the components are split at once, and all the gradients are held
+  // until the strain is assembled.
+  return ImageDimension * (componentImageSize + gradientImageSize);
 }
 
 template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
@@ -193,6 +872,27 @@ StrainImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::PrintSelf(
 
   os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
      << std::endl;
+  os << indent << "FusedGradient: " << (m_FusedGradient ? "On" : "Off") << std::endl;
+  os << indent << "FiniteDifferenceOrder: " << m_FiniteDifferenceOrder << std::endl;
+  os << indent << "LowMemory: " << (m_LowMemory ? "On" : "Off") << std::endl;
+  os << indent << "ConcurrentGradients: " << (m_ConcurrentGradients ? "On" : "Off") << std::endl;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    os << indent << "ComponentGradientFilter[" << i << "]: ";
+    if (m_ComponentGradientFilters[i].IsNotNull())
+    {
+      os << std::endl;
+      m_ComponentGradientFilters[i]->Print(os, indent.GetNextIndent());
+    }
+    else
+    {
+      os << "(null)" << std::endl;
+    }
+  }
+  os << indent << "CompactMaskedOutput: " << (m_CompactMaskedOutput ? "On" : "Off") << std::endl;
+  os << indent << "OutputLayout: " << static_cast<typename NumericTraits<OutputLayoutType>::PrintType>(m_OutputLayout)
+     << std::endl;
+  os << indent << "CollectStageStatistics: " << (m_CollectStageStatistics ? "On" : "Off") << std::endl;
 }
 } // end namespace itk
 
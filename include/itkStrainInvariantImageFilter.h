@@ -0,0 +1,189 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainInvariantImageFilter_h
+#define itkStrainInvariantImageFilter_h
+
+#include "itkFixedArray.h"
+#include "itkImageToImageFilter.h"
+#include "itkSymmetricSecondRankTensor.h"
+
+namespace itk
+{
+
+/** \class StrainInvariantImageFilter
+ *
+ * \brief Generate scalar strain invariant images from a displacement field
+ * image.
+ *
+ * The strain tensor of each pixel is computed as with the FusedGradient of
+ * StrainImageFilter, i.e. with a central difference stencil of the
+ * FiniteDifferenceOrder that takes the image spacing and direction into
+ * account and a zero flux Neumann boundary condition, and is reduced to
+ * scalars in the same pass.  The strain tensor image is never allocated.
+ * There is one output per invariant:
+ *
+ * - VOLUMETRIC: the trace of the strain tensor.
+ * - EQUIVALENT: the von Mises equivalent strain, sqrt(2/3 e':e'), where e' is
+ *   the deviatoric strain, e - tr(e)/ImageDimension I.
+ * - MAXIMUMSHEAR: the maximum shear strain, (e_max - e_min)/2, where e_max
+ *   and e_min are the largest and the smallest principal strains, from the
+ *   closed form eigenvalues of SymmetricEigenKernel.
+ *
+ * Only the outputs selected in the InvariantsMask are allocated and computed.
+ *
+ * The GradientFilter and the VectorGradientFilter of StrainImageFilter are
+ * not available here, since the gradients are never stored.  To reduce the
+ * strain of smoothed gradients, e.g. of a recursive Gaussian, compute the
+ * strain tensor image with StrainImageFilter first.
+ *
+ * \tparam TInputImage An image of displacement vectors.
+ *
+ * \tparam TOperatorValueType The value type used in the derivative operator
+ * (defaults to float).
+ *
+ * \tparam TOutputValueType The pixel type of the output images (defaults to
+ * float).
+ *
+ * \sa StrainImageFilter
+ * \sa PrincipalStrainImageFilter
+ *
+ * \ingroup Strain
+ *
+ */
+template <typename TInputImage, typename TOperatorValueType = float, typename TOutputValueType = float>
+class StrainInvariantImageFilter
+  : public ImageToImageFilter<TInputImage, Image<TOutputValueType, TInputImage::ImageDimension>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(StrainInvariantImageFilter);
+
+  /** ImageDimension enumeration. */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  using InputImageType = TInputImage;
+  using OutputImageType = Image<TOutputValueType, ImageDimension>;
+  using OutputRegionType = typename OutputImageType::RegionType;
+  using TensorType = SymmetricSecondRankTensor<TOutputValueType, ImageDimension>;
+
+  /** Standard class type alias. */
+  using Self = StrainInvariantImageFilter;
+  using Superclass = ImageToImageFilter<InputImageType, OutputImageType>;
+
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(StrainInvariantImageFilter);
+
+  /** The invariants, with the index of their output. */
+  enum InvariantType
+  {
+    VOLUMETRIC = 0,
+    EQUIVALENT = 1,
+    MAXIMUMSHEAR = 2
+  };
+  static constexpr unsigned int NumberOfInvariants = 3;
+
+  using InvariantsMaskType = FixedArray<bool, NumberOfInvariants>;
+
+  /** Set/Get the invariants mask, indexed by InvariantType.  Only the
+   * invariants whose value in the mask is true are computed, and the other
+   * outputs are not allocated.  The default is all true. */
+  itkSetMacro(InvariantsMask, InvariantsMaskType);
+  itkGetConstReferenceMacro(InvariantsMask, InvariantsMaskType);
+
+  /** Get the output of an invariant. */
+  OutputImageType *
+  GetInvariantOutput(InvariantType invariant)
+  {
+    return this->GetOutput(invariant);
+  }
+  OutputImageType *
+  GetVolumetricStrainOutput()
+  {
+    return this->GetOutput(VOLUMETRIC);
+  }
+  OutputImageType *
+  GetEquivalentStrainOutput()
+  {
+    return this->GetOutput(EQUIVALENT);
+  }
+  OutputImageType *
+  GetMaximumShearStrainOutput()
+  {
+    return this->GetOutput(MAXIMUMSHEAR);
+  }
+
+  /** The strain forms of StrainImageFilter. */
+  enum StrainFormType
+  {
+    INFINITESIMAL = 0,
+    GREENLAGRANGIAN = 1,
+    EULERIANALMANSI = 2,
+    HENCKY = 3,
+    BIOT = 4
+  };
+
+  itkSetMacro(StrainForm, StrainFormType);
+  itkGetConstMacro(StrainForm, StrainFormType);
+
+  /** Order of accuracy of the central differences: 2, 4, or 6, as the
+   * FiniteDifferenceOrder of StrainImageFilter.  The input requested region is
+   * padded by half the order.  2 by default. */
+  itkSetMacro(FiniteDifferenceOrder, unsigned int);
+  itkGetConstMacro(FiniteDifferenceOrder, unsigned int);
+
+protected:
+  StrainInvariantImageFilter();
+
+  /** The input requested region is the output requested region padded by the
+   * radius of the stencil of the FiniteDifferenceOrder. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Do not allocate the outputs of the invariants that are not computed. */
+  void
+  AllocateOutputs() override;
+
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputRegionType & outputRegion) override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  InvariantsMaskType m_InvariantsMask;
+
+  StrainFormType m_StrainForm;
+
+  unsigned int m_FiniteDifferenceOrder{ 2 };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkStrainInvariantImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,221 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainInvariantImageFilter_hxx
+#define itkStrainInvariantImageFilter_hxx
+
+
+#include "itkDisplacementGradientStencil.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+#include "itkSymmetricEigenKernel.h"
+
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::StrainInvariantImageFilter()
+  : m_StrainForm(INFINITESIMAL)
+{
+  this->m_InvariantsMask.Fill(true);
+
+  this->SetNumberOfIndexedOutputs(NumberOfInvariants);
+
+  // ImageSource only does this for the first output.
+  for (unsigned int i = 1; i < NumberOfInvariants; ++i)
+  {
+    this->SetNthOutput(i, this->MakeOutput(i));
+  }
+
+  this->DynamicMultiThreadingOn();
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateInputRequestedRegion()
+{
+  // Call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input == nullptr)
+  {
+    return;
+  }
+
+  typename InputImageType::RegionType inputRegion = this->GetOutput()->GetRequestedRegion();
+  inputRegion.PadByRadius(this->m_FiniteDifferenceOrder / 2);
+  inputRegion.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(inputRegion);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AllocateOutputs()
+{
+  for (unsigned int i = 0; i < NumberOfInvariants; ++i)
+  {
+    OutputImageType * output = this->GetOutput(i);
+    if (output != nullptr && this->m_InvariantsMask[i])
+    {
+      output->SetBufferedRegion(output->GetRequestedRegion());
+      output->Allocate();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::BeforeThreadedGenerateData()
+{
+  const StrainFormType strainForm = this->GetStrainForm();
+  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI &&
+      strainForm != HENCKY && strainForm != BIOT)
+  {
+    itkExceptionMacro("Invalid StrainForm!");
+  }
+  if (this->m_FiniteDifferenceOrder != 2 && this->m_FiniteDifferenceOrder != 4 && this->m_FiniteDifferenceOrder != 6)
+  {
+    itkExceptionMacro("Invalid FiniteDifferenceOrder!");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::DynamicThreadedGenerateData(
+  const OutputRegionType & region)
+{
+  if (region.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  // Only the tensors of one scanline are held at a time.
+  const SizeValueType           lineLength = region.GetSize(0);
+  std::vector<TOutputValueType> lineGradients(ImageDimension * ImageDimension * lineLength);
+  const TOutputValueType *      lineGradientComponents[ImageDimension * ImageDimension];
+  for (unsigned int k = 0; k < ImageDimension * ImageDimension; ++k)
+  {
+    lineGradientComponents[k] = lineGradients.data() + k * lineLength;
+  }
+  std::vector<TensorType>       lineTensors(lineLength);
+  std::vector<TOutputValueType> lineEigenValues(this->m_InvariantsMask[MAXIMUMSHEAR] ? ImageDimension * lineLength : 0);
+
+  OutputImageType * outputs[NumberOfInvariants];
+  for (unsigned int i = 0; i < NumberOfInvariants; ++i)
+  {
+    outputs[i] = this->m_InvariantsMask[i] ? this->GetOutput(i) : nullptr;
+  }
+
+  // Each order of accuracy has its own stencil, and scanline loop.
+  bool knownStrainForm = false;
+  DispatchFiniteDifferenceOrder(this->m_FiniteDifferenceOrder, [&](auto order) {
+    const DisplacementGradientStencil<InputImageType, TOperatorValueType, decltype(order)::value> stencil(
+      this->GetInput());
+    knownStrainForm =
+      DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+        using BatchKernelType = StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValueType>;
+
+        // The first output may not be allocated, so the scanlines are walked
+        // without an image iterator.
+        typename OutputImageType::IndexType lineIndex = region.GetIndex();
+        const SizeValueType                 numberOfLines = region.GetNumberOfPixels() / lineLength;
+        for (SizeValueType line = 0; line < numberOfLines; ++line)
+        {
+          stencil.ComputeLine(lineIndex, lineLength, lineGradients.data());
+          BatchKernelType::Compute(
+            lineGradientComponents, reinterpret_cast<TOutputValueType *>(lineTensors.data()), lineLength);
+
+          TOutputValueType * lines[NumberOfInvariants];
+          for (unsigned int i = 0; i < NumberOfInvariants; ++i)
+          {
+            lines[i] = outputs[i] ? outputs[i]->GetBufferPointer() + outputs[i]->ComputeOffset(lineIndex) : nullptr;
+          }
+
+          for (SizeValueType n = 0; n < lineLength; ++n)
+          {
+            const TensorType & tensor = lineTensors[n];
+            const double       trace = tensor.GetTrace();
+            if (lines[VOLUMETRIC])
+            {
+              lines[VOLUMETRIC][n] = static_cast<TOutputValueType>(trace);
+            }
+            if (lines[EQUIVALENT])
+            {
+              // e':e' of the deviatoric strain, with the off diagonal
+              // components counted twice.
+              const double mean = trace / ImageDimension;
+              double       contraction = 0.0;
+              for (unsigned int i = 0; i < ImageDimension; ++i)
+              {
+                const double deviatoric = tensor(i, i) - mean;
+                contraction += deviatoric * deviatoric;
+                for (unsigned int j = i + 1; j < ImageDimension; ++j)
+                {
+                  contraction += 2.0 * tensor(i, j) * tensor(i, j);
+                }
+              }
+              lines[EQUIVALENT][n] = static_cast<TOutputValueType>(std::sqrt(2.0 / 3.0 * contraction));
+            }
+          }
+          if (lines[MAXIMUMSHEAR])
+          {
+            // The principal strains are sorted in ascending order.
+            SymmetricEigenKernel<ImageDimension, TOutputValueType>::ComputeEigenValues(
+              reinterpret_cast<const TOutputValueType *>(lineTensors.data()), lineEigenValues.data(), lineLength);
+            for (SizeValueType n = 0; n < lineLength; ++n)
+            {
+              const TOutputValueType * principalStrains = lineEigenValues.data() + n * ImageDimension;
+              lines[MAXIMUMSHEAR][n] =
+                static_cast<TOutputValueType>(0.5 * (principalStrains[ImageDimension - 1] - principalStrains[0]));
+            }
+          }
+          for (unsigned int j = 1; j < ImageDimension; ++j)
+          {
+            if (++lineIndex[j] < region.GetIndex(j) + static_cast<IndexValueType>(region.GetSize(j)))
+            {
+              break;
+            }
+            lineIndex[j] = region.GetIndex(j);
+          }
+        }
+      });
+  });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainInvariantImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::PrintSelf(std::ostream & os,
+                                                                                        Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "InvariantsMask: " << m_InvariantsMask << std::endl;
+  os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
+     << std::endl;
+  os << indent << "FiniteDifferenceOrder: " << m_FiniteDifferenceOrder << std::endl;
+}
+} // end namespace itk
+
+#endif
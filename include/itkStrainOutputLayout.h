@@ -0,0 +1,253 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainOutputLayout_h
+#define itkStrainOutputLayout_h
+
+#include "itkImageBase.h"
+#include "itkStrainTensorBatchKernel.h"
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Position of the (i, j) component of a symmetric tensor in Voigt order: the
+ * diagonal first, then the off-diagonal components from the last axes to the
+ * first, i.e. xx, yy, zz, yz, xz, xy in 3D, and xx, yy, xy in 2D. */
+constexpr unsigned int
+VoigtIndex(unsigned int i, unsigned int j, unsigned int dimension)
+{
+  return i == j  ? i
+         : i < j ? dimension + (dimension - 1) * dimension / 2 - j * (j + 1) / 2 + j - 1 - i
+                 : VoigtIndex(j, i, dimension);
+}
+
+/** Call function(lineIndex) with the index of the first pixel of each
+ * scanline of the region, in buffer order.  No image is read, so the lines
+ * of an output that is not allocated are visited too. */
+template <unsigned int VDimension, typename TFunction>
+void
+ForEachScanline(const ImageRegion<VDimension> & region, const TFunction & function)
+{
+  if (region.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+  Index<VDimension> lineIndex = region.GetIndex();
+  while (true)
+  {
+    function(lineIndex);
+    unsigned int axis = 1;
+    for (; axis < VDimension; ++axis)
+    {
+      if (++lineIndex[axis] < region.GetIndex(axis) + static_cast<IndexValueType>(region.GetSize(axis)))
+      {
+        break;
+      }
+      lineIndex[axis] = region.GetIndex(axis);
+    }
+    if (axis == VDimension)
+    {
+      return;
+    }
+  }
+}
+} // end namespace StrainDetail
+
+/** \class StrainTensorLine
+ *
+ * \brief Where the strain tensors of a scanline are written.
+ *
+ * The component c, in the storage order of SymmetricSecondRankTensor, of the
+ * pixel n is Component[c][n * Stride].  The tensors of an image of
+ * SymmetricSecondRankTensor are interleaved, with a stride of
+ * TensorComponents, while the planes of separate component images have a
+ * stride of 1.
+ *
+ * \ingroup Strain
+ */
+template <typename TValue, unsigned int VDimension>
+struct StrainTensorLine
+{
+  static constexpr unsigned int TensorComponents = VDimension * (VDimension + 1) / 2;
+
+  TValue *      Component[TensorComponents];
+  SizeValueType Stride;
+
+  /** Access to the tensor of a pixel through tensor(i, j), as
+   * StrainTensorKernel writes it. */
+  class PixelType
+  {
+  public:
+    PixelType(const StrainTensorLine & line, SizeValueType n)
+      : m_Line(line)
+      , m_Offset(n * line.Stride)
+    {}
+
+    TValue &
+    operator()(unsigned int i, unsigned int j) const
+    {
+      return m_Line.Component[StrainDetail::SymmetricTensorIndex(i, j, VDimension)][m_Offset];
+    }
+
+    void
+    Fill(TValue value) const
+    {
+      for (unsigned int c = 0; c < TensorComponents; ++c)
+      {
+        m_Line.Component[c][m_Offset] = value;
+      }
+    }
+
+  private:
+    const StrainTensorLine & m_Line;
+    SizeValueType            m_Offset;
+  };
+
+  PixelType
+  GetPixel(SizeValueType n) const
+  {
+    return PixelType(*this, n);
+  }
+
+  /** Write a SymmetricSecondRankTensor to the pixel n. */
+  template <typename TTensor>
+  void
+  SetPixel(SizeValueType n, const TTensor & tensor) const
+  {
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      Component[c][n * Stride] = static_cast<TValue>(tensor[c]);
+    }
+  }
+};
+
+/** \class StrainOutputBuffers
+ *
+ * \brief Buffers the strain tensors of a filter are written to, in one of the
+ * output layouts of StrainImageFilter and TransformToStrainFilter.
+ *
+ * The buffers all span the same region, so that the scanline that starts at
+ * an index has the same offset in all of them.  Set up before the threads
+ * start, and only read by them.
+ *
+ * \ingroup Strain
+ */
+template <typename TValue, unsigned int VDimension>
+class StrainOutputBuffers
+{
+public:
+  static constexpr unsigned int TensorComponents = VDimension * (VDimension + 1) / 2;
+
+  using LineType = StrainTensorLine<TValue, VDimension>;
+  using ImageBaseType = ImageBase<VDimension>;
+  using IndexType = Index<VDimension>;
+
+  /** Interleaved tensors, in the storage order of SymmetricSecondRankTensor,
+   * e.g. the buffer of a tensor image.  Without image, the offset of the
+   * lines is given directly to GetLine(). */
+  void
+  SetTensors(const ImageBaseType * image, TValue * buffer)
+  {
+    m_Image = image;
+    m_Stride = TensorComponents;
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      m_Buffers[c] = buffer + c;
+    }
+  }
+
+  /** One scalar buffer per component, in Voigt order. */
+  void
+  SetComponents(const ImageBaseType * image, TValue * const * voigtBuffers)
+  {
+    m_Image = image;
+    m_Stride = 1;
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      for (unsigned int j = i; j < VDimension; ++j)
+      {
+        m_Buffers[StrainDetail::SymmetricTensorIndex(i, j, VDimension)] =
+          voigtBuffers[StrainDetail::VoigtIndex(i, j, VDimension)];
+      }
+    }
+  }
+
+  /** Interleaved components in Voigt order, e.g. the buffer of a VectorImage
+   * with TensorComponents components per pixel. */
+  void
+  SetVoigt(const ImageBaseType * image, TValue * buffer)
+  {
+    m_Image = image;
+    m_Stride = TensorComponents;
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      for (unsigned int j = i; j < VDimension; ++j)
+      {
+        m_Buffers[StrainDetail::SymmetricTensorIndex(i, j, VDimension)] =
+          buffer + StrainDetail::VoigtIndex(i, j, VDimension);
+      }
+    }
+  }
+
+  /** The line that starts at the given pixel offset. */
+  LineType
+  GetLine(OffsetValueType offset) const
+  {
+    LineType line;
+    line.Stride = m_Stride;
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      line.Component[c] = m_Buffers[c] + offset * static_cast<OffsetValueType>(m_Stride);
+    }
+    return line;
+  }
+
+  /** The line that starts at the given index of the image. */
+  LineType
+  GetLine(const IndexType & index) const
+  {
+    return this->GetLine(m_Image->ComputeOffset(index));
+  }
+
+  /** Zero numberOfPixels pixels from the given pixel offset. */
+  void
+  FillZero(OffsetValueType offset, SizeValueType numberOfPixels) const
+  {
+    const LineType line = this->GetLine(offset);
+    for (SizeValueType n = 0; n < numberOfPixels; ++n)
+    {
+      line.GetPixel(n).Fill(TValue{ 0 });
+    }
+  }
+
+  /** Zero numberOfPixels pixels from the given index of the image. */
+  void
+  FillZero(const IndexType & index, SizeValueType numberOfPixels) const
+  {
+    this->FillZero(m_Image->ComputeOffset(index), numberOfPixels);
+  }
+
+private:
+  const ImageBaseType * m_Image{ nullptr };
+  TValue *              m_Buffers[TensorComponents]{};
+  SizeValueType         m_Stride{ TensorComponents };
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainPointEvaluator_h
+#define itkStrainPointEvaluator_h
+
+#include "itkMultiThreaderBase.h"
+#include "itkPointSet.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkTransform.h"
+
+namespace itk
+{
+
+/** \class StrainPointEvaluator
+ *
+ * \brief Evaluate the strain at arbitrary physical points.
+ *
+ * The strain is computed at the points of a container, e.g. the nodes of a
+ * mesh, without generating a strain image.  The displacement is given either
+ * by a displacement field image, or by a transform.
+ *
+ * With a DisplacementField, the displacement gradient is computed at the grid
+ * points of the cell that contains each point with the central difference
+ * stencil of StrainImageFilter::FusedGradient, and interpolated linearly, so
+ * that the result matches StrainImageFilter at the grid points.  Only the
+ * neighborhoods of the cells that hold points are read.  The points are
+ * sorted by cell in buffer order, so that neighbor points share their cell
+ * gradients and the field is read in order.  Points outside of the field get
+ * the gradient of the nearest position on its boundary.  A
+ * DisplacementFieldTransform as Transform is evaluated the same way from its
+ * field.
+ *
+ * With another Transform, the displacement gradient is the Jacobian of the
+ * transform with respect to the position minus the identity, given by
+ * ComputeJacobianWithRespectToPosition(), or, with UseNumericalJacobian, by
+ * central differences of TransformPoint(), e.g. for a BSplineTransform.
+ *
+ * The points are processed in batches on the threads of the MultiThreader,
+ * and the tensors of a batch are assembled by a StrainTensorBatchKernel.
+ *
+ * \tparam TDisplacementField The type of the displacement field image.
+ *
+ * \tparam TOperatorValueType The value type used in the derivative operator
+ * (defaults to float).
+ *
+ * \tparam TOutputValueType The value type of the strain tensors (defaults to
+ * float).
+ *
+ * \sa StrainImageFilter
+ * \sa TransformToStrainFilter
+ *
+ * \ingroup Strain
+ *
+ */
+template <typename TDisplacementField, typename TOperatorValueType = float, typename TOutputValueType = float>
+class StrainPointEvaluator : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(StrainPointEvaluator);
+
+  /** ImageDimension enumeration. */
+  static constexpr unsigned int ImageDimension = TDisplacementField::ImageDimension;
+
+  /** Standard class type alias. */
+  using Self = StrainPointEvaluator;
+  using Superclass = Object;
+
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  using DisplacementFieldType = TDisplacementField;
+  using TransformType = Transform<double, ImageDimension, ImageDimension>;
+  using InputPointType = typename TransformType::InputPointType;
+  using OutputPixelType = SymmetricSecondRankTensor<TOutputValueType, ImageDimension>;
+
+  /** Point set of the strain tensors at the evaluated points. */
+  using PointSetType = PointSet<OutputPixelType, ImageDimension>;
+  using PointsContainer = typename PointSetType::PointsContainer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(StrainPointEvaluator);
+
+  /** Displacement field image, used if set. */
+  itkSetConstObjectMacro(DisplacementField, DisplacementFieldType);
+  itkGetConstObjectMacro(DisplacementField, DisplacementFieldType);
+
+  /** Transform, used when no DisplacementField is set. */
+  itkSetConstObjectMacro(Transform, TransformType);
+  itkGetConstObjectMacro(Transform, TransformType);
+
+  /**
+   * Three different types of strains can be calculated, infinitesimal (default), aka
+   * engineering strain, which is appropriate for small strains, Green-Lagrangian,
+   * which uses a material reference system, and Eulerian-Almansi, which uses a
+   * spatial reference system.  This is set with SetStrainForm(). */
+  enum StrainFormType
+  {
+    INFINITESIMAL = 0,
+    GREENLAGRANGIAN = 1,
+    EULERIANALMANSI = 2
+  };
+
+  itkSetMacro(StrainForm, StrainFormType);
+  itkGetConstMacro(StrainForm, StrainFormType);
+
+  /** Approximate the Jacobian of the Transform by central differences of
+   * TransformPoint() along the physical axes, NumericalJacobianPhysicalStep
+   * away from each point, instead of calling
+   * ComputeJacobianWithRespectToPosition().  This does not apply to a
+   * DisplacementField or a DisplacementFieldTransform.  Off by default. */
+  itkSetMacro(UseNumericalJacobian, bool);
+  itkGetConstMacro(UseNumericalJacobian, bool);
+  itkBooleanMacro(UseNumericalJacobian);
+
+  /** Physical distance between each point and the points of the numerical
+   * Jacobian stencil.  Defaults to 1e-3.  Unlike the NumericalJacobianStep of
+   * TransformToStrainFilter, it is not a number of pixels. */
+  itkSetClampMacro(NumericalJacobianPhysicalStep, double, NumericTraits<double>::min(), NumericTraits<double>::max());
+  itkGetConstMacro(NumericalJacobianPhysicalStep, double);
+
+  /** Threader that processes the batches of points. */
+  itkSetObjectMacro(MultiThreader, MultiThreaderBase);
+  itkGetModifiableObjectMacro(MultiThreader, MultiThreaderBase);
+
+  /** Compute the strain at the count points, in strains[0] to
+   * strains[count - 1]. */
+  void
+  Evaluate(const InputPointType * points, SizeValueType count, OutputPixelType * strains) const;
+
+  /** Return a point set with the points of the container, and the strain at
+   * each of them as point data, with the same identifiers. */
+  typename PointSetType::Pointer
+  Evaluate(const PointsContainer * points) const;
+
+protected:
+  StrainPointEvaluator();
+  ~StrainPointEvaluator() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Number of points whose gradients are gathered before their tensors are
+   * assembled. */
+  static constexpr SizeValueType BatchSize = 256;
+
+  /** Evaluate the strain from the linearly interpolated stencil gradients of
+   * the field. */
+  template <typename TField>
+  void
+  EvaluateField(const TField * field, const InputPointType * points, SizeValueType count, OutputPixelType * strains)
+    const;
+
+  /** Evaluate the strain from the Jacobian of the transform. */
+  void
+  EvaluateTransform(const InputPointType * points, SizeValueType count, OutputPixelType * strains) const;
+
+  typename DisplacementFieldType::ConstPointer m_DisplacementField;
+
+  typename TransformType::ConstPointer m_Transform;
+
+  StrainFormType m_StrainForm;
+
+  bool m_UseNumericalJacobian{ false };
+
+  double m_NumericalJacobianPhysicalStep{ 1e-3 };
+
+  MultiThreaderBase::Pointer m_MultiThreader;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkStrainPointEvaluator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,378 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainPointEvaluator_hxx
+#define itkStrainPointEvaluator_hxx
+
+#include "itkContinuousIndex.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkDisplacementGradientStencil.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::StrainPointEvaluator()
+  : m_StrainForm(INFINITESIMAL)
+  , m_MultiThreader(MultiThreaderBase::New())
+{}
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::Evaluate(
+  const InputPointType * points,
+  SizeValueType          count,
+  OutputPixelType *      strains) const
+{
+  if (count == 0)
+  {
+    return;
+  }
+  if (this->m_DisplacementField.IsNotNull())
+  {
+    this->EvaluateField(this->m_DisplacementField.GetPointer(), points, count, strains);
+  }
+  else if (this->m_Transform.IsNotNull())
+  {
+    this->EvaluateTransform(points, count, strains);
+  }
+  else
+  {
+    itkExceptionMacro("Neither a displacement field nor a transform is available!");
+  }
+}
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+auto
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::Evaluate(
+  const PointsContainer * points) const -> typename PointSetType::Pointer
+{
+  if (points == nullptr)
+  {
+    itkExceptionMacro("Points not available!");
+  }
+
+  using PointIdentifier = typename PointSetType::PointIdentifier;
+  std::vector<PointIdentifier> identifiers;
+  std::vector<InputPointType>  inputPoints;
+  identifiers.reserve(points->Size());
+  inputPoints.reserve(points->Size());
+  auto outputPoints = PointsContainer::New();
+  for (auto pointIt = points->Begin(); pointIt != points->End(); ++pointIt)
+  {
+    identifiers.push_back(pointIt.Index());
+    inputPoints.emplace_back();
+    inputPoints.back().CastFrom(pointIt.Value());
+    outputPoints->InsertElement(pointIt.Index(), pointIt.Value());
+  }
+
+  std::vector<OutputPixelType> strains(inputPoints.size());
+  this->Evaluate(inputPoints.data(), inputPoints.size(), strains.data());
+
+  auto pointData = PointSetType::PointDataContainer::New();
+  for (size_t n = 0; n < identifiers.size(); ++n)
+  {
+    pointData->InsertElement(identifiers[n], strains[n]);
+  }
+
+  auto pointSet = PointSetType::New();
+  pointSet->SetPoints(outputPoints);
+  pointSet->SetPointData(pointData);
+  return pointSet;
+}
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+template <typename TField>
+void
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::EvaluateField(
+  const TField *         field,
+  const InputPointType * points,
+  SizeValueType          count,
+  OutputPixelType *      strains) const
+{
+  using FieldIndexType = typename TField::IndexType;
+  using ContinuousIndexType = ContinuousIndex<double, ImageDimension>;
+
+  // The gradients are interpolated between the stencil gradients at the
+  // corners of the cell of each point, so the cells must have two pixels
+  // along each axis.
+  const typename TField::RegionType & bufferedRegion = field->GetBufferedRegion();
+  const FieldIndexType                bufferedStart = bufferedRegion.GetIndex();
+  for (unsigned int j = 0; j < ImageDimension; ++j)
+  {
+    if (bufferedRegion.GetSize(j) < 2)
+    {
+      itkExceptionMacro("The displacement field must have at least two pixels along each axis!");
+    }
+  }
+
+  // First corner of the cell of a point, clamped to the buffered region, and
+  // the position of the point in the cell.
+  const auto locatePoint = [field, &bufferedRegion, &bufferedStart](const InputPointType & point,
+                                                                    FieldIndexType &       cellIndex,
+                                                                    double (&fraction)[ImageDimension]) {
+    ContinuousIndexType continuousIndex;
+    field->TransformPhysicalPointToContinuousIndex(point, continuousIndex);
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      const IndexValueType last = bufferedStart[j] + static_cast<IndexValueType>(bufferedRegion.GetSize(j)) - 2;
+      cellIndex[j] = std::clamp(static_cast<IndexValueType>(std::floor(continuousIndex[j])), bufferedStart[j], last);
+      fraction[j] = std::clamp(continuousIndex[j] - cellIndex[j], 0.0, 1.0);
+    }
+  };
+
+  const SizeValueType numberOfBatches = (count + BatchSize - 1) / BatchSize;
+
+  // Sort the points by the buffer offset of their cell, so that the points of
+  // a cell share its corner gradients, and the field is read in order.
+  struct CellPointType
+  {
+    OffsetValueType Offset;
+    SizeValueType   Ordinal;
+  };
+  std::vector<CellPointType> cellPoints(count);
+  this->m_MultiThreader->ParallelizeArray(
+    0,
+    numberOfBatches,
+    [&](SizeValueType batch) {
+      FieldIndexType cellIndex;
+      double         fraction[ImageDimension];
+      for (SizeValueType n = batch * BatchSize; n < std::min(count, (batch + 1) * BatchSize); ++n)
+      {
+        locatePoint(points[n], cellIndex, fraction);
+        cellPoints[n].Offset = field->ComputeOffset(cellIndex);
+        cellPoints[n].Ordinal = n;
+      }
+    },
+    nullptr);
+  std::sort(cellPoints.begin(), cellPoints.end(), [](const CellPointType & a, const CellPointType & b) {
+    return a.Offset < b.Offset || (a.Offset == b.Offset && a.Ordinal < b.Ordinal);
+  });
+
+  const DisplacementGradientStencil<TField, TOperatorValueType> stencil(field);
+
+  constexpr unsigned int GradientComponents = ImageDimension * ImageDimension;
+  constexpr unsigned int NumberOfCorners = 1u << ImageDimension;
+
+  const bool knownStrainForm =
+    DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+      using BatchKernelType =
+        StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValueType>;
+
+      this->m_MultiThreader->ParallelizeArray(
+        0,
+        numberOfBatches,
+        [&](SizeValueType batch) {
+          const SizeValueType first = batch * BatchSize;
+          const SizeValueType batchCount = std::min(count - first, BatchSize);
+
+          // Gradients of the batch as structure of arrays, with a stride of
+          // BatchSize.
+          std::vector<TOutputValueType> batchGradients(GradientComponents * BatchSize);
+          std::vector<OutputPixelType>  batchTensors(BatchSize);
+
+          // The corner gradients are computed by scanlines of two pixels along
+          // the first axis, for each corner along the other axes.
+          TOutputValueType cornerGradients[NumberOfCorners][GradientComponents];
+          TOutputValueType rowGradients[GradientComponents * 2];
+          OffsetValueType  cachedOffset = -1;
+
+          FieldIndexType cellIndex;
+          double         fraction[ImageDimension];
+          for (SizeValueType b = 0; b < batchCount; ++b)
+          {
+            const CellPointType & cellPoint = cellPoints[first + b];
+            locatePoint(points[cellPoint.Ordinal], cellIndex, fraction);
+            if (cellPoint.Offset != cachedOffset)
+            {
+              for (unsigned int row = 0; row < NumberOfCorners / 2; ++row)
+              {
+                FieldIndexType rowIndex = cellIndex;
+                for (unsigned int j = 1; j < ImageDimension; ++j)
+                {
+                  rowIndex[j] += (row >> (j - 1)) & 1u;
+                }
+                stencil.ComputeLine(rowIndex, 2, rowGradients);
+                for (unsigned int n = 0; n < 2; ++n)
+                {
+                  for (unsigned int c = 0; c < GradientComponents; ++c)
+                  {
+                    cornerGradients[(row << 1) | n][c] = rowGradients[c * 2 + n];
+                  }
+                }
+              }
+              cachedOffset = cellPoint.Offset;
+            }
+
+            for (unsigned int c = 0; c < GradientComponents; ++c)
+            {
+              batchGradients[c * BatchSize + b] = 0;
+            }
+            for (unsigned int corner = 0; corner < NumberOfCorners; ++corner)
+            {
+              double weight = 1.0;
+              for (unsigned int j = 0; j < ImageDimension; ++j)
+              {
+                weight *= (corner >> j) & 1u ? fraction[j] : 1.0 - fraction[j];
+              }
+              if (weight == 0.0)
+              {
+                continue;
+              }
+              for (unsigned int c = 0; c < GradientComponents; ++c)
+              {
+                batchGradients[c * BatchSize + b] += static_cast<TOutputValueType>(weight) * cornerGradients[corner][c];
+              }
+            }
+          }
+
+          const TOutputValueType * batchGradientComponents[GradientComponents];
+          for (unsigned int c = 0; c < GradientComponents; ++c)
+          {
+            batchGradientComponents[c] = batchGradients.data() + c * BatchSize;
+          }
+          BatchKernelType::Compute(
+            batchGradientComponents, reinterpret_cast<TOutputValueType *>(batchTensors.data()), batchCount);
+          for (SizeValueType b = 0; b < batchCount; ++b)
+          {
+            strains[cellPoints[first + b].Ordinal] = batchTensors[b];
+          }
+        },
+        nullptr);
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::EvaluateTransform(
+  const InputPointType * points,
+  SizeValueType          count,
+  OutputPixelType *      strains) const
+{
+  const TransformType * transform = this->m_Transform.GetPointer();
+
+  using DisplacementFieldTransformType = DisplacementFieldTransform<typename TransformType::ScalarType, ImageDimension>;
+  const auto * displacementFieldTransform = dynamic_cast<const DisplacementFieldTransformType *>(transform);
+  if (displacementFieldTransform != nullptr)
+  {
+    if (displacementFieldTransform->GetDisplacementField() == nullptr)
+    {
+      itkExceptionMacro("The DisplacementFieldTransform has no displacement field!");
+    }
+    this->EvaluateField(displacementFieldTransform->GetDisplacementField(), points, count, strains);
+    return;
+  }
+
+  constexpr unsigned int GradientComponents = ImageDimension * ImageDimension;
+  const SizeValueType    numberOfBatches = (count + BatchSize - 1) / BatchSize;
+  const bool             useNumericalJacobian = this->m_UseNumericalJacobian;
+  const double           step = this->m_NumericalJacobianPhysicalStep;
+
+  const bool knownStrainForm =
+    DispatchStrainTensorKernel<ImageDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+      using BatchKernelType =
+        StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValueType>;
+
+      this->m_MultiThreader->ParallelizeArray(
+        0,
+        numberOfBatches,
+        [&](SizeValueType batch) {
+          const SizeValueType first = batch * BatchSize;
+          const SizeValueType batchCount = std::min(count - first, BatchSize);
+
+          std::vector<TOutputValueType> batchGradients(GradientComponents * BatchSize);
+
+          typename TransformType::JacobianPositionType jacobian;
+          for (SizeValueType b = 0; b < batchCount; ++b)
+          {
+            const InputPointType & point = points[first + b];
+            if (useNumericalJacobian)
+            {
+              jacobian.set_size(ImageDimension, ImageDimension);
+              for (unsigned int k = 0; k < ImageDimension; ++k)
+              {
+                InputPointType forwardPoint = point;
+                InputPointType backwardPoint = point;
+                forwardPoint[k] += step;
+                backwardPoint[k] -= step;
+                const auto forward = transform->TransformPoint(forwardPoint);
+                const auto backward = transform->TransformPoint(backwardPoint);
+                for (unsigned int i = 0; i < ImageDimension; ++i)
+                {
+                  jacobian(i, k) = (forward[i] - backward[i]) / (2.0 * step);
+                }
+              }
+            }
+            else
+            {
+              transform->ComputeJacobianWithRespectToPosition(point, jacobian);
+            }
+            // Displacement gradient, du_i/dx_j = J_ij - delta_ij
+            for (unsigned int i = 0; i < ImageDimension; ++i)
+            {
+              for (unsigned int j = 0; j < ImageDimension; ++j)
+              {
+                batchGradients[(i * ImageDimension + j) * BatchSize + b] =
+                  static_cast<TOutputValueType>(i == j ? jacobian(i, j) - 1.0 : jacobian(i, j));
+              }
+            }
+          }
+
+          const TOutputValueType * batchGradientComponents[GradientComponents];
+          for (unsigned int c = 0; c < GradientComponents; ++c)
+          {
+            batchGradientComponents[c] = batchGradients.data() + c * BatchSize;
+          }
+          BatchKernelType::Compute(
+            batchGradientComponents, reinterpret_cast<TOutputValueType *>(strains + first), batchCount);
+        },
+        nullptr);
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TDisplacementField, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainPointEvaluator<TDisplacementField, TOperatorValueType, TOutputValueType>::PrintSelf(std::ostream & os,
+                                                                                        Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "DisplacementField: " << m_DisplacementField.GetPointer() << std::endl;
+  os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
+  os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
+     << std::endl;
+  os << indent << "UseNumericalJacobian: " << (m_UseNumericalJacobian ? "On" : "Off") << std::endl;
+  os << indent << "NumericalJacobianPhysicalStep: " << m_NumericalJacobianPhysicalStep << std::endl;
+  os << indent << "MultiThreader: " << m_MultiThreader.GetPointer() << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -0,0 +1,186 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainSequenceImageFilter_h
+#define itkStrainSequenceImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkSymmetricSecondRankTensor.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class StrainSequenceImageFilter
+ *
+ * \brief Generate the strain of every frame of a sequence of displacement
+ * fields, and optionally the strain rate.
+ *
+ * The input is an image of displacement Vectors with one more axis than the
+ * Vectors have components, e.g. a 3D+t cine sequence stored as a 4D image,
+ * whose last axis is time.  A list of frames can be stacked into such an
+ * image with itk::JoinSeriesImageFilter.  The direction of the input must not
+ * mix the time axis with the spatial axes, otherwise an exception is thrown.
+ * The strain of each frame is that of StrainImageFilter with FusedGradient:
+ * the displacement gradients are computed with a central difference stencil
+ * that reads the frames in place, in the spatial geometry of the input, and
+ * the tensors are assembled in the same pass by a StrainTensorBatchKernel.
+ * No frame, component, or gradient image is allocated, and the work units
+ * span all the frames of the requested region, so that frames are not
+ * processed one after the other.
+ *
+ * When ComputeStrainRate is enabled, the second output holds the time
+ * derivative of the strain, by central differences of the strain of the
+ * neighbor frames, or one-sided differences at the first and last frames.
+ * The frame interval is the spacing of the input along the time axis.  The
+ * output requested region is then enlarged by one frame on each side.  The
+ * strain rate output is otherwise not allocated.
+ *
+ * \tparam TInputImage An image of displacement vectors with
+ * ImageDimension - 1 components.
+ *
+ * \tparam TOperatorValueType The value type used in the derivative operator
+ * (defaults to float).
+ *
+ * \tparam TOutputValueType The value type of the strain tensors (defaults to
+ * float).
+ *
+ * \sa StrainImageFilter
+ *
+ * \ingroup Strain
+ *
+ */
+template <typename TInputImage, typename TOperatorValueType = float, typename TOutputValueType = float>
+class StrainSequenceImageFilter
+  : public ImageToImageFilter<
+      TInputImage,
+      Image<SymmetricSecondRankTensor<TOutputValueType, TInputImage::ImageDimension - 1>, TInputImage::ImageDimension>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(StrainSequenceImageFilter);
+
+  /** ImageDimension enumeration. */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  /** Dimension of the frames, and index of the time axis. */
+  static constexpr unsigned int FrameDimension = ImageDimension - 1;
+
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using OutputPixelType = SymmetricSecondRankTensor<TOutputValueType, FrameDimension>;
+  using OutputImageType = Image<OutputPixelType, ImageDimension>;
+  using OutputRegionType = typename OutputImageType::RegionType;
+
+  /** Displacement field of one frame, which shares the buffer of the input. */
+  using FrameImageType = Image<InputPixelType, FrameDimension>;
+
+  static_assert(InputPixelType::Dimension == FrameDimension,
+                "The displacement vectors must have one component less than the image dimension.");
+
+  /** Standard class type alias. */
+  using Self = StrainSequenceImageFilter;
+  using Superclass = ImageToImageFilter<InputImageType, OutputImageType>;
+
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(StrainSequenceImageFilter);
+
+  /** The strain forms of StrainImageFilter. */
+  enum StrainFormType
+  {
+    INFINITESIMAL = 0,
+    GREENLAGRANGIAN = 1,
+    EULERIANALMANSI = 2
+  };
+
+  itkSetMacro(StrainForm, StrainFormType);
+  itkGetConstMacro(StrainForm, StrainFormType);
+
+  /** Set/Get whether the strain rate output is computed.  Off by default. */
+  itkSetMacro(ComputeStrainRate, bool);
+  itkGetConstMacro(ComputeStrainRate, bool);
+  itkBooleanMacro(ComputeStrainRate);
+
+  /** Get the strain of each frame. */
+  OutputImageType *
+  GetStrainOutput()
+  {
+    return this->GetOutput(0);
+  }
+
+  /** Get the time derivative of the strain of each frame. */
+  OutputImageType *
+  GetStrainRateOutput()
+  {
+    return this->GetOutput(1);
+  }
+
+protected:
+  StrainSequenceImageFilter();
+
+  /** With ComputeStrainRate, the requested frames are padded by one frame on
+   * each side, so that the strain rate is a central difference. */
+  void
+  EnlargeOutputRequestedRegion(DataObject * output) override;
+
+  /** The input requested region is the output requested region padded by the
+   * radius of the stencil along the spatial axes. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Do not allocate the strain rate unless it is computed. */
+  void
+  AllocateOutputs() override;
+
+  /** Wrap each input frame into a FrameImageType. */
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputRegionType & outputRegion) override;
+
+  /** Compute the strain rate from the strain of all the frames, and release
+   * the frame images. */
+  void
+  AfterThreadedGenerateData() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  StrainFormType m_StrainForm;
+
+  bool m_ComputeStrainRate{ false };
+
+  /** Frames of the buffered region of the input, only held during the
+   * update. */
+  std::vector<typename FrameImageType::Pointer> m_Frames;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkStrainSequenceImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainSequenceImageFilter_hxx
+#define itkStrainSequenceImageFilter_hxx
+
+
+#include "itkDisplacementGradientStencil.h"
+#include "itkImageScanlineIterator.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+
+#include <vector>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::StrainSequenceImageFilter()
+  : m_StrainForm(INFINITESIMAL)
+{
+  this->SetNumberOfIndexedOutputs(2);
+
+  // ImageSource only does this for the first output.
+  this->SetNthOutput(1, this->MakeOutput(1));
+
+  this->DynamicMultiThreadingOn();
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::EnlargeOutputRequestedRegion(
+  DataObject * output)
+{
+  Superclass::EnlargeOutputRequestedRegion(output);
+
+  auto * outputImage = dynamic_cast<OutputImageType *>(output);
+  if (!this->m_ComputeStrainRate || outputImage == nullptr)
+  {
+    return;
+  }
+
+  OutputRegionType outputRegion = outputImage->GetRequestedRegion();
+  outputRegion.SetIndex(FrameDimension, outputRegion.GetIndex(FrameDimension) - 1);
+  outputRegion.SetSize(FrameDimension, outputRegion.GetSize(FrameDimension) + 2);
+  outputRegion.Crop(outputImage->GetLargestPossibleRegion());
+  outputImage->SetRequestedRegion(outputRegion);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::GenerateInputRequestedRegion()
+{
+  // Call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input == nullptr)
+  {
+    return;
+  }
+
+  // The frames are independent.
+  typename InputImageType::RegionType::SizeType radius;
+  radius.Fill(1);
+  radius[FrameDimension] = 0;
+
+  typename InputImageType::RegionType inputRegion = this->GetOutput()->GetRequestedRegion();
+  inputRegion.PadByRadius(radius);
+  inputRegion.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(inputRegion);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AllocateOutputs()
+{
+  const unsigned int numberOfOutputs = this->m_ComputeStrainRate ? 2 : 1;
+  for (unsigned int i = 0; i < numberOfOutputs; ++i)
+  {
+    OutputImageType * output = this->GetOutput(i);
+    if (output != nullptr)
+    {
+      output->SetBufferedRegion(output->GetRequestedRegion());
+      output->Allocate();
+    }
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::BeforeThreadedGenerateData()
+{
+  const StrainFormType strainForm = this->GetStrainForm();
+  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI)
+  {
+    itkExceptionMacro("Invalid StrainForm!");
+  }
+  if (this->m_ComputeStrainRate && this->GetOutput()->GetRequestedRegion().GetSize(FrameDimension) < 2)
+  {
+    itkExceptionMacro("The strain rate requires at least two frames!");
+  }
+
+  // The frames only have the spatial geometry of the input, so the time axis
+  // must not be mixed with the spatial axes.
+  const InputImageType *                         input = this->GetInput();
+  const typename InputImageType::DirectionType & direction = input->GetDirection();
+  for (unsigned int j = 0; j < FrameDimension; ++j)
+  {
+    if (direction[j][FrameDimension] != 0.0 || direction[FrameDimension][j] != 0.0)
+    {
+      itkExceptionMacro("The direction of the input mixes the time axis with the spatial axis " << j << '!');
+    }
+  }
+
+  // Each frame of the input buffer is a contiguous block of pixels, which a
+  // frame image imports without copying.
+  const typename InputImageType::RegionType & inputRegion = input->GetBufferedRegion();
+  typename FrameImageType::RegionType         frameRegion;
+  typename FrameImageType::SpacingType        frameSpacing;
+  typename FrameImageType::PointType          frameOrigin;
+  typename FrameImageType::DirectionType      frameDirection;
+  for (unsigned int j = 0; j < FrameDimension; ++j)
+  {
+    frameRegion.SetIndex(j, inputRegion.GetIndex(j));
+    frameRegion.SetSize(j, inputRegion.GetSize(j));
+    frameSpacing[j] = input->GetSpacing()[j];
+    frameOrigin[j] = input->GetOrigin()[j];
+    for (unsigned int k = 0; k < FrameDimension; ++k)
+    {
+      frameDirection[j][k] = direction[j][k];
+    }
+  }
+  const SizeValueType framePixels = frameRegion.GetNumberOfPixels();
+
+  auto * buffer = const_cast<InputPixelType *>(input->GetBufferPointer());
+  this->m_Frames.resize(inputRegion.GetSize(FrameDimension));
+  for (SizeValueType f = 0; f < this->m_Frames.size(); ++f)
+  {
+    auto frameContainer = FrameImageType::PixelContainer::New();
+    frameContainer->SetImportPointer(buffer + f * framePixels, framePixels, false);
+
+    auto frame = FrameImageType::New();
+    frame->SetRegions(frameRegion);
+    frame->SetSpacing(frameSpacing);
+    frame->SetOrigin(frameOrigin);
+    frame->SetDirection(frameDirection);
+    frame->SetPixelContainer(frameContainer);
+    this->m_Frames[f] = frame;
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::DynamicThreadedGenerateData(
+  const OutputRegionType & region)
+{
+  using StencilType = DisplacementGradientStencil<FrameImageType, TOperatorValueType>;
+  using FrameIndexType = typename FrameImageType::IndexType;
+
+  OutputImageType *    output = this->GetOutput();
+  const IndexValueType firstFrame = this->GetInput()->GetBufferedRegion().GetIndex(FrameDimension);
+
+  const SizeValueType           lineLength = region.GetSize(0);
+  std::vector<TOutputValueType> lineGradients(FrameDimension * FrameDimension * lineLength);
+  const TOutputValueType *      lineGradientComponents[FrameDimension * FrameDimension];
+  for (unsigned int k = 0; k < FrameDimension * FrameDimension; ++k)
+  {
+    lineGradientComponents[k] = lineGradients.data() + k * lineLength;
+  }
+
+  const bool knownStrainForm =
+    DispatchStrainTensorKernel<FrameDimension, TOutputValueType>(this->m_StrainForm, [&](auto kernel) {
+      using BatchKernelType =
+        StrainTensorBatchKernel<decltype(kernel)::StrainForm, FrameDimension, TOutputValueType>;
+
+      // The stencil is only rebuilt when a scanline is in another frame.
+      IndexValueType stencilFrame = region.GetIndex(FrameDimension);
+      StencilType    stencil(this->m_Frames[stencilFrame - firstFrame]);
+      FrameIndexType frameLineIndex;
+
+      ImageScanlineIterator<OutputImageType> outputIt(output, region);
+      while (!outputIt.IsAtEnd())
+      {
+        const typename OutputImageType::IndexType lineIndex = outputIt.GetIndex();
+        if (lineIndex[FrameDimension] != stencilFrame)
+        {
+          stencilFrame = lineIndex[FrameDimension];
+          stencil = StencilType(this->m_Frames[stencilFrame - firstFrame]);
+        }
+        for (unsigned int j = 0; j < FrameDimension; ++j)
+        {
+          frameLineIndex[j] = lineIndex[j];
+        }
+        stencil.ComputeLine(frameLineIndex, lineLength, lineGradients.data());
+        BatchKernelType::Compute(
+          lineGradientComponents, reinterpret_cast<TOutputValueType *>(&outputIt.Value()), lineLength);
+        outputIt.NextLine();
+      }
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::AfterThreadedGenerateData()
+{
+  this->m_Frames.clear();
+
+  if (!this->m_ComputeStrainRate)
+  {
+    return;
+  }
+
+  // The strain of every frame is available, so the strain rate is computed in
+  // a second pass over the output.
+  const OutputImageType *  strain = this->GetOutput(0);
+  OutputImageType *        strainRate = this->GetOutput(1);
+  const OutputRegionType & strainRegion = strain->GetBufferedRegion();
+  const IndexValueType     firstFrame = strainRegion.GetIndex(FrameDimension);
+  const IndexValueType     lastFrame = strainRegion.GetUpperIndex()[FrameDimension];
+  const OffsetValueType    frameOffset = strain->GetOffsetTable()[FrameDimension];
+  const double             frameInterval = this->GetInput()->GetSpacing()[FrameDimension];
+
+  this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+    strainRate->GetRequestedRegion(),
+    [&](const OutputRegionType & region) {
+      const SizeValueType                    lineLength = region.GetSize(0);
+      ImageScanlineIterator<OutputImageType> strainRateIt(strainRate, region);
+      while (!strainRateIt.IsAtEnd())
+      {
+        const typename OutputImageType::IndexType lineIndex = strainRateIt.GetIndex();
+        const IndexValueType                      frame = lineIndex[FrameDimension];
+
+        // Central differences, or one-sided differences at the first and last
+        // frames.
+        const OutputPixelType * center = strain->GetBufferPointer() + strain->ComputeOffset(lineIndex);
+        const OutputPixelType * previous = frame > firstFrame ? center - frameOffset : center;
+        const OutputPixelType * next = frame < lastFrame ? center + frameOffset : center;
+        const auto              scale =
+          static_cast<TOutputValueType>(1.0 / (static_cast<double>((next - previous) / frameOffset) * frameInterval));
+
+        OutputPixelType * lineStrainRates = &strainRateIt.Value();
+        for (SizeValueType n = 0; n < lineLength; ++n)
+        {
+          for (unsigned int c = 0; c < OutputPixelType::InternalDimension; ++c)
+          {
+            lineStrainRates[n][c] = (next[n][c] - previous[n][c]) * scale;
+          }
+        }
+        strainRateIt.NextLine();
+      }
+    },
+    nullptr);
+}
+
+template <typename TInputImage, typename TOperatorValueType, typename TOutputValueType>
+void
+StrainSequenceImageFilter<TInputImage, TOperatorValueType, TOutputValueType>::PrintSelf(std::ostream & os,
+                                                                                       Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
+     << std::endl;
+  os << indent << "ComputeStrainRate: " << (m_ComputeStrainRate ? "On" : "Off") << std::endl;
+}
+} // end namespace itk
+
+#endif
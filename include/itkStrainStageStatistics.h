@@ -0,0 +1,376 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainStageStatistics_h
+#define itkStrainStageStatistics_h
+
+#include "itkEventObject.h"
+#include "itkIntTypes.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+
+namespace itk
+{
+
+/** \class StrainStageStatistics
+ *
+ * \brief Wall time, allocated bytes, and threads of one stage of the last
+ * update of a strain filter.
+ *
+ * Collected by StrainImageFilter and TransformToStrainFilter when
+ * CollectStageStatistics is on.
+ *
+ * \ingroup Strain
+ */
+struct StrainStageStatistics
+{
+  /** Wall time of the stage, in seconds.  The wall time of a threaded section
+   * in which two stages alternate on every scanline is shared between them
+   * in proportion to the time the work units spent in each. */
+  double WallTime{ 0.0 };
+
+  /** Bytes of the images and lists the stage allocated.  The scanline
+   * buffers of the work units are not included. */
+  SizeValueType BytesAllocated{ 0 };
+
+  /** Number of work units the stage was split into, zero when it did not
+   * run. */
+  ThreadIdType Threads{ 0 };
+};
+
+inline std::ostream &
+operator<<(std::ostream & os, const StrainStageStatistics & statistics)
+{
+  return os << "[WallTime: " << statistics.WallTime << " s, BytesAllocated: " << statistics.BytesAllocated
+            << ", Threads: " << statistics.Threads << ']';
+}
+
+/** \class StrainStageEvent
+ *
+ * \brief Event invoked by a strain filter at the end of an update, once per
+ * stage, when CollectStageStatistics is on.
+ *
+ * GetStage() is the value of the StageType enumeration of the filter.
+ *
+ * \ingroup Strain
+ */
+class StrainStageEvent : public AnyEvent
+{
+public:
+  using Self = StrainStageEvent;
+  using Superclass = AnyEvent;
+
+  StrainStageEvent() = default;
+
+  StrainStageEvent(unsigned int stage, const char * stageName, const StrainStageStatistics & statistics)
+    : m_Stage(stage)
+    , m_StageName(stageName)
+    , m_Statistics(statistics)
+  {}
+
+  StrainStageEvent(const Self &) = default;
+  void
+  operator=(const Self &) = delete;
+  ~StrainStageEvent() override = default;
+
+  const char *
+  GetEventName() const override
+  {
+    return "StrainStageEvent";
+  }
+
+  bool
+  CheckEvent(const EventObject * e) const override
+  {
+    return dynamic_cast<const Self *>(e) != nullptr;
+  }
+
+  EventObject *
+  MakeObject() const override
+  {
+    return new Self;
+  }
+
+  unsigned int
+  GetStage() const
+  {
+    return m_Stage;
+  }
+
+  const char *
+  GetStageName() const
+  {
+    return m_StageName;
+  }
+
+  const StrainStageStatistics &
+  GetStatistics() const
+  {
+    return m_Statistics;
+  }
+
+private:
+  unsigned int          m_Stage{ 0 };
+  const char *          m_StageName{ "" };
+  StrainStageStatistics m_Statistics{};
+};
+
+namespace StrainDetail
+{
+using StageClock = std::chrono::steady_clock;
+
+inline double
+ElapsedSeconds(StageClock::time_point start)
+{
+  return std::chrono::duration<double>(StageClock::now() - start).count();
+}
+
+/** Bytes of the pixel buffer of an image, zero when it is not allocated. */
+template <typename TImage>
+SizeValueType
+ImageBufferSize(const TImage * image)
+{
+  const auto * container = image->GetPixelContainer();
+  return container == nullptr ? 0 : container->Size() * sizeof(typename TImage::PixelContainer::Element);
+}
+
+/** Add the wall time of a scope to *seconds.  Nothing is measured when
+ * seconds is null, i.e. when the statistics are not collected. */
+class ScopedStageTimer
+{
+public:
+  explicit ScopedStageTimer(double * seconds)
+    : m_Seconds(seconds)
+  {
+    if (m_Seconds != nullptr)
+    {
+      m_Start = StageClock::now();
+    }
+  }
+
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &
+  operator=(const ScopedStageTimer &) = delete;
+
+  ~ScopedStageTimer()
+  {
+    if (m_Seconds != nullptr)
+    {
+      *m_Seconds += ElapsedSeconds(m_Start);
+    }
+  }
+
+private:
+  double *               m_Seconds;
+  StageClock::time_point m_Start{};
+};
+
+/** Wall time of a threaded section in which the work units alternate between
+ * two stages, a timed part and the rest.  The work units report their total
+ * time and the time of the part, and the wall time of the section is shared
+ * in proportion. */
+class SharedStageTimer
+{
+public:
+  void
+  Start()
+  {
+    m_Start = StageClock::now();
+    m_Seconds = 0.0;
+    m_PartSeconds = 0.0;
+  }
+
+  void
+  AddWorkUnit(double seconds, double partSeconds)
+  {
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Seconds += seconds;
+    m_PartSeconds += partSeconds;
+  }
+
+  void
+  Stop(StrainStageStatistics & part, StrainStageStatistics & rest) const
+  {
+    const double wallTime = ElapsedSeconds(m_Start);
+    const double share = m_Seconds > 0.0 ? std::min(m_PartSeconds / m_Seconds, 1.0) : 0.0;
+    part.WallTime += share * wallTime;
+    rest.WallTime += (1.0 - share) * wallTime;
+  }
+
+private:
+  std::mutex             m_Mutex;
+  StageClock::time_point m_Start{};
+  double                 m_Seconds{ 0.0 };
+  double                 m_PartSeconds{ 0.0 };
+};
+
+/** Time a work unit of a SharedStageTimer, when it is not null.  The time of
+ * the part is added to *GetPartSeconds(). */
+class WorkUnitStageTimer
+{
+public:
+  explicit WorkUnitStageTimer(SharedStageTimer * sharedTimer)
+    : m_SharedTimer(sharedTimer)
+  {
+    if (m_SharedTimer != nullptr)
+    {
+      m_Start = StageClock::now();
+    }
+  }
+
+  WorkUnitStageTimer(const WorkUnitStageTimer &) = delete;
+  WorkUnitStageTimer &
+  operator=(const WorkUnitStageTimer &) = delete;
+
+  ~WorkUnitStageTimer()
+  {
+    if (m_SharedTimer != nullptr)
+    {
+      m_SharedTimer->AddWorkUnit(ElapsedSeconds(m_Start), m_PartSeconds);
+    }
+  }
+
+  /** Null when the work unit is not timed. */
+  double *
+  GetPartSeconds()
+  {
+    return m_SharedTimer != nullptr ? &m_PartSeconds : nullptr;
+  }
+
+private:
+  SharedStageTimer *     m_SharedTimer;
+  StageClock::time_point m_Start{};
+  double                 m_PartSeconds{ 0.0 };
+};
+
+/** A StrainTensorKernel whose Compute() only records the gradient and where
+ * the tensor goes, and assembles the recorded tensors in batches, so that
+ * the time of the assembly is measured apart from the computation of the
+ * gradients it is interleaved with.  The gradients are stored with the value
+ * type the kernel converts them to, so the tensors are the same as those of
+ * the kernel.  The last batch is assembled by the destructor. */
+template <typename TKernel>
+class DeferredStrainTensorKernel
+{
+public:
+  static constexpr unsigned int StrainForm = TKernel::StrainForm;
+  static constexpr unsigned int Dimension = TKernel::Dimension;
+  static constexpr unsigned int TensorComponents = Dimension * (Dimension + 1) / 2;
+  static constexpr unsigned int BatchSize = 64;
+  using ValueType = typename TKernel::ValueType;
+
+  explicit DeferredStrainTensorKernel(double & assemblySeconds)
+    : m_AssemblySeconds(assemblySeconds)
+  {}
+
+  DeferredStrainTensorKernel(const DeferredStrainTensorKernel &) = delete;
+  DeferredStrainTensorKernel &
+  operator=(const DeferredStrainTensorKernel &) = delete;
+
+  ~DeferredStrainTensorKernel() { this->Flush(); }
+
+  template <typename TGradient, typename TTensor>
+  void
+  Compute(const TGradient & gradient, TTensor & tensor)
+  {
+    Record & record = m_Records[m_Count];
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        record.Gradient[i][j] = static_cast<ValueType>(gradient[i][j]);
+      }
+      for (unsigned int j = i; j < Dimension; ++j)
+      {
+        record.Tensor[SymmetricTensorIndex(i, j, Dimension)] = &tensor(i, j);
+      }
+    }
+    if (++m_Count == BatchSize)
+    {
+      this->Flush();
+    }
+  }
+
+  void
+  Flush()
+  {
+    if (m_Count == 0)
+    {
+      return;
+    }
+    const StageClock::time_point start = StageClock::now();
+    for (unsigned int r = 0; r < m_Count; ++r)
+    {
+      TensorReference tensor{ m_Records[r].Tensor };
+      TKernel::Compute(m_Records[r].Gradient, tensor);
+    }
+    m_Count = 0;
+    m_AssemblySeconds += ElapsedSeconds(start);
+  }
+
+private:
+  struct Record
+  {
+    ValueType   Gradient[Dimension][Dimension];
+    ValueType * Tensor[TensorComponents];
+  };
+
+  struct TensorReference
+  {
+    ValueType * const * Components;
+
+    ValueType &
+    operator()(unsigned int i, unsigned int j) const
+    {
+      return *Components[SymmetricTensorIndex(i, j, Dimension)];
+    }
+  };
+
+  double &     m_AssemblySeconds;
+  Record       m_Records[BatchSize];
+  unsigned int m_Count{ 0 };
+};
+} // end namespace StrainDetail
+
+/** As DispatchStrainTensorKernel, but when assemblySeconds is not null, the
+ * functor is called with a DeferredStrainTensorKernel that adds the time of
+ * the assembly to *assemblySeconds.  The functor must take the kernel by
+ * reference, and call its Compute() method. */
+template <unsigned int VDimension, typename TValue, typename TFunctor>
+inline bool
+DispatchTimedStrainTensorKernel(unsigned int strainForm, double * assemblySeconds, TFunctor && functor)
+{
+  return DispatchStrainTensorKernel<VDimension, TValue>(strainForm, [assemblySeconds, &functor](auto kernel) {
+    if (assemblySeconds == nullptr)
+    {
+      functor(kernel);
+      return;
+    }
+    // The last batch is assembled when the kernel is destroyed, after the
+    // functor returns.
+    StrainDetail::DeferredStrainTensorKernel<decltype(kernel)> deferredKernel(*assemblySeconds);
+    functor(deferredKernel);
+  });
+}
+} // end namespace itk
+
+#endif
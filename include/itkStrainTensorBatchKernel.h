@@ -0,0 +1,397 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainTensorBatchKernel_h
+#define itkStrainTensorBatchKernel_h
+
+#include "itkIntTypes.h"
+#include "itkStrainTensorKernel.h"
+#include "itkSymmetricEigenKernel.h"
+
+#include <algorithm>
+#include <cstring>
+
+// GCC and Clang vector extensions give portable SIMD lanes, and on x86 the
+// wider lanes are compiled with function target attributes and selected at
+// run time, so the module does not require any architecture flag.
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER)
+#  define ITK_STRAIN_VECTOR_EXTENSIONS
+#  define ITK_STRAIN_ALWAYS_INLINE inline __attribute__((always_inline))
+#  if defined(__x86_64__) || defined(__i386__)
+#    define ITK_STRAIN_X86_VECTOR_EXTENSIONS
+#  endif
+#else
+#  define ITK_STRAIN_ALWAYS_INLINE inline
+#endif
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Assemble the strain tensors of one block of lanes.  TLane is either a
+ * scalar, or a vector extension type whose arithmetic applies to every lane.
+ * Plain loops with constant bounds are used instead of lambdas, so that
+ * nothing is called out of the target specific functions this is inlined in. */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue, typename TLane>
+ITK_STRAIN_ALWAYS_INLINE void
+ComputeStrainTensorLanes(const TLane (&gradient)[VDimension][VDimension],
+                         TLane (&tensor)[VDimension * (VDimension + 1) / 2])
+{
+  const TValue half = 0.5;
+  for (unsigned int i = 0; i < VDimension; ++i)
+  {
+    for (unsigned int j = 0; j <= i; ++j)
+    {
+      TLane value = (gradient[i][j] + gradient[j][i]) * half;
+      if constexpr (VStrainForm != 0)
+      {
+        TLane quadratic = gradient[0][i] * gradient[0][j];
+        for (unsigned int m = 1; m < VDimension; ++m)
+        {
+          quadratic += gradient[m][i] * gradient[m][j];
+        }
+        if constexpr (VStrainForm == 1)
+        {
+          value += quadratic * half;
+        }
+        else
+        {
+          value -= quadratic * half;
+        }
+      }
+      tensor[SymmetricTensorIndex(i, j, VDimension)] = value;
+    }
+  }
+}
+
+/** Assemble count tensors from structure of arrays gradients, VLanes voxels at
+ * a time, and write the component c of the voxel n to tensor[c][n * stride].
+ * The last, partial block is padded with zeros, so that every voxel goes
+ * through the same instructions whatever its position in the batch. */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue, typename TLane, unsigned int VLanes>
+ITK_STRAIN_ALWAYS_INLINE void
+ComputeStrainTensorBatch(const TValue * const * gradient,
+                         TValue * const *       tensor,
+                         SizeValueType          stride,
+                         SizeValueType          count)
+{
+  constexpr unsigned int TensorComponents = VDimension * (VDimension + 1) / 2;
+
+  TLane gradientLanes[VDimension][VDimension];
+  TLane tensorLanes[TensorComponents];
+  for (SizeValueType n = 0; n < count; n += VLanes)
+  {
+    const unsigned int lanes = count - n < VLanes ? static_cast<unsigned int>(count - n) : VLanes;
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      for (unsigned int j = 0; j < VDimension; ++j)
+      {
+        if (lanes == VLanes)
+        {
+          std::memcpy(&gradientLanes[i][j], gradient[i * VDimension + j] + n, sizeof(TLane));
+        }
+        else
+        {
+          TValue padded[VLanes] = {};
+          std::memcpy(padded, gradient[i * VDimension + j] + n, lanes * sizeof(TValue));
+          std::memcpy(&gradientLanes[i][j], padded, sizeof(TLane));
+        }
+      }
+    }
+
+    ComputeStrainTensorLanes<VStrainForm, VDimension, TValue>(gradientLanes, tensorLanes);
+
+    if (stride == 1 && lanes == VLanes)
+    {
+      // Separate component planes take whole vectors.
+      for (unsigned int c = 0; c < TensorComponents; ++c)
+      {
+        std::memcpy(tensor[c] + n, &tensorLanes[c], sizeof(TLane));
+      }
+      continue;
+    }
+    for (unsigned int w = 0; w < lanes; ++w)
+    {
+      const SizeValueType offset = (n + w) * stride;
+      for (unsigned int c = 0; c < TensorComponents; ++c)
+      {
+        if constexpr (VLanes == 1)
+        {
+          tensor[c][offset] = tensorLanes[c];
+        }
+        else
+        {
+          tensor[c][offset] = tensorLanes[c][w];
+        }
+      }
+    }
+  }
+}
+
+#if defined(ITK_STRAIN_VECTOR_EXTENSIONS)
+template <typename TValue, unsigned int VBytes>
+struct StrainVectorLane
+{
+  static constexpr unsigned int Lanes = VBytes / sizeof(TValue);
+  typedef TValue Type __attribute__((vector_size(VBytes)));
+};
+
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+void
+ComputeStrainTensorBatch128(const TValue * const * gradient,
+                            TValue * const *       tensor,
+                            SizeValueType          stride,
+                            SizeValueType          count)
+{
+  using LaneType = StrainVectorLane<TValue, 16>;
+  ComputeStrainTensorBatch<VStrainForm, VDimension, TValue, typename LaneType::Type, LaneType::Lanes>(
+    gradient, tensor, stride, count);
+}
+#endif
+
+#if defined(ITK_STRAIN_X86_VECTOR_EXTENSIONS)
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+__attribute__((target("avx2,fma"))) void
+ComputeStrainTensorBatchAVX2(const TValue * const * gradient,
+                             TValue * const *       tensor,
+                             SizeValueType          stride,
+                             SizeValueType          count)
+{
+  using LaneType = StrainVectorLane<TValue, 32>;
+  ComputeStrainTensorBatch<VStrainForm, VDimension, TValue, typename LaneType::Type, LaneType::Lanes>(
+    gradient, tensor, stride, count);
+}
+
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+__attribute__((target("avx512f"))) void
+ComputeStrainTensorBatchAVX512(const TValue * const * gradient,
+                               TValue * const *       tensor,
+                               SizeValueType          stride,
+                               SizeValueType          count)
+{
+  using LaneType = StrainVectorLane<TValue, 64>;
+  ComputeStrainTensorBatch<VStrainForm, VDimension, TValue, typename LaneType::Type, LaneType::Lanes>(
+    gradient, tensor, stride, count);
+}
+#endif
+} // end namespace StrainDetail
+
+/** \class StrainTensorBatchKernelBase
+ *
+ * \brief Instruction sets of the StrainTensorBatchKernel.
+ *
+ * \ingroup Strain
+ */
+class StrainTensorBatchKernelBase
+{
+public:
+  /** SCALAR processes one voxel at a time, VECTOR128 uses 128 bit lanes (SSE2
+   * or NEON), AVX2 uses 256 bit lanes, i.e. 8 float voxels per step, and
+   * AVX512 uses 512 bit lanes, i.e. 16 float voxels per step. */
+  enum InstructionSetType
+  {
+    SCALAR = 0,
+    VECTOR128 = 1,
+    AVX2 = 2,
+    AVX512 = 3
+  };
+
+  /** Widest instruction set supported by both the compiler and the processor,
+   * detected once. */
+  static InstructionSetType
+  GetDetectedInstructionSet()
+  {
+#if defined(ITK_STRAIN_X86_VECTOR_EXTENSIONS)
+    static const InstructionSetType detected = []() {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f"))
+      {
+        return AVX512;
+      }
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      {
+        return AVX2;
+      }
+      return VECTOR128;
+    }();
+    return detected;
+#elif defined(ITK_STRAIN_VECTOR_EXTENSIONS)
+    return VECTOR128;
+#else
+    return SCALAR;
+#endif
+  }
+};
+
+/** \class StrainTensorBatchKernel
+ *
+ * \brief Assemble a batch of strain tensors with SIMD instructions.
+ *
+ * The displacement gradients are given as structure of arrays: gradient[i *
+ * VDimension + j][n] = du_i/dx_j at voxel n.  Each component is loaded into
+ * the lanes of a vector register, and the linear and quadratic terms of the
+ * strain are computed for all the lanes at once.  The tensors are written
+ * interleaved, with the layout of a buffer of SymmetricSecondRankTensor pixels,
+ * or with any stride between the voxels of each component.
+ *
+ * The instructions are those of GetDetectedInstructionSet(), unless a
+ * narrower instruction set is requested.  Without vector extensions, i.e.
+ * with compilers other than GCC and Clang, the scalar code is used.  The
+ * results of the instruction sets can differ by the rounding of fused
+ * multiply-add operations, but within an instruction set every voxel is
+ * computed the same way.
+ *
+ * For the Hencky and Biot forms, the Green-Lagrangian tensors of a block of
+ * voxels are assembled with SIMD instructions, then their eigen systems are
+ * computed by the batch methods of SymmetricEigenKernel, and the tensors are
+ * mapped one voxel at a time.
+ *
+ * \sa StrainTensorKernel
+ *
+ * \ingroup Strain
+ */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+struct StrainTensorBatchKernel : public StrainTensorBatchKernelBase
+{
+  static constexpr unsigned int TensorComponents = VDimension * (VDimension + 1) / 2;
+
+  static void
+  Compute(const TValue * const * gradient, TValue * tensor, SizeValueType count)
+  {
+    Compute(GetDetectedInstructionSet(), gradient, tensor, count);
+  }
+
+  /** The instruction set must be supported by the processor, e.g. not wider
+   * than GetDetectedInstructionSet(). */
+  static void
+  Compute(InstructionSetType instructionSet, const TValue * const * gradient, TValue * tensor, SizeValueType count)
+  {
+    TValue * components[TensorComponents];
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      components[c] = tensor + c;
+    }
+    Compute(instructionSet, gradient, components, TensorComponents, count);
+  }
+
+  /** Write the component c, in the storage order of SymmetricSecondRankTensor,
+   * of the voxel n to tensor[c][n * stride] instead, e.g. to separate
+   * component images with a stride of 1. */
+  static void
+  Compute(const TValue * const * gradient, TValue * const * tensor, SizeValueType stride, SizeValueType count)
+  {
+    Compute(GetDetectedInstructionSet(), gradient, tensor, stride, count);
+  }
+
+  static void
+  Compute(InstructionSetType     instructionSet,
+          const TValue * const * gradient,
+          TValue * const *       tensor,
+          SizeValueType          stride,
+          SizeValueType          count)
+  {
+    if constexpr (VStrainForm > 2)
+    {
+      ComputeLargeDeformation(instructionSet, gradient, tensor, stride, count);
+    }
+    else
+    {
+      switch (instructionSet)
+      {
+#if defined(ITK_STRAIN_X86_VECTOR_EXTENSIONS)
+        case AVX512:
+          StrainDetail::ComputeStrainTensorBatchAVX512<VStrainForm, VDimension, TValue>(
+            gradient, tensor, stride, count);
+          return;
+        case AVX2:
+          StrainDetail::ComputeStrainTensorBatchAVX2<VStrainForm, VDimension, TValue>(gradient, tensor, stride, count);
+          return;
+#endif
+#if defined(ITK_STRAIN_VECTOR_EXTENSIONS)
+        case VECTOR128:
+          StrainDetail::ComputeStrainTensorBatch128<VStrainForm, VDimension, TValue>(gradient, tensor, stride, count);
+          return;
+#endif
+        default:
+          StrainDetail::ComputeStrainTensorBatch<VStrainForm, VDimension, TValue, TValue, 1>(
+            gradient, tensor, stride, count);
+          return;
+      }
+    }
+  }
+
+private:
+  /** Voxels per block of the Hencky and Biot forms. */
+  static constexpr unsigned int LargeDeformationBlockSize = 64;
+
+  static void
+  ComputeLargeDeformation(InstructionSetType     instructionSet,
+                          const TValue * const * gradient,
+                          TValue * const *       tensor,
+                          SizeValueType          stride,
+                          SizeValueType          count)
+  {
+    constexpr unsigned int BlockSize = LargeDeformationBlockSize;
+
+    TValue   greenLagrangian[BlockSize * TensorComponents];
+    TValue * greenLagrangianComponents[TensorComponents];
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      greenLagrangianComponents[c] = greenLagrangian + c;
+    }
+    TValue   eigenValues[BlockSize * VDimension];
+    TValue   eigenVectors[VDimension][BlockSize * VDimension];
+    TValue * eigenVectorPointers[VDimension];
+    for (unsigned int k = 0; k < VDimension; ++k)
+    {
+      eigenVectorPointers[k] = eigenVectors[k];
+    }
+
+    const TValue * blockGradient[VDimension * VDimension];
+    for (SizeValueType start = 0; start < count; start += BlockSize)
+    {
+      const SizeValueType blockCount = std::min<SizeValueType>(BlockSize, count - start);
+      for (unsigned int k = 0; k < VDimension * VDimension; ++k)
+      {
+        blockGradient[k] = gradient[k] + start;
+      }
+      StrainTensorBatchKernel<1, VDimension, TValue>::Compute(
+        instructionSet, blockGradient, greenLagrangianComponents, TensorComponents, blockCount);
+      SymmetricEigenKernel<VDimension, TValue>::ComputeEigenSystem(
+        greenLagrangian, eigenValues, eigenVectorPointers, blockCount);
+
+      for (SizeValueType n = 0; n < blockCount; ++n)
+      {
+        const TValue * voxelEigenVectors[VDimension];
+        for (unsigned int k = 0; k < VDimension; ++k)
+        {
+          voxelEigenVectors[k] = eigenVectors[k] + n * VDimension;
+        }
+        const SizeValueType offset = (start + n) * stride;
+        auto                voxelTensor = [tensor, offset](unsigned int i, unsigned int j) -> TValue & {
+          return tensor[StrainDetail::SymmetricTensorIndex(i, j, VDimension)][offset];
+        };
+        StrainDetail::AssembleLargeDeformationStrain<VStrainForm, VDimension>(
+          eigenValues + n * VDimension, voxelEigenVectors, voxelTensor);
+      }
+    }
+  }
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,271 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainTensorKernel_h
+#define itkStrainTensorKernel_h
+
+#include "itkStrainUnroll.h"
+#include "itkSymmetricEigenKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Index of the (i, j) component in the storage of a SymmetricSecondRankTensor,
+ * which holds the upper triangle row by row. */
+constexpr unsigned int
+SymmetricTensorIndex(unsigned int i, unsigned int j, unsigned int dimension)
+{
+  return i < j ? i * dimension + j - i * (i + 1) / 2 : j * dimension + i - j * (j + 1) / 2;
+}
+
+/** Principal strain of the large deformation forms from a principal
+ * Green-Lagrangian strain e, i.e. from the principal stretch
+ * lambda = sqrt(1 + 2 e): ln(lambda) for Hencky, and lambda - 1 for Biot.
+ * Both are written in terms of 2 e, so that they keep their accuracy at small
+ * strains.  A compression to zero volume gives a Hencky strain of -inf. */
+template <unsigned int VStrainForm, typename TValue>
+inline TValue
+PrincipalLargeDeformationStrain(TValue greenLagrangian)
+{
+  static_assert(VStrainForm == 3 || VStrainForm == 4, "Only the Hencky and Biot forms have principal strains.");
+  const TValue twiceStrain = std::max(TValue(2) * greenLagrangian, TValue(-1));
+  if constexpr (VStrainForm == 3)
+  {
+    return TValue(0.5) * std::log1p(twiceStrain);
+  }
+  else
+  {
+    return twiceStrain / (std::sqrt(TValue(1) + twiceStrain) + TValue(1));
+  }
+}
+
+/** Write the Hencky or Biot strain tensor sum_k f(e_k) v_k v_k^T through
+ * tensor(i, j), from the eigenvalues e_k, in ascending order, and the unit
+ * eigenvectors v_k of the Green-Lagrangian strain. */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue, typename TTensor>
+inline void
+AssembleLargeDeformationStrain(const TValue * eigenValues, const TValue * const * eigenVectors, TTensor & tensor)
+{
+  TValue principalStrains[VDimension];
+  for (unsigned int k = 0; k < VDimension; ++k)
+  {
+    principalStrains[k] = PrincipalLargeDeformationStrain<VStrainForm>(eigenValues[k]);
+  }
+  Unroll<VDimension>([&](auto ii) {
+    constexpr unsigned int i = decltype(ii)::value;
+    Unroll<i + 1>([&](auto jj) {
+      constexpr unsigned int j = decltype(jj)::value;
+      TValue                 value = 0;
+      Unroll<VDimension>([&](auto kk) {
+        constexpr unsigned int k = decltype(kk)::value;
+        value += principalStrains[k] * eigenVectors[k][i] * eigenVectors[k][j];
+      });
+      tensor(i, j) = value;
+    });
+  });
+}
+
+/** As above, from a Green-Lagrangian strain tensor in the storage order of
+ * SymmetricSecondRankTensor, with the closed form eigen system of
+ * SymmetricEigenKernel in 2D and 3D. */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue, typename TTensor>
+inline void
+AssembleLargeDeformationStrain(const TValue * greenLagrangian, TTensor & tensor)
+{
+  TValue   eigenValues[VDimension];
+  TValue   eigenVectors[VDimension][VDimension];
+  TValue * eigenVectorPointers[VDimension];
+  for (unsigned int k = 0; k < VDimension; ++k)
+  {
+    eigenVectorPointers[k] = eigenVectors[k];
+  }
+  SymmetricEigenKernel<VDimension, TValue>::ComputeEigenSystem(greenLagrangian, eigenValues, eigenVectorPointers);
+  AssembleLargeDeformationStrain<VStrainForm, VDimension>(eigenValues, eigenVectorPointers, tensor);
+}
+} // end namespace StrainDetail
+
+/** \class StrainTensorKernel
+ *
+ * \brief Assemble a strain tensor from a displacement gradient.
+ *
+ * The displacement gradient is accessed as gradient[i][j] = du_i/dx_j, and the
+ * symmetric tensor is written through tensor(i, j).  The strain form is a
+ * template parameter, and the loops over the tensor and gradient components
+ * are unrolled at compile time, so the innermost loop of a filter has no
+ * branches.
+ *
+ * The Hencky and Biot forms are the functions ln(U) and U - I of the right
+ * stretch tensor U = sqrt(I + 2 E), with E the Green-Lagrangian strain.  They
+ * are evaluated on the eigen system of E, which is that of F^T F, from the
+ * closed form solution of SymmetricEigenKernel, rather than with a matrix
+ * logarithm or square root.
+ *
+ * \tparam VStrainForm The strain form, with the values of
+ * StrainImageFilter::StrainFormType and TransformToStrainFilter::StrainFormType:
+ * 0 for infinitesimal, 1 for Green-Lagrangian, 2 for Eulerian-Almansi, 3 for
+ * Hencky and 4 for Biot.
+ *
+ * \sa StrainImageFilter
+ * \sa TransformToStrainFilter
+ *
+ * \ingroup Strain
+ */
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+struct StrainTensorKernel
+{
+  static constexpr unsigned int StrainForm = VStrainForm;
+  static constexpr unsigned int Dimension = VDimension;
+  static constexpr unsigned int TensorComponents = VDimension * (VDimension + 1) / 2;
+  using ValueType = TValue;
+
+  /** e_ij = 1/2( du_i/dx_j + du_j/dx_i ) +/- 1/2 du_m/dx_i du_m/dx_j, or, for
+   * the Hencky and Biot forms, the spectral map of the Green-Lagrangian
+   * strain. */
+  template <typename TGradient, typename TTensor>
+  static inline void
+  Compute(const TGradient & gradient, TTensor & tensor)
+  {
+    if constexpr (VStrainForm > 2)
+    {
+      TValue greenLagrangian[TensorComponents];
+      auto   greenLagrangianTensor = [&greenLagrangian](unsigned int i, unsigned int j) -> TValue & {
+        return greenLagrangian[StrainDetail::SymmetricTensorIndex(i, j, VDimension)];
+      };
+      StrainTensorKernel<1, VDimension, TValue>::Compute(gradient, greenLagrangianTensor);
+      StrainDetail::AssembleLargeDeformationStrain<VStrainForm, VDimension>(greenLagrangian, tensor);
+    }
+    else
+    {
+      constexpr TValue half = 0.5;
+      StrainDetail::Unroll<VDimension>([&](auto ii) {
+        constexpr unsigned int i = decltype(ii)::value;
+        StrainDetail::Unroll<i + 1>([&](auto jj) {
+          constexpr unsigned int j = decltype(jj)::value;
+          TValue                 value =
+            half * (static_cast<TValue>(gradient[i][j]) + static_cast<TValue>(gradient[j][i]));
+          if constexpr (VStrainForm != 0)
+          {
+            TValue quadratic = 0;
+            StrainDetail::Unroll<VDimension>([&](auto mm) {
+              constexpr unsigned int m = decltype(mm)::value;
+              quadratic += static_cast<TValue>(gradient[m][i]) * static_cast<TValue>(gradient[m][j]);
+            });
+            if constexpr (VStrainForm == 1)
+            {
+              value += half * quadratic;
+            }
+            else
+            {
+              value -= half * quadratic;
+            }
+          }
+          tensor(i, j) = value;
+        });
+      });
+    }
+  }
+
+  /** Add the contribution of the gradient of the displacement component
+   * `component`, gradient[j] = du_component/dx_j, to the tensor.  Summing the
+   * contributions of all the components, then calling Finalize(), gives the
+   * same tensor as Compute().  The Hencky and Biot forms sum the
+   * Green-Lagrangian strain. */
+  template <typename TComponentGradient, typename TTensor>
+  static inline void
+  AddComponent(unsigned int component, const TComponentGradient & gradient, TTensor & tensor)
+  {
+    constexpr TValue half = 0.5;
+    StrainDetail::Unroll<VDimension>([&](auto jj) {
+      constexpr unsigned int j = decltype(jj)::value;
+      if (j == component)
+      {
+        tensor(component, j) += static_cast<TValue>(gradient[j]);
+      }
+      else
+      {
+        tensor(component, j) += half * static_cast<TValue>(gradient[j]);
+      }
+    });
+    if constexpr (VStrainForm != 0)
+    {
+      constexpr TValue quadraticWeight = VStrainForm == 2 ? -half : half;
+      StrainDetail::Unroll<VDimension>([&](auto jj) {
+        constexpr unsigned int j = decltype(jj)::value;
+        StrainDetail::Unroll<j + 1>([&](auto kk) {
+          constexpr unsigned int k = decltype(kk)::value;
+          tensor(j, k) += quadraticWeight * static_cast<TValue>(gradient[j]) * static_cast<TValue>(gradient[k]);
+        });
+      });
+    }
+  }
+
+  /** Complete a tensor summed by AddComponent(). */
+  template <typename TTensor>
+  static inline void
+  Finalize(TTensor & tensor)
+  {
+    if constexpr (VStrainForm > 2)
+    {
+      TValue greenLagrangian[TensorComponents];
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        for (unsigned int j = i; j < VDimension; ++j)
+        {
+          greenLagrangian[StrainDetail::SymmetricTensorIndex(i, j, VDimension)] = tensor(i, j);
+        }
+      }
+      StrainDetail::AssembleLargeDeformationStrain<VStrainForm, VDimension>(greenLagrangian, tensor);
+    }
+  }
+};
+
+/** Call functor(StrainTensorKernel<strainForm, VDimension, TValue>()), so that
+ * a filter selects the kernel of its strain form once per region.  Returns
+ * false, without calling the functor, when the strain form is unknown. */
+template <unsigned int VDimension, typename TValue, typename TFunctor>
+inline bool
+DispatchStrainTensorKernel(unsigned int strainForm, TFunctor && functor)
+{
+  switch (strainForm)
+  {
+    case 0:
+      functor(StrainTensorKernel<0, VDimension, TValue>());
+      return true;
+    case 1:
+      functor(StrainTensorKernel<1, VDimension, TValue>());
+      return true;
+    case 2:
+      functor(StrainTensorKernel<2, VDimension, TValue>());
+      return true;
+    case 3:
+      functor(StrainTensorKernel<3, VDimension, TValue>());
+      return true;
+    case 4:
+      functor(StrainTensorKernel<4, VDimension, TValue>());
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,46 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStrainUnroll_h
+#define itkStrainUnroll_h
+
+#include <type_traits>
+#include <utility>
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Call function(std::integral_constant<unsigned int, I>()) for I in [0, N),
+ * fully unrolled at compile time. */
+template <typename TFunction, unsigned int... VIndices>
+inline void
+UnrollSequence(TFunction && function, std::integer_sequence<unsigned int, VIndices...>)
+{
+  (function(std::integral_constant<unsigned int, VIndices>()), ...);
+}
+
+template <unsigned int VCount, typename TFunction>
+inline void
+Unroll(TFunction && function)
+{
+  UnrollSequence(function, std::make_integer_sequence<unsigned int, VCount>());
+}
+} // end namespace StrainDetail
+} // end namespace itk
+
+#endif
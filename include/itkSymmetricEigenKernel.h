@@ -0,0 +1,472 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkSymmetricEigenKernel_h
+#define itkSymmetricEigenKernel_h
+
+#include "itkIntTypes.h"
+#include "itkSymmetricSecondRankTensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+
+/** \class SymmetricEigenKernel
+ *
+ * \brief Eigenvalues and eigenvectors of symmetric tensors.
+ *
+ * The tensors are read from the storage of a SymmetricSecondRankTensor, i.e.
+ * the upper triangle row by row, and a batch of tensors is read from a buffer
+ * of SymmetricSecondRankTensor pixels.  The eigenvalues are written in
+ * ascending order, and eigenVectors[k] receives the unit eigenvector of the
+ * k-th eigenvalue.  A batch writes count interleaved values, with the layout
+ * of a buffer of Vector pixels.
+ *
+ * In 2D and 3D the eigenvalues are computed in closed form, from the
+ * characteristic polynomial, instead of with the iterations of
+ * SymmetricEigenAnalysis, and other dimensions fall back on
+ * SymmetricSecondRankTensor::ComputeEigenAnalysis().  The eigenvectors of
+ * repeated eigenvalues are any orthonormal basis of their eigenspace, and the
+ * eigenvectors form a right-handed frame.
+ *
+ * \sa StrainInvariantImageFilter
+ * \sa PrincipalStrainImageFilter
+ *
+ * \ingroup Strain
+ */
+template <unsigned int VDimension, typename TValue>
+struct SymmetricEigenKernel
+{
+  using TensorType = SymmetricSecondRankTensor<TValue, VDimension>;
+
+  static void
+  ComputeEigenValues(const TValue * tensor, TValue * eigenValues)
+  {
+    TensorType tensorPixel;
+    std::copy_n(tensor, TensorType::InternalDimension, tensorPixel.GetDataPointer());
+    typename TensorType::EigenValuesArrayType eigenValuesArray;
+    tensorPixel.ComputeEigenValues(eigenValuesArray);
+    std::copy_n(eigenValuesArray.GetDataPointer(), VDimension, eigenValues);
+  }
+
+  static void
+  ComputeEigenSystem(const TValue * tensor, TValue * eigenValues, TValue * const * eigenVectors)
+  {
+    TensorType tensorPixel;
+    std::copy_n(tensor, TensorType::InternalDimension, tensorPixel.GetDataPointer());
+    typename TensorType::EigenValuesArrayType   eigenValuesArray;
+    typename TensorType::EigenVectorsMatrixType eigenVectorsMatrix;
+    tensorPixel.ComputeEigenAnalysis(eigenValuesArray, eigenVectorsMatrix);
+    for (unsigned int k = 0; k < VDimension; ++k)
+    {
+      eigenValues[k] = eigenValuesArray[k];
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        eigenVectors[k][i] = eigenVectorsMatrix[k][i];
+      }
+    }
+  }
+
+  static void
+  ComputeEigenValues(const TValue * tensors, TValue * eigenValues, SizeValueType count)
+  {
+    for (SizeValueType n = 0; n < count; ++n)
+    {
+      ComputeEigenValues(tensors + n * TensorType::InternalDimension, eigenValues + n * VDimension);
+    }
+  }
+
+  static void
+  ComputeEigenSystem(const TValue * tensors, TValue * eigenValues, TValue * const * eigenVectors, SizeValueType count)
+  {
+    TValue * voxelEigenVectors[VDimension];
+    for (SizeValueType n = 0; n < count; ++n)
+    {
+      for (unsigned int k = 0; k < VDimension; ++k)
+      {
+        voxelEigenVectors[k] = eigenVectors[k] + n * VDimension;
+      }
+      ComputeEigenSystem(
+        tensors + n * TensorType::InternalDimension, eigenValues + n * VDimension, voxelEigenVectors);
+    }
+  }
+};
+
+/** The eigenvalues of [[a00, a01], [a01, a11]] are m -/+ r, with m the mean
+ * of the diagonal and r = sqrt(d^2 + a01^2), d = (a00 - a11) / 2. */
+template <typename TValue>
+struct SymmetricEigenKernel<2, TValue>
+{
+  static void
+  ComputeEigenValues(const TValue * tensor, TValue * eigenValues)
+  {
+    const TValue mean = (tensor[0] + tensor[2]) * TValue(0.5);
+    const TValue difference = (tensor[0] - tensor[2]) * TValue(0.5);
+    const TValue radius = std::sqrt(difference * difference + tensor[1] * tensor[1]);
+    eigenValues[0] = mean - radius;
+    eigenValues[1] = mean + radius;
+  }
+
+  /** The eigenvector of m + r is computed from the row of the shifted
+   * tensor that does not cancel, so it is accurate whatever the sign of d. */
+  static void
+  ComputeEigenSystem(const TValue * tensor, TValue * eigenValues, TValue * const * eigenVectors)
+  {
+    const TValue mean = (tensor[0] + tensor[2]) * TValue(0.5);
+    const TValue difference = (tensor[0] - tensor[2]) * TValue(0.5);
+    const TValue radius = std::sqrt(difference * difference + tensor[1] * tensor[1]);
+    eigenValues[0] = mean - radius;
+    eigenValues[1] = mean + radius;
+
+    TValue x = 1;
+    TValue y = 0;
+    if (radius > 0)
+    {
+      if (difference >= 0)
+      {
+        x = difference + radius;
+        y = tensor[1];
+      }
+      else
+      {
+        x = tensor[1];
+        y = radius - difference;
+      }
+      const TValue inverseNorm = TValue(1) / std::sqrt(x * x + y * y);
+      x *= inverseNorm;
+      y *= inverseNorm;
+    }
+    eigenVectors[1][0] = x;
+    eigenVectors[1][1] = y;
+    eigenVectors[0][0] = y;
+    eigenVectors[0][1] = -x;
+  }
+
+  /** Branch free, so that the compiler can vectorize the loop. */
+  static void
+  ComputeEigenValues(const TValue * tensors, TValue * eigenValues, SizeValueType count)
+  {
+    for (SizeValueType n = 0; n < count; ++n)
+    {
+      ComputeEigenValues(tensors + 3 * n, eigenValues + 2 * n);
+    }
+  }
+
+  static void
+  ComputeEigenSystem(const TValue * tensors, TValue * eigenValues, TValue * const * eigenVectors, SizeValueType count)
+  {
+    for (SizeValueType n = 0; n < count; ++n)
+    {
+      TValue * voxelEigenVectors[2] = { eigenVectors[0] + 2 * n, eigenVectors[1] + 2 * n };
+      ComputeEigenSystem(tensors + 3 * n, eigenValues + 2 * n, voxelEigenVectors);
+    }
+  }
+};
+
+/** The eigenvalues of a 3x3 tensor A follow from the trigonometric solution
+ * of the characteristic polynomial of B = (A - m I) / p, with m the mean of
+ * the diagonal and p the scale of the deviatoric part:
+ *
+ *   e = m + 2 p cos(acos(det(B) / 2) / 3 + 2 pi k / 3).
+ *
+ * A tensor whose deviatoric part vanishes to machine precision is treated as
+ * isotropic, rather than dividing by p.  The eigenvector of the most isolated
+ * eigenvalue is the largest cross product of two rows of the shifted tensor,
+ * and the two other eigenvectors are those of the restriction of the tensor
+ * to the plane orthogonal to it, which stays accurate when their eigenvalues
+ * are close. */
+template <typename TValue>
+struct SymmetricEigenKernel<3, TValue>
+{
+  /** Voxels per block of the batches. */
+  static constexpr unsigned int BlockSize = 16;
+
+  static void
+  ComputeEigenValues(const TValue * tensor, TValue * eigenValues)
+  {
+    ComputeEigenValues(tensor, eigenValues, 1);
+  }
+
+  static void
+  ComputeEigenSystem(const TValue * tensor, TValue * eigenValues, TValue * const * eigenVectors)
+  {
+    ComputeEigenSystem(tensor, eigenValues, eigenVectors, 1);
+  }
+
+  /** The eigenvalues of tensors that have two nearly equal eigenvalues, for
+   * which the characteristic polynomial is ill-conditioned, are recomputed
+   * from their eigenvectors. */
+  static void
+  ComputeEigenValues(const TValue * tensors, TValue * eigenValues, SizeValueType count)
+  {
+    TValue radius[BlockSize];
+    TValue cosine[BlockSize];
+    for (SizeValueType start = 0; start < count; start += BlockSize)
+    {
+      const unsigned int   blockCount = std::min<SizeValueType>(BlockSize, count - start);
+      const TValue * const blockTensors = tensors + 6 * start;
+      TValue * const       blockEigenValues = eigenValues + 3 * start;
+      ComputeBlockEigenValues(blockTensors, blockEigenValues, blockCount, radius, cosine);
+      for (unsigned int n = 0; n < blockCount; ++n)
+      {
+        if (std::abs(cosine[n]) > NearlyDegenerateCosine)
+        {
+          TValue   voxelEigenVectors[3][3];
+          TValue * voxelEigenVectorPointers[3] = { voxelEigenVectors[0], voxelEigenVectors[1], voxelEigenVectors[2] };
+          ComputeEigenVectors(blockTensors + 6 * n, blockEigenValues + 3 * n, radius[n], voxelEigenVectorPointers);
+        }
+      }
+    }
+  }
+
+  static void
+  ComputeEigenSystem(const TValue * tensors, TValue * eigenValues, TValue * const * eigenVectors, SizeValueType count)
+  {
+    TValue radius[BlockSize];
+    TValue cosine[BlockSize];
+    for (SizeValueType start = 0; start < count; start += BlockSize)
+    {
+      const unsigned int   blockCount = std::min<SizeValueType>(BlockSize, count - start);
+      const TValue * const blockTensors = tensors + 6 * start;
+      TValue * const       blockEigenValues = eigenValues + 3 * start;
+      ComputeBlockEigenValues(blockTensors, blockEigenValues, blockCount, radius, cosine);
+      for (unsigned int n = 0; n < blockCount; ++n)
+      {
+        TValue * voxelEigenVectors[3] = { eigenVectors[0] + 3 * (start + n),
+                                          eigenVectors[1] + 3 * (start + n),
+                                          eigenVectors[2] + 3 * (start + n) };
+        ComputeEigenVectors(blockTensors + 6 * n, blockEigenValues + 3 * n, radius[n], voxelEigenVectors);
+      }
+    }
+  }
+
+private:
+  /** Beyond this |det(B) / 2|, the gap between the two closest eigenvalues is
+   * below about 5% of p, and the error of the angle grows like
+   * 1 / sqrt(1 - cos^2). */
+  static constexpr TValue NearlyDegenerateCosine = TValue(0.999);
+
+  /** The mean, the radius 2 p, which is zero for isotropic tensors, and
+   * det(B) / 2, clamped to the domain of acos. */
+  static inline void
+  ComputeCharacteristics(const TValue * tensor, TValue & mean, TValue & radius, TValue & cosine)
+  {
+    constexpr TValue epsilon = std::numeric_limits<TValue>::epsilon();
+
+    mean = (tensor[0] + tensor[3] + tensor[5]) / TValue(3);
+    const TValue b00 = tensor[0] - mean;
+    const TValue b11 = tensor[3] - mean;
+    const TValue b22 = tensor[5] - mean;
+    const TValue offDiagonal = tensor[1] * tensor[1] + tensor[2] * tensor[2] + tensor[4] * tensor[4];
+    const TValue deviatoricNorm = b00 * b00 + b11 * b11 + b22 * b22 + TValue(2) * offDiagonal;
+    const TValue norm = tensor[0] * tensor[0] + tensor[3] * tensor[3] + tensor[5] * tensor[5] + TValue(2) * offDiagonal;
+
+    const bool   isotropic = !(deviatoricNorm > epsilon * epsilon * norm);
+    const TValue p = std::sqrt(deviatoricNorm / TValue(6));
+    const TValue inverseP = isotropic ? TValue(0) : TValue(1) / p;
+    const TValue determinant = b00 * (b11 * b22 - tensor[4] * tensor[4]) -
+                               tensor[1] * (tensor[1] * b22 - tensor[4] * tensor[2]) +
+                               tensor[2] * (tensor[1] * tensor[4] - b11 * tensor[2]);
+    const TValue halfDeterminant = TValue(0.5) * determinant * inverseP * inverseP * inverseP;
+
+    radius = isotropic ? TValue(0) : TValue(2) * p;
+    cosine = std::min(std::max(halfDeterminant, TValue(-1)), TValue(1));
+  }
+
+  /** The polynomial coefficients and the eigenvalues are computed in
+   * separate, branch free loops over the block, so that the compiler can
+   * vectorize them, and only the angles are computed one voxel at a time. */
+  static inline void
+  ComputeBlockEigenValues(const TValue * tensors,
+                          TValue *       eigenValues,
+                          unsigned int   count,
+                          TValue *       radius,
+                          TValue *       cosine)
+  {
+    constexpr TValue twoThirdsPi = TValue(2.0943951023931954923);
+
+    TValue mean[BlockSize];
+    TValue largestCosine[BlockSize];
+    TValue smallestCosine[BlockSize];
+    for (unsigned int n = 0; n < count; ++n)
+    {
+      ComputeCharacteristics(tensors + 6 * n, mean[n], radius[n], cosine[n]);
+    }
+    for (unsigned int n = 0; n < count; ++n)
+    {
+      const TValue angle = std::acos(cosine[n]) / TValue(3);
+      largestCosine[n] = std::cos(angle);
+      smallestCosine[n] = std::cos(angle + twoThirdsPi);
+    }
+    for (unsigned int n = 0; n < count; ++n)
+    {
+      const TValue largest = mean[n] + radius[n] * largestCosine[n];
+      const TValue smallest = mean[n] + radius[n] * smallestCosine[n];
+      const TValue middle = TValue(3) * mean[n] - largest - smallest;
+      eigenValues[3 * n] = smallest;
+      eigenValues[3 * n + 1] = std::min(std::max(middle, smallest), largest);
+      eigenValues[3 * n + 2] = largest;
+    }
+  }
+
+  static inline void
+  Cross(const TValue * u, const TValue * v, TValue * w)
+  {
+    w[0] = u[1] * v[2] - u[2] * v[1];
+    w[1] = u[2] * v[0] - u[0] * v[2];
+    w[2] = u[0] * v[1] - u[1] * v[0];
+  }
+
+  static inline TValue
+  Dot(const TValue * u, const TValue * v)
+  {
+    return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+  }
+
+  static inline void
+  Multiply(const TValue * tensor, const TValue * u, TValue * w)
+  {
+    w[0] = tensor[0] * u[0] + tensor[1] * u[1] + tensor[2] * u[2];
+    w[1] = tensor[1] * u[0] + tensor[3] * u[1] + tensor[4] * u[2];
+    w[2] = tensor[2] * u[0] + tensor[4] * u[1] + tensor[5] * u[2];
+  }
+
+  /** Eigenvector of a simple eigenvalue, from the largest cross product of two
+   * rows of tensor - eigenValue I. */
+  static void
+  ComputeIsolatedEigenVector(const TValue * tensor, TValue eigenValue, TValue * eigenVector)
+  {
+    const TValue rows[3][3] = { { tensor[0] - eigenValue, tensor[1], tensor[2] },
+                                { tensor[1], tensor[3] - eigenValue, tensor[4] },
+                                { tensor[2], tensor[4], tensor[5] - eigenValue } };
+    TValue       products[3][3];
+    Cross(rows[0], rows[1], products[0]);
+    Cross(rows[0], rows[2], products[1]);
+    Cross(rows[1], rows[2], products[2]);
+    unsigned int largest = 0;
+    TValue       largestNorm = Dot(products[0], products[0]);
+    for (unsigned int c = 1; c < 3; ++c)
+    {
+      const TValue norm = Dot(products[c], products[c]);
+      if (norm > largestNorm)
+      {
+        largest = c;
+        largestNorm = norm;
+      }
+    }
+    if (largestNorm > 0)
+    {
+      const TValue inverseNorm = TValue(1) / std::sqrt(largestNorm);
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        eigenVector[i] = products[largest][i] * inverseNorm;
+      }
+    }
+    else
+    {
+      eigenVector[0] = 1;
+      eigenVector[1] = 0;
+      eigenVector[2] = 0;
+    }
+  }
+
+  /** Eigenvalues and eigenvectors of the tensor in the plane orthogonal to
+   * the unit eigenvector normal, from the closed form solution of its 2x2
+   * restriction to that plane.  The eigenvectors, with normal, form a
+   * right-handed frame. */
+  static void
+  ComputeOrthogonalEigenSystem(const TValue * tensor,
+                               const TValue * normal,
+                               TValue *       eigenValues,
+                               TValue *       firstEigenVector,
+                               TValue *       secondEigenVector)
+  {
+    TValue u[3];
+    if (std::abs(normal[0]) > std::abs(normal[1]))
+    {
+      const TValue inverseLength = TValue(1) / std::sqrt(normal[0] * normal[0] + normal[2] * normal[2]);
+      u[0] = -normal[2] * inverseLength;
+      u[1] = 0;
+      u[2] = normal[0] * inverseLength;
+    }
+    else
+    {
+      const TValue inverseLength = TValue(1) / std::sqrt(normal[1] * normal[1] + normal[2] * normal[2]);
+      u[0] = 0;
+      u[1] = normal[2] * inverseLength;
+      u[2] = -normal[1] * inverseLength;
+    }
+    TValue v[3];
+    Cross(normal, u, v);
+
+    TValue tensorU[3];
+    TValue tensorV[3];
+    Multiply(tensor, u, tensorU);
+    Multiply(tensor, v, tensorV);
+    const TValue restriction[3] = { Dot(u, tensorU), Dot(u, tensorV), Dot(v, tensorV) };
+    TValue       planeEigenVectors[2][2];
+    TValue *     planeEigenVectorPointers[2] = { planeEigenVectors[0], planeEigenVectors[1] };
+    SymmetricEigenKernel<2, TValue>::ComputeEigenSystem(restriction, eigenValues, planeEigenVectorPointers);
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      firstEigenVector[i] = planeEigenVectors[0][0] * u[i] + planeEigenVectors[0][1] * v[i];
+      secondEigenVector[i] = planeEigenVectors[1][0] * u[i] + planeEigenVectors[1][1] * v[i];
+    }
+  }
+
+  /** The eigenvalues from the characteristic polynomial lose accuracy when
+   * two of them are close, so only the most isolated one is used, to find its
+   * eigenvector.  The eigenvalues are then recomputed from the eigenvectors. */
+  static void
+  ComputeEigenVectors(const TValue * tensor, TValue * eigenValues, TValue radius, TValue * const * eigenVectors)
+  {
+    if (radius == 0)
+    {
+      for (unsigned int k = 0; k < 3; ++k)
+      {
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+          eigenVectors[k][i] = k == i ? 1 : 0;
+        }
+      }
+      return;
+    }
+
+    TValue product[3];
+    if (eigenValues[2] - eigenValues[1] >= eigenValues[1] - eigenValues[0])
+    {
+      ComputeIsolatedEigenVector(tensor, eigenValues[2], eigenVectors[2]);
+      ComputeOrthogonalEigenSystem(tensor, eigenVectors[2], eigenValues, eigenVectors[0], eigenVectors[1]);
+      Multiply(tensor, eigenVectors[2], product);
+      eigenValues[2] = std::max(Dot(eigenVectors[2], product), eigenValues[1]);
+    }
+    else
+    {
+      ComputeIsolatedEigenVector(tensor, eigenValues[0], eigenVectors[0]);
+      ComputeOrthogonalEigenSystem(tensor, eigenVectors[0], eigenValues + 1, eigenVectors[1], eigenVectors[2]);
+      Multiply(tensor, eigenVectors[0], product);
+      eigenValues[0] = std::min(Dot(eigenVectors[0], product), eigenValues[1]);
+    }
+  }
+};
+
+} // end namespace itk
+
+#endif
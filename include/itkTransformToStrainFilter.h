@@ -21,7 +21,13 @@
 #include "itkDataObjectDecorator.h"
 #include "itkCovariantVector.h"
 #include "itkGenerateImageSource.h"
+#include "itkMaskRunList.h"
+#include "itkStrainOutputLayout.h"
+#include "itkStrainStageStatistics.h"
 #include "itkSymmetricSecondRankTensor.h"
+#include "itkVectorImage.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -43,9 +49,51 @@ namespace itk
  * Three different types of strains can be calculated, infinitesimal (default), aka
  * engineering strain, which is appropriate for small strains, Green-Lagrangian,
  * which uses a material reference system, and Eulerian-Almansi, which uses a
- * spatial reference system.  This is set with SetStrainForm().
+ * spatial reference system.  This is set with SetStrainForm().  For large
+ * deformations, the Hencky, or logarithmic, strain ln(U) and the Biot strain
+ * U - I of the right stretch tensor U = sqrt(F^T F) are also available.  They
+ * are computed in the same pass as the Green-Lagrangian strain, from its closed
+ * form eigen system in 2D and 3D.
+ *
+ * When the transform is linear, e.g. an AffineTransform or another
+ * MatrixOffsetTransformBase, the strain is computed once and copied to every
+ * output pixel.  It can also be obtained without generating an image with
+ * ComputeConstantStrain().
+ *
+ * For a BSplineTransform of order 1 to 3, which does not provide
+ * ComputeJacobianWithRespectToPosition(), the displacement gradient is
+ * evaluated analytically from the spline coefficients.  The weights of the
+ * separable basis functions and of their derivatives are computed per axis.
+ * When the output scanlines are parallel to the first axis of the coefficient
+ * grid, and not much shorter than it, the coefficients are contracted along
+ * the other axes once per scanline, and the weights along the first axis are
+ * reused from one scanline to the next.  Outside of the support of the transform, where the
+ * displacement is zero, the strain is zero.
+ *
+ * For a DisplacementFieldTransform whose displacement field has the geometry
+ * of the output image, the strain is computed directly from the field with
+ * the central difference stencil of StrainImageFilter::FusedGradient, instead
+ * of the Jacobian of the transform at each point.  The buffered region of the
+ * field must then hold the requested region of the output, padded by the
+ * radius of the stencil within the image.  Otherwise, the Jacobian of the
+ * transform is used.
+ *
+ * For the other transforms, the Jacobian is given by
+ * ComputeJacobianWithRespectToPosition(), or, with UseNumericalJacobian, by
+ * central differences of TransformPoint() on the output grid.
+ *
+ * With a MaskImage, the strain is only computed at the nonzero pixels of the
+ * mask, as in StrainImageFilter.
+ *
+ * As in StrainImageFilter, SetOutputLayout() writes the components of the
+ * tensors to separate scalar images, or to a VectorImage, in Voigt order.
+ *
+ * With CollectStageStatistics, the evaluation of the Jacobians is timed
+ * apart from the assembly of the tensors, as with the stages of
+ * StrainImageFilter.
  *
  * \sa StrainImageFilter
+ * \sa StrainPointEvaluator
  *
  * \ingroup Strain
  *
@@ -66,6 +114,13 @@ public:
   using OutputPixelType = SymmetricSecondRankTensor<TOutputValueType, ImageDimension>;
   using OutputImageType = Image<OutputPixelType, ImageDimension>;
 
+  /** Number of independent components of a strain tensor. */
+  static constexpr unsigned int TensorComponents = OutputPixelType::InternalDimension;
+
+  /** Types of the outputs of the COMPONENTIMAGES and VOIGTIMAGE layouts. */
+  using ComponentImageType = Image<TOutputValueType, ImageDimension>;
+  using VoigtImageType = VectorImage<TOutputValueType, ImageDimension>;
+
   /** Standard class type alias. */
   using Self = TransformToStrainFilter;
   using Superclass = GenerateImageSource<OutputImageType>;
@@ -88,32 +143,259 @@ public:
    * Three different types of strains can be calculated, infinitesimal (default), aka
    * engineering strain, which is appropriate for small strains, Green-Lagrangian,
    * which uses a material reference system, and Eulerian-Almansi, which uses a
-   * spatial reference system.  This is set with SetStrainForm(). */
+   * spatial reference system.  This is set with SetStrainForm().  HENCKY and
+   * BIOT are the logarithmic and Biot strains, in the material reference
+   * system, for large deformations. */
   enum StrainFormType
   {
     INFINITESIMAL = 0,
     GREENLAGRANGIAN = 1,
-    EULERIANALMANSI = 2
+    EULERIANALMANSI = 2,
+    HENCKY = 3,
+    BIOT = 4
   };
 
   itkSetMacro(StrainForm, StrainFormType);
   itkGetConstMacro(StrainForm, StrainFormType);
 
+  /** Approximate the Jacobian of the transform by central differences of
+   * TransformPoint() instead of calling ComputeJacobianWithRespectToPosition(),
+   * so that the strain of any transform, e.g. a CompositeTransform or a user
+   * defined transform, can be computed.  The stencil points are output grid
+   * points, NumericalJacobianStep pixels away from the center pixel along each
+   * index axis.  The transformed points are reused between neighbor pixels of
+   * a scanline and between neighbor scanlines, so that the transform is
+   * evaluated about once per pixel in 2D, plus twice per pixel for each
+   * additional axis.  This does not apply to the linear, BSplineTransform and
+   * DisplacementFieldTransform cases, which do not call the Jacobian of the
+   * transform.  Off by default. */
+  itkSetMacro(UseNumericalJacobian, bool);
+  itkGetConstMacro(UseNumericalJacobian, bool);
+  itkBooleanMacro(UseNumericalJacobian);
+
+  /** Distance in pixels between the center and the points of the numerical
+   * Jacobian stencil.  Defaults to 1. */
+  itkSetClampMacro(NumericalJacobianStep, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumericalJacobianStep, unsigned int);
+
+  /** If the transform is linear, its strain is the same everywhere: compute it
+   * in strain and return true.  Otherwise, return false and leave strain
+   * unchanged.  The transform must be set. */
+  bool
+  ComputeConstantStrain(OutputPixelType & strain) const;
+
+  /** Type of the image that restricts the computation to its nonzero pixels. */
+  using MaskImageType = Image<unsigned char, ImageDimension>;
+
+  /** Compute the strain only at the nonzero pixels of the mask, which must
+   * have the geometry of the output.  The output is zero at the other pixels.
+   * The work units are given equal numbers of mask pixels, grouped into runs
+   * along the first axis.  Not set by default. */
+  itkSetInputMacro(MaskImage, MaskImageType);
+  itkGetInputMacro(MaskImage, MaskImageType);
+
+  /** With a MaskImage, do not allocate the output image, and store the strain
+   * of the mask pixels in GetMaskedTensors(), at the indices listed by
+   * GetMaskedIndices(), in buffer order.  Off by default. */
+  itkSetMacro(CompactMaskedOutput, bool);
+  itkGetConstMacro(CompactMaskedOutput, bool);
+  itkBooleanMacro(CompactMaskedOutput);
+
+  using OutputIndexType = typename OutputImageType::IndexType;
+  using MaskedIndicesType = std::vector<OutputIndexType>;
+  using MaskedTensorsType = std::vector<OutputPixelType>;
+
+  /** Indices and strain tensors of the mask pixels after an update with
+   * CompactMaskedOutput.  Empty otherwise. */
+  itkGetConstReferenceMacro(MaskedIndices, MaskedIndicesType);
+  itkGetConstReferenceMacro(MaskedTensors, MaskedTensorsType);
+
+  /** Where the strain is written: the tensor image (default), one scalar
+   * image per component, or a VectorImage, with the components in Voigt
+   * order, as with StrainImageFilter::SetOutputLayout(). */
+  enum OutputLayoutType
+  {
+    TENSORIMAGE = 0,
+    COMPONENTIMAGES = 1,
+    VOIGTIMAGE = 2
+  };
+
+  itkSetMacro(OutputLayout, OutputLayoutType);
+  itkGetConstMacro(OutputLayout, OutputLayoutType);
+
+  /** Image of the component of the given Voigt index, filled with the
+   * COMPONENTIMAGES layout. */
+  ComponentImageType *
+  GetComponentOutput(unsigned int voigtIndex)
+  {
+    return dynamic_cast<ComponentImageType *>(this->ProcessObject::GetOutput(1 + voigtIndex));
+  }
+
+  /** VectorImage of the components in Voigt order, filled with the VOIGTIMAGE
+   * layout. */
+  VoigtImageType *
+  GetVoigtOutput()
+  {
+    return dynamic_cast<VoigtImageType *>(this->ProcessObject::GetOutput(1 + TensorComponents));
+  }
+
+  /** Stages of an update.  JACOBIANEVALUATION computes the displacement
+   * gradients, from the Jacobian of the transform, the spline coefficients,
+   * or the displacement field, and TENSORASSEMBLY assembles the strain from
+   * them.  The two alternate on every scanline, so the tensors are assembled
+   * in batches apart from the Jacobians while the statistics are collected,
+   * and the wall time of the threaded section is shared in proportion to the
+   * time the work units spent in each. */
+  enum StageType
+  {
+    JACOBIANEVALUATION = 0,
+    TENSORASSEMBLY = 1
+  };
+  static constexpr unsigned int NumberOfStages = 2;
+
+  /** Measure the wall time, the allocated bytes, and the threads of each
+   * stage, and invoke a StrainStageEvent for each at the end of the update.
+   * When off, nothing is measured and the statistics are zero.  Off by
+   * default. */
+  itkSetMacro(CollectStageStatistics, bool);
+  itkGetConstMacro(CollectStageStatistics, bool);
+  itkBooleanMacro(CollectStageStatistics);
+
+  /** Statistics of a stage in the last update with CollectStageStatistics. */
+  const StrainStageStatistics &
+  GetStageStatistics(StageType stage) const
+  {
+    return m_StageStatistics[stage];
+  }
+
+  /** Name of a stage, as given by StrainStageEvent::GetStageName(). */
+  static const char *
+  GetStageName(StageType stage)
+  {
+    constexpr const char * names[NumberOfStages] = { "JacobianEvaluation", "TensorAssembly" };
+    return stage < NumberOfStages ? names[stage] : "";
+  }
+
 protected:
   using OutputRegionType = typename OutputImageType::RegionType;
 
   TransformToStrainFilter();
 
+  /** The output 0 is the tensor image, the outputs 1 to TensorComponents the
+   * component images, and the last output the Voigt image. */
+  using Superclass::MakeOutput;
+  ProcessObject::DataObjectPointer
+  MakeOutput(ProcessObject::DataObjectPointerArraySizeType idx) override;
+
+  /** The component and Voigt images have the geometry of the tensor image. */
+  void
+  GenerateOutputInformation() override;
+
+  /** The requested region of the MaskImage is the output requested region. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** Only the outputs of the OutputLayout are allocated, and none with
+   * CompactMaskedOutput. */
+  void
+  AllocateOutputs() override;
+
+  /** With a MaskImage, the work is split over the mask pixels instead of the
+   * output region. */
+  void
+  GenerateData() override;
+
   void
   BeforeThreadedGenerateData() override;
   void
   DynamicThreadedGenerateData(const OutputRegionType & outputRegion) override;
+  void
+  AfterThreadedGenerateData() override;
 
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
 private:
   StrainFormType m_StrainForm;
+
+  bool m_UseNumericalJacobian{ false };
+
+  unsigned int m_NumericalJacobianStep{ 1 };
+
+  bool m_CompactMaskedOutput{ false };
+
+  /** Runs of mask pixels in the output requested region, only used during the
+   * update. */
+  MaskRunList<ImageDimension> m_MaskRuns;
+
+  MaskedIndicesType m_MaskedIndices;
+  MaskedTensorsType m_MaskedTensors;
+
+  OutputLayoutType m_OutputLayout{ TENSORIMAGE };
+
+  /** Buffers of the OutputLayout, or the compact list, set up before the
+   * threads start. */
+  StrainOutputBuffers<TOutputValueType, ImageDimension> m_OutputBuffers;
+
+  /** Point m_OutputBuffers to the buffers of the OutputLayout, or to the
+   * compact list. */
+  void
+  SetUpOutputBuffers();
+
+  /** Where the tensors of a scanline are written. */
+  using TensorLineType = StrainTensorLine<TOutputValueType, ImageDimension>;
+
+  /** Whether the origin, spacing and direction of the image match the output. */
+  bool
+  IsOnOutputGrid(const ImageBase<ImageDimension> * image) const;
+
+  /** Compute the strain of the scanlines visited by forEachLine, which calls
+   * its argument with the index of the first pixel of each scanline, its
+   * length, at most maximumLineLength, and the TensorLineType its tensors are
+   * written to. */
+  template <typename TForEachLine>
+  void
+  GenerateLines(const TForEachLine & forEachLine, SizeValueType maximumLineLength);
+
+  /** Compute the strain with central differences of the transformed points.
+   * The time of the assembly is added to assemblySeconds when it is not
+   * null, as in the other GenerateLines methods. */
+  template <typename TForEachLine>
+  void
+  NumericalJacobianGenerateLines(const TForEachLine & forEachLine,
+                                 SizeValueType        maximumLineLength,
+                                 double *             assemblySeconds);
+
+  /** Strain of a linear transform, only used during the update. */
+  bool            m_ConstantStrainAvailable{ false };
+  OutputPixelType m_ConstantStrain;
+
+  /** Compute the strain of a BSplineTransform from its coefficients. */
+  template <unsigned int VSplineOrder, typename TForEachLine>
+  void
+  BSplineGenerateLines(const TForEachLine & forEachLine, SizeValueType maximumLineLength, double * assemblySeconds);
+
+  /** Order of the BSplineTransform input, or 0 if the input is not a
+   * BSplineTransform, only used during the update. */
+  unsigned int m_BSplineOrder{ 0 };
+
+  /** Compute the strain of a DisplacementFieldTransform from its field. */
+  template <typename TForEachLine>
+  void
+  DisplacementFieldGenerateLines(const TForEachLine & forEachLine,
+                                 SizeValueType        maximumLineLength,
+                                 double *             assemblySeconds);
+
+  /** Whether the input is a DisplacementFieldTransform whose field lies on
+   * the output grid, only used during the update. */
+  bool m_DisplacementFieldOnOutputGrid{ false };
+
+  bool m_CollectStageStatistics{ false };
+
+  StrainStageStatistics m_StageStatistics[NumberOfStages];
+
+  /** Shares the wall time of the threaded section between the stages. */
+  StrainDetail::SharedStageTimer m_ThreadedStageTimer;
 };
 
 } // end namespace itk
@@ -18,7 +18,20 @@
 #ifndef itkTransformToStrainFilter_hxx
 #define itkTransformToStrainFilter_hxx
 
-#include "itkImageRegionIteratorWithIndex.h"
+#include "itkBSplineDerivativeKernelFunction.h"
+#include "itkBSplineKernelFunction.h"
+#include "itkBSplineTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkDisplacementGradientStencil.h"
+#include "itkImageToImageFilterCommon.h"
+#include "itkMath.h"
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
 
 namespace itk
 {
@@ -27,16 +40,96 @@ template <typename TTransform, typename TOperatorValue, typename TOutputValue>
 TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::TransformToStrainFilter()
   : m_StrainForm(INFINITESIMAL)
 {
+  this->AddOptionalInputName("MaskImage");
+
+  // ImageSource only makes the tensor image.
+  this->SetNumberOfIndexedOutputs(TensorComponents + 2);
+  for (unsigned int idx = 1; idx < TensorComponents + 2; ++idx)
+  {
+    this->SetNthOutput(idx, this->MakeOutput(idx));
+  }
+
   this->DynamicMultiThreadingOn();
 }
 
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+ProcessObject::DataObjectPointer
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::MakeOutput(
+  ProcessObject::DataObjectPointerArraySizeType idx)
+{
+  if (idx == 0)
+  {
+    return OutputImageType::New().GetPointer();
+  }
+  if (idx <= TensorComponents)
+  {
+    return ComponentImageType::New().GetPointer();
+  }
+  return VoigtImageType::New().GetPointer();
+}
+
 template <typename TTransform, typename TOperatorValue, typename TOutputValue>
 void
-TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::BeforeThreadedGenerateData()
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::GenerateOutputInformation()
+{
+  // GenerateImageSource only sets the information of the tensor image.
+  Superclass::GenerateOutputInformation();
+
+  const OutputImageType * output = this->GetOutput();
+  for (unsigned int idx = 1; idx < this->GetNumberOfIndexedOutputs(); ++idx)
+  {
+    this->ProcessObject::GetOutput(idx)->CopyInformation(output);
+  }
+  this->GetVoigtOutput()->SetNumberOfComponentsPerPixel(TensorComponents);
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * mask = const_cast<MaskImageType *>(this->GetMaskImage());
+  if (mask != nullptr)
+  {
+    mask->SetRequestedRegion(this->GetOutput()->GetRequestedRegion());
+  }
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+bool
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::IsOnOutputGrid(
+  const ImageBase<ImageDimension> * image) const
 {
-  OutputImageType * output = this->GetOutput();
-  output->FillBuffer(NumericTraits<OutputPixelType>::ZeroValue());
+  // The image is compared to the output grid with the tolerances
+  // ImageToImageFilter applies to the geometry of its inputs.
+  const OutputImageType * output = this->GetOutput();
+  const double            coordinateTolerance =
+    ImageToImageFilterCommon::GetGlobalDefaultCoordinateTolerance() * output->GetSpacing()[0];
+  const double directionTolerance = ImageToImageFilterCommon::GetGlobalDefaultDirectionTolerance();
+
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    if (std::abs(image->GetOrigin()[i] - output->GetOrigin()[i]) > coordinateTolerance ||
+        std::abs(image->GetSpacing()[i] - output->GetSpacing()[i]) > coordinateTolerance)
+    {
+      return false;
+    }
+    for (unsigned int j = 0; j < ImageDimension; ++j)
+    {
+      if (std::abs(image->GetDirection()[i][j] - output->GetDirection()[i][j]) > directionTolerance)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::BeforeThreadedGenerateData()
+{
   const TransformType * input = this->GetTransform();
   if (input == nullptr)
   {
@@ -44,106 +137,877 @@ TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::BeforeThreade
   }
 
   const StrainFormType strainForm = this->GetStrainForm();
-  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI)
+  if (strainForm != INFINITESIMAL && strainForm != GREENLAGRANGIAN && strainForm != EULERIANALMANSI &&
+      strainForm != HENCKY && strainForm != BIOT)
   {
     itkExceptionMacro("Invalid StrainForm!");
   }
+  if (this->m_OutputLayout != TENSORIMAGE && this->m_OutputLayout != COMPONENTIMAGES &&
+      this->m_OutputLayout != VOIGTIMAGE)
+  {
+    itkExceptionMacro("Invalid OutputLayout!");
+  }
+
+  std::fill(std::begin(this->m_StageStatistics), std::end(this->m_StageStatistics), StrainStageStatistics());
+  {
+    const StrainDetail::ScopedStageTimer timer(
+      this->m_CollectStageStatistics ? &this->m_StageStatistics[JACOBIANEVALUATION].WallTime : nullptr);
+    this->m_ConstantStrainAvailable = this->ComputeConstantStrain(this->m_ConstantStrain);
+  }
+
+  this->m_BSplineOrder = 0;
+  if constexpr (TransformType::InputSpaceDimension == TransformType::OutputSpaceDimension)
+  {
+    using ScalarType = typename TransformType::ScalarType;
+    if (dynamic_cast<const BSplineTransform<ScalarType, ImageDimension, 3> *>(input) != nullptr)
+    {
+      this->m_BSplineOrder = 3;
+    }
+    else if (dynamic_cast<const BSplineTransform<ScalarType, ImageDimension, 2> *>(input) != nullptr)
+    {
+      this->m_BSplineOrder = 2;
+    }
+    else if (dynamic_cast<const BSplineTransform<ScalarType, ImageDimension, 1> *>(input) != nullptr)
+    {
+      this->m_BSplineOrder = 1;
+    }
+  }
+
+  this->m_DisplacementFieldOnOutputGrid = false;
+  if constexpr (TransformType::InputSpaceDimension == TransformType::OutputSpaceDimension)
+  {
+    using DisplacementFieldTransformType = DisplacementFieldTransform<typename TransformType::ScalarType, ImageDimension>;
+    using DisplacementFieldType = typename DisplacementFieldTransformType::DisplacementFieldType;
+    using StencilType = DisplacementGradientStencil<DisplacementFieldType, TOperatorValue>;
+    const auto * displacementFieldTransform = dynamic_cast<const DisplacementFieldTransformType *>(input);
+    if (displacementFieldTransform != nullptr && displacementFieldTransform->GetDisplacementField() != nullptr)
+    {
+      const auto *            field = displacementFieldTransform->GetDisplacementField();
+      const OutputImageType * output = this->GetOutput();
+
+      // The stencil clamps at the buffered region of the field, so the field
+      // must hold the neighbors of the requested region that are inside the
+      // image, for the edges of the requested region to get the differences
+      // of the whole image.
+      OutputRegionType stencilRegion = output->GetRequestedRegion();
+      stencilRegion.PadByRadius(StencilType::Radius);
+      stencilRegion.Crop(field->GetLargestPossibleRegion());
+      this->m_DisplacementFieldOnOutputGrid = field->GetLargestPossibleRegion() == output->GetLargestPossibleRegion() &&
+                                              field->GetBufferedRegion().IsInside(stencilRegion) &&
+                                              this->IsOnOutputGrid(field);
+    }
+  }
+
+  this->m_MaskRuns.Clear();
+  this->m_MaskedIndices.clear();
+  this->m_MaskedTensors.clear();
+  const MaskImageType * mask = this->GetMaskImage();
+  if (mask != nullptr)
+  {
+    if (!this->IsOnOutputGrid(mask))
+    {
+      itkExceptionMacro("The MaskImage does not have the geometry of the output!");
+    }
+
+    const OutputRegionType & outputRegion = this->GetOutput()->GetRequestedRegion();
+    this->m_MaskRuns.Compute(mask, outputRegion);
+    if (this->m_CompactMaskedOutput)
+    {
+      this->m_MaskedIndices.reserve(this->m_MaskRuns.GetNumberOfPixels());
+      for (const auto & run : this->m_MaskRuns.GetRuns())
+      {
+        OutputIndexType index = run.Index;
+        for (SizeValueType n = 0; n < run.Length; ++n, ++index[0])
+        {
+          this->m_MaskedIndices.push_back(index);
+        }
+      }
+      this->m_MaskedTensors.resize(this->m_MaskRuns.GetNumberOfPixels());
+    }
+  }
+  this->SetUpOutputBuffers();
+
+  if (this->m_CollectStageStatistics)
+  {
+    this->m_ThreadedStageTimer.Start();
+  }
 }
 
 template <typename TTransform, typename TOperatorValue, typename TOutputValue>
 void
-TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::DynamicThreadedGenerateData(
-  const OutputRegionType & region)
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::AllocateOutputs()
 {
-  const TransformType * input = this->GetTransform();
-
-  OutputImageType * output = this->GetOutput();
-  using ImageIteratorType = ImageRegionIteratorWithIndex<OutputImageType>;
-  ImageIteratorType outputIt(output, region);
+  const bool compact = this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput;
+  for (unsigned int idx = 0; idx < this->GetNumberOfIndexedOutputs(); ++idx)
+  {
+    auto * output = dynamic_cast<ImageBase<ImageDimension> *>(this->ProcessObject::GetOutput(idx));
+    if (output == nullptr)
+    {
+      continue;
+    }
+    bool filled = false;
+    switch (this->m_OutputLayout)
+    {
+      case TENSORIMAGE:
+        filled = idx == 0;
+        break;
+      case COMPONENTIMAGES:
+        filled = idx >= 1 && idx <= TensorComponents;
+        break;
+      case VOIGTIMAGE:
+        filled = idx == TensorComponents + 1;
+        break;
+    }
+    if (filled && !compact)
+    {
+      output->SetBufferedRegion(output->GetRequestedRegion());
+      output->Allocate();
+    }
+    else
+    {
+      // Release the buffer of a previous update.
+      output->Initialize();
+    }
+  }
+}
 
-  typename TransformType::JacobianPositionType identity;
-  identity.set_identity();
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::SetUpOutputBuffers()
+{
+  if (this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput)
+  {
+    this->m_OutputBuffers.SetTensors(nullptr, reinterpret_cast<TOutputValue *>(this->m_MaskedTensors.data()));
+    return;
+  }
 
-  // e_ij += 1/2( du_i/dx_j + du_j/dx_i )
-  for (outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt)
+  switch (this->m_OutputLayout)
   {
-    const typename OutputImageType::IndexType index = outputIt.GetIndex();
-    typename OutputImageType::PointType       point;
-    output->TransformIndexToPhysicalPoint(index, point);
-    typename TransformType::JacobianPositionType jacobian;
-    input->ComputeJacobianWithRespectToPosition(point, jacobian);
-    typename OutputImageType::PixelType outputPixel = outputIt.Get();
-    for (unsigned int i = 0; i < ImageDimension; ++i)
+    case TENSORIMAGE:
     {
-      for (unsigned int j = 0; j < i; ++j)
+      OutputImageType * output = this->GetOutput();
+      this->m_OutputBuffers.SetTensors(output, reinterpret_cast<TOutputValue *>(output->GetBufferPointer()));
+      return;
+    }
+    case COMPONENTIMAGES:
+    {
+      TOutputValue * buffers[TensorComponents];
+      for (unsigned int k = 0; k < TensorComponents; ++k)
       {
-        outputPixel(i, j) += jacobian(i, j) / static_cast<TOutputValue>(2);
+        buffers[k] = this->GetComponentOutput(k)->GetBufferPointer();
       }
-      for (unsigned int j = i + 1; j < ImageDimension; ++j)
+      this->m_OutputBuffers.SetComponents(this->GetComponentOutput(0), buffers);
+      return;
+    }
+    case VOIGTIMAGE:
+    {
+      VoigtImageType * output = this->GetVoigtOutput();
+      this->m_OutputBuffers.SetVoigt(output, output->GetBufferPointer());
+      return;
+    }
+    default:
+      itkExceptionMacro("Invalid OutputLayout!");
+  }
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::GenerateData()
+{
+  if (this->GetMaskImage() == nullptr)
+  {
+    Superclass::GenerateData();
+    return;
+  }
+
+  this->AllocateOutputs();
+  this->BeforeThreadedGenerateData();
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  if (this->m_MaskRuns.GetNumberOfPixels() == 0)
+  {
+    // No mask pixel, the whole output is zero.
+    if (!this->m_CompactMaskedOutput)
+    {
+      this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+        this->GetOutput()->GetRequestedRegion(),
+        [this](const OutputRegionType & share) {
+          StrainDetail::ForEachScanline(share, [this, &share](const OutputIndexType & lineIndex) {
+            this->m_OutputBuffers.FillZero(lineIndex, share.GetSize(0));
+          });
+        },
+        this);
+    }
+    this->AfterThreadedGenerateData();
+    return;
+  }
+
+  // Each share zeroes the output pixels outside the mask between its runs.
+  this->m_MaskRuns.ParallelizePixels(
+    this->GetMultiThreader(),
+    this->GetNumberOfWorkUnits(),
+    [this](SizeValueType begin, SizeValueType end) {
+      if (!this->m_CompactMaskedOutput)
       {
-        outputPixel(i, j) += jacobian(i, j) / static_cast<TOutputValue>(2);
+        this->m_MaskRuns.ForEachGap(begin, end, [this](OffsetValueType offset, SizeValueType length) {
+          this->m_OutputBuffers.FillZero(offset, length);
+        });
       }
-      outputPixel(i, i) = jacobian(i, i) - static_cast<TOutputValue>(1);
+      this->GenerateLines(
+        [this, begin, end](const auto & lineFunction) {
+          this->m_MaskRuns.ForEachRun(
+            begin,
+            end,
+            [this, &lineFunction](const OutputIndexType & lineIndex, SizeValueType lineLength, SizeValueType ordinal) {
+              lineFunction(lineIndex,
+                           lineLength,
+                           this->m_CompactMaskedOutput
+                             ? this->m_OutputBuffers.GetLine(static_cast<OffsetValueType>(ordinal))
+                             : this->m_OutputBuffers.GetLine(lineIndex));
+            });
+        },
+        this->m_MaskRuns.GetMaximumRunLength());
+    },
+    this);
+  this->AfterThreadedGenerateData();
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::AfterThreadedGenerateData()
+{
+  this->m_MaskRuns.Clear();
+
+  if (this->m_CollectStageStatistics)
+  {
+    StrainStageStatistics & jacobianStatistics = this->m_StageStatistics[JACOBIANEVALUATION];
+    StrainStageStatistics & assemblyStatistics = this->m_StageStatistics[TENSORASSEMBLY];
+    this->m_ThreadedStageTimer.Stop(assemblyStatistics, jacobianStatistics);
+    // The Jacobian of a linear transform is evaluated once.
+    jacobianStatistics.Threads = this->m_ConstantStrainAvailable ? 1 : this->GetNumberOfWorkUnits();
+    assemblyStatistics.Threads = this->GetNumberOfWorkUnits();
+    assemblyStatistics.BytesAllocated =
+      this->GetMaskImage() != nullptr && this->m_CompactMaskedOutput
+        ? this->m_MaskedTensors.size() * sizeof(OutputPixelType)
+        : this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() * TensorComponents * sizeof(TOutputValue);
+    for (unsigned int stage = 0; stage < NumberOfStages; ++stage)
+    {
+      const auto stageType = static_cast<StageType>(stage);
+      this->InvokeEvent(StrainStageEvent(stage, GetStageName(stageType), this->m_StageStatistics[stage]));
     }
-    outputIt.Set(outputPixel);
   }
-  switch (m_StrainForm)
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::DynamicThreadedGenerateData(
+  const OutputRegionType & region)
+{
+  this->GenerateLines(
+    [this, &region](const auto & lineFunction) {
+      // The output image may not be allocated, depending on the OutputLayout.
+      StrainDetail::ForEachScanline(region, [this, &region, &lineFunction](const OutputIndexType & lineIndex) {
+        lineFunction(lineIndex, region.GetSize(0), this->m_OutputBuffers.GetLine(lineIndex));
+      });
+    },
+    region.GetSize(0));
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+template <typename TForEachLine>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::GenerateLines(const TForEachLine & forEachLine,
+                                                                                 SizeValueType maximumLineLength)
+{
+  const TransformType * input = this->GetTransform();
+
+  // Only the geometry of the output is used, it may not be allocated.
+  const OutputImageType * output = this->GetOutput();
+
+  // The work unit reports the time of the assembly, the rest is the
+  // evaluation of the Jacobians.
+  StrainDetail::WorkUnitStageTimer workUnitTimer(
+    this->m_CollectStageStatistics ? &this->m_ThreadedStageTimer : nullptr);
+  double * const                   assemblySeconds = workUnitTimer.GetPartSeconds();
+
+  if (this->m_ConstantStrainAvailable)
   {
-    case INFINITESIMAL:
-      break;
-    // e_ij += 1/2 du_m/du_i du_m/du_j
-    case GREENLAGRANGIAN:
-      for (outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt)
+    const StrainDetail::ScopedStageTimer timer(assemblySeconds);
+    forEachLine([this](const OutputIndexType &, SizeValueType lineLength, const TensorLineType & lineTensors) {
+      for (SizeValueType n = 0; n < lineLength; ++n)
       {
-        const typename OutputImageType::IndexType index = outputIt.GetIndex();
-        typename OutputImageType::PointType       point;
-        output->TransformIndexToPhysicalPoint(index, point);
-        typename TransformType::JacobianPositionType jacobian;
-        input->ComputeJacobianWithRespectToPosition(point, jacobian);
-        jacobian -= identity;
-        typename OutputImageType::PixelType outputPixel = outputIt.Get();
-        for (unsigned int i = 0; i < ImageDimension; ++i)
+        lineTensors.SetPixel(n, this->m_ConstantStrain);
+      }
+    });
+    return;
+  }
+
+  switch (this->m_BSplineOrder)
+  {
+    case 1:
+      this->template BSplineGenerateLines<1>(forEachLine, maximumLineLength, assemblySeconds);
+      return;
+    case 2:
+      this->template BSplineGenerateLines<2>(forEachLine, maximumLineLength, assemblySeconds);
+      return;
+    case 3:
+      this->template BSplineGenerateLines<3>(forEachLine, maximumLineLength, assemblySeconds);
+      return;
+    default:
+      break;
+  }
+  if (this->m_DisplacementFieldOnOutputGrid)
+  {
+    this->DisplacementFieldGenerateLines(forEachLine, maximumLineLength, assemblySeconds);
+    return;
+  }
+  if (this->m_UseNumericalJacobian)
+  {
+    this->NumericalJacobianGenerateLines(forEachLine, maximumLineLength, assemblySeconds);
+    return;
+  }
+
+  // The physical points of a scanline are its first point plus multiples of
+  // the step between neighbor pixels along the first index axis.
+  using PointType = typename OutputImageType::PointType;
+  typename PointType::VectorType lineStep;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    lineStep[i] = output->GetDirection()[i][0] * output->GetSpacing()[0];
+  }
+
+  const bool knownStrainForm = DispatchTimedStrainTensorKernel<ImageDimension, TOutputValue>(
+    this->m_StrainForm, assemblySeconds, [input, output, &forEachLine, &lineStep](auto && kernel) {
+      typename TransformType::JacobianPositionType jacobian;
+      PointType                                    lineStart;
+      PointType                                    point;
+
+      forEachLine([&](const OutputIndexType & lineIndex, SizeValueType lineLength, const TensorLineType & lineTensors) {
+        output->TransformIndexToPhysicalPoint(lineIndex, lineStart);
+        for (SizeValueType n = 0; n < lineLength; ++n)
+        {
+          for (unsigned int i = 0; i < ImageDimension; ++i)
+          {
+            point[i] = lineStart[i] + n * lineStep[i];
+          }
+          input->ComputeJacobianWithRespectToPosition(point, jacobian);
+          // Displacement gradient, du_i/dx_j = J_ij - delta_ij
+          for (unsigned int i = 0; i < ImageDimension; ++i)
+          {
+            jacobian(i, i) -= 1.0;
+          }
+          auto tensor = lineTensors.GetPixel(n);
+          kernel.Compute(jacobian, tensor);
+        }
+      });
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+template <unsigned int VSplineOrder, typename TForEachLine>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::BSplineGenerateLines(
+  const TForEachLine & forEachLine,
+  SizeValueType        maximumLineLength,
+  double *             assemblySeconds)
+{
+  using BSplineTransformType = BSplineTransform<typename TransformType::ScalarType, ImageDimension, VSplineOrder>;
+  using ScalarType = typename BSplineTransformType::ScalarType;
+  using CoefficientImageType = typename BSplineTransformType::ImageType;
+  using CoefficientType = typename CoefficientImageType::PixelType;
+  using KernelFunctionType = BSplineKernelFunction<VSplineOrder, ScalarType>;
+  using DerivativeKernelFunctionType = BSplineDerivativeKernelFunction<VSplineOrder, ScalarType>;
+  using PointType = typename OutputImageType::PointType;
+
+  constexpr unsigned int SupportSize = VSplineOrder + 1;
+  constexpr unsigned int D = ImageDimension;
+  unsigned int           otherSupportSize = 1;
+  for (unsigned int j = 1; j < D; ++j)
+  {
+    otherSupportSize *= SupportSize;
+  }
+
+  const auto *            transform = dynamic_cast<const BSplineTransformType *>(this->GetTransform());
+  const OutputImageType * output = this->GetOutput();
+
+  // All the coefficient images share the geometry of the grid.
+  const typename BSplineTransformType::CoefficientImageArray coefficientImages = transform->GetCoefficientImages();
+  const CoefficientImageType *                               grid = coefficientImages[0];
+  const typename CoefficientImageType::RegionType &          gridRegion = grid->GetBufferedRegion();
+  const OffsetValueType *                                    gridOffsets = grid->GetOffsetTable();
+  const CoefficientType *                                    coefficients[D];
+  for (unsigned int i = 0; i < D; ++i)
+  {
+    coefficients[i] = coefficientImages[i]->GetBufferPointer();
+  }
+
+  // The continuous grid index of a physical point is c = M (x - origin), and
+  // M[j][m] = dc_j/dx_m maps the derivatives along the grid axes to physical
+  // derivatives.
+  const typename CoefficientImageType::DirectionType & toGrid = grid->GetPhysicalPointToIndexMatrix();
+  const typename CoefficientImageType::PointType &     gridOrigin = grid->GetOrigin();
+
+  // A support of SupportSize coefficients along an axis starts at
+  // floor(c - minLimit), within the valid region [minLimit, maxLimit].
+  const ScalarType minLimit = 0.5 * static_cast<ScalarType>(VSplineOrder - 1);
+  ScalarType       maxLimit[D];
+  OffsetValueType  lastStart[D];
+  ScalarType       lineStep[D];
+  bool             alongFirstGridAxis = true;
+  for (unsigned int j = 0; j < D; ++j)
+  {
+    lastStart[j] = static_cast<OffsetValueType>(gridRegion.GetSize(j)) - SupportSize;
+    maxLimit[j] = minLimit + static_cast<ScalarType>(lastStart[j] + 1);
+    lineStep[j] = 0.0;
+    for (unsigned int m = 0; m < D; ++m)
+    {
+      lineStep[j] += toGrid[j][m] * output->GetDirection()[m][0] * output->GetSpacing()[0];
+    }
+    if (j > 0 && std::abs(lineStep[j]) > 1e-9 * std::abs(lineStep[0]))
+    {
+      alongFirstGridAxis = false;
+    }
+  }
+
+  struct AxisWeights
+  {
+    bool            inside;
+    OffsetValueType start;
+    ScalarType      weights[SupportSize];
+    ScalarType      derivatives[SupportSize];
+  };
+  typename KernelFunctionType::Pointer           kernelFunction = KernelFunctionType::New();
+  typename DerivativeKernelFunctionType::Pointer derivativeKernelFunction = DerivativeKernelFunctionType::New();
+  auto computeAxisWeights = [&](unsigned int j, ScalarType c, AxisWeights & axis) {
+    axis.inside = c >= minLimit && c <= maxLimit[j];
+    if (!axis.inside)
+    {
+      return;
+    }
+    // The support is shifted back on the upper limit of the valid region.
+    axis.start = std::min(Math::Floor<OffsetValueType>(c - minLimit), lastStart[j]);
+    for (unsigned int k = 0; k < SupportSize; ++k)
+    {
+      const ScalarType u = c - static_cast<ScalarType>(axis.start + k);
+      axis.weights[k] = kernelFunction->Evaluate(u);
+      axis.derivatives[k] = derivativeKernelFunction->Evaluate(u);
+    }
+  };
+
+  // Contracted coefficients of the current scanline, when it is parallel to
+  // the first grid axis: contracted[(g * D + i) * D + j] is the sum over the
+  // supports of the other axes of coefficient i at first axis index g,
+  // weighted by the basis functions for j = 0, or by the derivative along
+  // axis j for j > 0.  The contraction costs about as much as the full
+  // tensor product at SupportSize pixels per first axis coefficient, so it is
+  // skipped for shorter scanlines, e.g. the runs of a sparse mask.
+  const SizeValueType      firstAxisSize = gridRegion.GetSize(0);
+  std::vector<ScalarType>  contracted;
+  std::vector<AxisWeights> firstAxisWeights;
+  bool                     firstAxisWeightsCached = false;
+  ScalarType               cachedLineStart = 0.0;
+  SizeValueType            cachedLineLength = 0;
+  if (alongFirstGridAxis)
+  {
+    contracted.resize(firstAxisSize * D * D);
+    firstAxisWeights.resize(maximumLineLength);
+  }
+
+  const bool knownStrainForm = DispatchTimedStrainTensorKernel<ImageDimension, TOutputValue>(
+    this->m_StrainForm, assemblySeconds, [&](auto && kernel) {
+      PointType   lineStartPoint;
+      ScalarType  lineStart[D];
+      AxisWeights axes[D];
+      ScalarType  gridGradient[D][D];
+      ScalarType  gradient[D][D];
+
+      forEachLine([&](const OutputIndexType & lineIndex, SizeValueType lineLength, const TensorLineType & lineTensors) {
+        output->TransformIndexToPhysicalPoint(lineIndex, lineStartPoint);
+        for (unsigned int j = 0; j < D; ++j)
+        {
+          lineStart[j] = -static_cast<ScalarType>(gridRegion.GetIndex(j));
+          for (unsigned int m = 0; m < D; ++m)
+          {
+            lineStart[j] += toGrid[j][m] * (lineStartPoint[m] - gridOrigin[m]);
+          }
+        }
+
+        const bool contractLine = alongFirstGridAxis && firstAxisSize <= SupportSize * lineLength;
+        bool       lineInside = true;
+        if (contractLine)
         {
-          for (unsigned int j = 0; j < ImageDimension; ++j)
+          for (unsigned int j = 1; j < D; ++j)
+          {
+            computeAxisWeights(j, lineStart[j], axes[j]);
+            lineInside = lineInside && axes[j].inside;
+          }
+          if (lineInside)
           {
-            for (unsigned int k = 0; k <= j; ++k)
+            std::fill(contracted.begin(), contracted.end(), 0.0);
+            for (unsigned int s = 0; s < otherSupportSize; ++s)
             {
-              outputPixel(j, k) += jacobian(i, j) * jacobian(i, k) / static_cast<TOutputValue>(2);
+              ScalarType      weight = 1.0;
+              ScalarType      derivativeWeights[D];
+              OffsetValueType offset = 0;
+              std::fill_n(derivativeWeights, D, 1.0);
+              for (unsigned int j = 1, remainder = s; j < D; ++j, remainder /= SupportSize)
+              {
+                const unsigned int k = remainder % SupportSize;
+                offset += (axes[j].start + k) * gridOffsets[j];
+                for (unsigned int m = 1; m < D; ++m)
+                {
+                  derivativeWeights[m] *= m == j ? axes[j].derivatives[k] : axes[j].weights[k];
+                }
+                weight *= axes[j].weights[k];
+              }
+              for (SizeValueType g = 0; g < firstAxisSize; ++g)
+              {
+                ScalarType * contractedCoefficients = contracted.data() + g * D * D;
+                for (unsigned int i = 0; i < D; ++i)
+                {
+                  const ScalarType coefficient = coefficients[i][offset + g];
+                  contractedCoefficients[i * D] += weight * coefficient;
+                  for (unsigned int j = 1; j < D; ++j)
+                  {
+                    contractedCoefficients[i * D + j] += derivativeWeights[j] * coefficient;
+                  }
+                }
+              }
+            }
+
+            // The first axis weights only depend on the start of the line.
+            if (!firstAxisWeightsCached || lineStart[0] != cachedLineStart || lineLength > cachedLineLength)
+            {
+              for (SizeValueType n = 0; n < lineLength; ++n)
+              {
+                computeAxisWeights(0, lineStart[0] + n * lineStep[0], firstAxisWeights[n]);
+              }
+              firstAxisWeightsCached = true;
+              cachedLineStart = lineStart[0];
+              cachedLineLength = lineLength;
             }
           }
         }
-        outputIt.Set(outputPixel);
-      }
-      break;
-    // e_ij -= 1/2 du_m/du_i du_m/du_j
-    case EULERIANALMANSI:
-      for (outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt)
-      {
-        const typename OutputImageType::IndexType index = outputIt.GetIndex();
-        typename OutputImageType::PointType       point;
-        output->TransformIndexToPhysicalPoint(index, point);
-        typename TransformType::JacobianPositionType jacobian;
-        input->ComputeJacobianWithRespectToPosition(point, jacobian);
-        jacobian -= identity;
-        typename OutputImageType::PixelType outputPixel = outputIt.Get();
-        for (unsigned int i = 0; i < ImageDimension; ++i)
+
+        for (SizeValueType n = 0; n < lineLength; ++n)
         {
-          for (unsigned int j = 0; j < ImageDimension; ++j)
+          bool inside = lineInside;
+          if (contractLine)
           {
-            for (unsigned int k = 0; k <= j; ++k)
+            const AxisWeights & first = firstAxisWeights[n];
+            inside = inside && first.inside;
+            if (inside)
             {
-              outputPixel(j, k) -= jacobian(i, j) * jacobian(i, k) / static_cast<TOutputValue>(2);
+              for (unsigned int i = 0; i < D; ++i)
+              {
+                for (unsigned int j = 0; j < D; ++j)
+                {
+                  const ScalarType * firstWeights = j == 0 ? first.derivatives : first.weights;
+                  ScalarType         value = 0.0;
+                  for (unsigned int k = 0; k < SupportSize; ++k)
+                  {
+                    value += firstWeights[k] * contracted[((first.start + k) * D + i) * D + j];
+                  }
+                  gridGradient[i][j] = value;
+                }
+              }
             }
           }
+          else
+          {
+            for (unsigned int j = 0; j < D && inside; ++j)
+            {
+              computeAxisWeights(j, lineStart[j] + n * lineStep[j], axes[j]);
+              inside = axes[j].inside;
+            }
+            if (inside)
+            {
+              // Full tensor product of the separable weights.
+              for (unsigned int i = 0; i < D; ++i)
+              {
+                std::fill_n(gridGradient[i], D, 0.0);
+              }
+              for (unsigned int s = 0; s < otherSupportSize * SupportSize; ++s)
+              {
+                ScalarType      derivativeWeights[D];
+                OffsetValueType offset = 0;
+                std::fill_n(derivativeWeights, D, 1.0);
+                for (unsigned int j = 0, remainder = s; j < D; ++j, remainder /= SupportSize)
+                {
+                  const unsigned int k = remainder % SupportSize;
+                  offset += (axes[j].start + k) * gridOffsets[j];
+                  for (unsigned int m = 0; m < D; ++m)
+                  {
+                    derivativeWeights[m] *= m == j ? axes[j].derivatives[k] : axes[j].weights[k];
+                  }
+                }
+                for (unsigned int i = 0; i < D; ++i)
+                {
+                  const ScalarType coefficient = coefficients[i][offset];
+                  for (unsigned int j = 0; j < D; ++j)
+                  {
+                    gridGradient[i][j] += derivativeWeights[j] * coefficient;
+                  }
+                }
+              }
+            }
+          }
+
+          // du_i/dx_m = sum_j du_i/dc_j dc_j/dx_m, and zero outside of the
+          // support of the transform.
+          for (unsigned int i = 0; i < D; ++i)
+          {
+            for (unsigned int m = 0; m < D; ++m)
+            {
+              gradient[i][m] = 0.0;
+              if (inside)
+              {
+                for (unsigned int j = 0; j < D; ++j)
+                {
+                  gradient[i][m] += gridGradient[i][j] * toGrid[j][m];
+                }
+              }
+            }
+          }
+          auto tensor = lineTensors.GetPixel(n);
+          kernel.Compute(gradient, tensor);
         }
-        outputIt.Set(outputPixel);
-      }
-      break;
-    default:
+      });
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+template <typename TForEachLine>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::DisplacementFieldGenerateLines(
+  const TForEachLine & forEachLine,
+  SizeValueType        maximumLineLength,
+  double *             assemblySeconds)
+{
+  if constexpr (TransformType::InputSpaceDimension == TransformType::OutputSpaceDimension)
+  {
+    using DisplacementFieldTransformType =
+      DisplacementFieldTransform<typename TransformType::ScalarType, ImageDimension>;
+    using DisplacementFieldType = typename DisplacementFieldTransformType::DisplacementFieldType;
+
+    const auto * transform = dynamic_cast<const DisplacementFieldTransformType *>(this->GetTransform());
+
+    const DisplacementGradientStencil<DisplacementFieldType, TOperatorValue> stencil(
+      transform->GetDisplacementField());
+
+    // The gradients of a scanline are computed into a structure of arrays, from
+    // which the tensors are assembled in SIMD batches, as in StrainImageFilter.
+    std::vector<TOutputValue> lineGradients(ImageDimension * ImageDimension * maximumLineLength);
+
+    const bool knownStrainForm =
+      DispatchStrainTensorKernel<ImageDimension, TOutputValue>(this->m_StrainForm, [&](auto kernel) {
+        using BatchKernelType = StrainTensorBatchKernel<decltype(kernel)::StrainForm, ImageDimension, TOutputValue>;
+
+        forEachLine(
+          [&](const OutputIndexType & lineIndex, SizeValueType lineLength, const TensorLineType & lineTensors) {
+            stencil.ComputeLine(lineIndex, lineLength, lineGradients.data());
+
+            const TOutputValue * lineGradientComponents[ImageDimension * ImageDimension];
+            for (unsigned int k = 0; k < ImageDimension * ImageDimension; ++k)
+            {
+              lineGradientComponents[k] = lineGradients.data() + k * lineLength;
+            }
+            const StrainDetail::ScopedStageTimer timer(assemblySeconds);
+            BatchKernelType::Compute(lineGradientComponents, lineTensors.Component, lineTensors.Stride, lineLength);
+          });
+      });
+    if (!knownStrainForm)
+    {
       itkExceptionMacro(<< "Unknown strain form.");
+    }
+  }
+}
+
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+template <typename TForEachLine>
+void
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::NumericalJacobianGenerateLines(
+  const TForEachLine & forEachLine,
+  SizeValueType        maximumLineLength,
+  double *             assemblySeconds)
+{
+  using IndexType = OutputIndexType;
+  using PointType = typename OutputImageType::PointType;
+  using InputPointType = typename TransformType::InputPointType;
+  using TransformedPointType = typename TransformType::OutputPointType;
+
+  const TransformType *   input = this->GetTransform();
+  const OutputImageType * output = this->GetOutput();
+
+  const OffsetValueType step = this->m_NumericalJacobianStep;
+  const OffsetValueType maximumPaddedLineLength = static_cast<OffsetValueType>(maximumLineLength) + 2 * step;
+
+  // axisSteps[j] is the physical offset of one pixel along index axis j, and
+  // toIndex[j][k] = di_j/dx_k maps the differences along the index axes to
+  // physical derivatives.
+  typename PointType::VectorType axisSteps[ImageDimension];
+  for (unsigned int j = 0; j < ImageDimension; ++j)
+  {
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      axisSteps[j][i] = output->GetDirection()[i][j] * output->GetSpacing()[j];
+    }
+  }
+  const typename OutputImageType::DirectionType & toIndex = output->GetPhysicalPointToIndexMatrix();
+
+  // Transform the count points of the scanline that starts at start.
+  auto transformLine = [input, output, &axisSteps](
+                         const IndexType & start, OffsetValueType count, TransformedPointType * transformed) {
+    PointType lineStart;
+    output->TransformIndexToPhysicalPoint(start, lineStart);
+    InputPointType point;
+    for (OffsetValueType n = 0; n < count; ++n)
+    {
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        point[i] = lineStart[i] + n * axisSteps[0][i];
+      }
+      transformed[n] = input->TransformPoint(point);
+    }
+  };
+
+  // The transformed scanlines, padded by step pixels on each side, are cached
+  // for the 2 step + 1 values of the second index around the current one, so
+  // that each scanline of a plane is transformed once.  A slot holds the
+  // scanline with the recorded start and length.
+  const OffsetValueType             cacheSize = 2 * step + 1;
+  std::vector<TransformedPointType> cache(cacheSize * maximumPaddedLineLength);
+  std::vector<IndexType>            cachedStarts(cacheSize);
+  std::vector<OffsetValueType>      cachedLengths(cacheSize, 0);
+
+  const bool knownStrainForm = DispatchTimedStrainTensorKernel<ImageDimension, TOutputValue>(
+    this->m_StrainForm, assemblySeconds, [&](auto && kernel) {
+      const TransformedPointType * lines[3];
+      PointType                    lineStart;
+      InputPointType               point;
+      double                       indexDerivatives[ImageDimension][ImageDimension];
+      double                       gradient[ImageDimension][ImageDimension];
+
+      forEachLine([&](const IndexType & lineIndex, SizeValueType length, const TensorLineType & lineTensors) {
+        const auto            lineLength = static_cast<OffsetValueType>(length);
+        const OffsetValueType paddedLineLength = lineLength + 2 * step;
+
+        // The scanlines at -step, 0 and +step along the second index axis.  A
+        // 1-D image has the current scanline only, in the first slot.
+        for (unsigned int t = 0; t < 3; ++t)
+        {
+          IndexType start = lineIndex;
+          start[0] -= step;
+          OffsetValueType slot = 0;
+          if constexpr (ImageDimension > 1)
+          {
+            start[1] += (static_cast<OffsetValueType>(t) - 1) * step;
+            slot = ((start[1] % cacheSize) + cacheSize) % cacheSize;
+          }
+          TransformedPointType * cachedLine = cache.data() + slot * maximumPaddedLineLength;
+          if (cachedLengths[slot] != paddedLineLength || cachedStarts[slot] != start)
+          {
+            transformLine(start, paddedLineLength, cachedLine);
+            cachedStarts[slot] = start;
+            cachedLengths[slot] = paddedLineLength;
+          }
+          lines[t] = cachedLine + step;
+        }
+
+        output->TransformIndexToPhysicalPoint(lineIndex, lineStart);
+        for (OffsetValueType n = 0; n < lineLength; ++n)
+        {
+          // indexDerivatives[i][j] = dT_i/di_j
+          for (unsigned int i = 0; i < ImageDimension; ++i)
+          {
+            indexDerivatives[i][0] = (lines[1][n + step][i] - lines[1][n - step][i]) / (2.0 * step);
+            if constexpr (ImageDimension > 1)
+            {
+              indexDerivatives[i][1] = (lines[2][n][i] - lines[0][n][i]) / (2.0 * step);
+            }
+          }
+          for (unsigned int j = 2; j < ImageDimension; ++j)
+          {
+            for (unsigned int i = 0; i < ImageDimension; ++i)
+            {
+              point[i] = lineStart[i] + n * axisSteps[0][i] + step * axisSteps[j][i];
+            }
+            const TransformedPointType forward = input->TransformPoint(point);
+            for (unsigned int i = 0; i < ImageDimension; ++i)
+            {
+              point[i] -= 2.0 * step * axisSteps[j][i];
+            }
+            const TransformedPointType backward = input->TransformPoint(point);
+            for (unsigned int i = 0; i < ImageDimension; ++i)
+            {
+              indexDerivatives[i][j] = (forward[i] - backward[i]) / (2.0 * step);
+            }
+          }
+
+          // Displacement gradient, du_i/dx_k = dT_i/dx_k - delta_ik
+          for (unsigned int i = 0; i < ImageDimension; ++i)
+          {
+            for (unsigned int k = 0; k < ImageDimension; ++k)
+            {
+              gradient[i][k] = i == k ? -1.0 : 0.0;
+              for (unsigned int j = 0; j < ImageDimension; ++j)
+              {
+                gradient[i][k] += indexDerivatives[i][j] * toIndex[j][k];
+              }
+            }
+          }
+          auto tensor = lineTensors.GetPixel(n);
+          kernel.Compute(gradient, tensor);
+        }
+      });
+    });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
   }
 }
 
+template <typename TTransform, typename TOperatorValue, typename TOutputValue>
+bool
+TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::ComputeConstantStrain(
+  OutputPixelType & strain) const
+{
+  const TransformType * input = this->GetTransform();
+  if (input == nullptr)
+  {
+    itkExceptionMacro("Input transform not available!");
+  }
+  if (!input->IsLinear())
+  {
+    return false;
+  }
+
+  // The Jacobian of a linear transform does not depend on the position.
+  typename TransformType::InputPointType point;
+  point.Fill(0.0);
+  typename TransformType::JacobianPositionType jacobian;
+  input->ComputeJacobianWithRespectToPosition(point, jacobian);
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    jacobian(i, i) -= 1.0;
+  }
+
+  const bool knownStrainForm = DispatchStrainTensorKernel<ImageDimension, TOutputValue>(
+    this->m_StrainForm, [&jacobian, &strain](auto kernel) { decltype(kernel)::Compute(jacobian, strain); });
+  if (!knownStrainForm)
+  {
+    itkExceptionMacro(<< "Unknown strain form.");
+  }
+  return true;
+}
+
 template <typename TTransform, typename TOperatorValue, typename TOutputValue>
 void
 TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::PrintSelf(std::ostream & os, Indent indent) const
@@ -152,6 +1016,12 @@ TransformToStrainFilter<TTransform, TOperatorValue, TOutputValue>::PrintSelf(std
 
   os << indent << "StrainForm: " << static_cast<typename NumericTraits<StrainFormType>::PrintType>(m_StrainForm)
      << std::endl;
+  os << indent << "UseNumericalJacobian: " << (m_UseNumericalJacobian ? "On" : "Off") << std::endl;
+  os << indent << "NumericalJacobianStep: " << m_NumericalJacobianStep << std::endl;
+  os << indent << "CompactMaskedOutput: " << (m_CompactMaskedOutput ? "On" : "Off") << std::endl;
+  os << indent << "OutputLayout: " << static_cast<typename NumericTraits<OutputLayoutType>::PrintType>(m_OutputLayout)
+     << std::endl;
+  os << indent << "CollectStageStatistics: " << (m_CollectStageStatistics ? "On" : "Off") << std::endl;
 }
 } // end namespace itk
 
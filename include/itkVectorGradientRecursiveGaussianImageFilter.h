@@ -0,0 +1,216 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkVectorGradientRecursiveGaussianImageFilter_h
+#define itkVectorGradientRecursiveGaussianImageFilter_h
+
+#include "itkCovariantVector.h"
+#include "itkImageToImageFilter.h"
+#include "itkRecursiveGaussianImageFilter.h"
+
+namespace itk
+{
+namespace StrainDetail
+{
+/** Coefficients of the causal and anticausal recursions of a
+ * RecursiveGaussianImageFilter along an axis of the given spacing. */
+struct RecursiveGaussianLineCoefficients
+{
+  double N[4];
+  double D[4];
+  double M[4];
+  double BN[4];
+  double BM[4];
+};
+
+/** Exposes the coefficients that RecursiveGaussianImageFilter computes, so
+ * that they are applied to several lines at once. */
+class RecursiveGaussianCoefficientsFilter
+  : public RecursiveGaussianImageFilter<Image<double, 1>, Image<double, 1>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(RecursiveGaussianCoefficientsFilter);
+
+  using Self = RecursiveGaussianCoefficientsFilter;
+  using Superclass = RecursiveGaussianImageFilter<Image<double, 1>, Image<double, 1>>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(RecursiveGaussianCoefficientsFilter);
+
+  RecursiveGaussianLineCoefficients
+  ComputeCoefficients(double spacing)
+  {
+    this->SetUp(spacing);
+    return { { this->m_N0, this->m_N1, this->m_N2, this->m_N3 },
+             { this->m_D1, this->m_D2, this->m_D3, this->m_D4 },
+             { this->m_M1, this->m_M2, this->m_M3, this->m_M4 },
+             { this->m_BN1, this->m_BN2, this->m_BN3, this->m_BN4 },
+             { this->m_BM1, this->m_BM2, this->m_BM3, this->m_BM4 } };
+  }
+
+protected:
+  RecursiveGaussianCoefficientsFilter() = default;
+  ~RecursiveGaussianCoefficientsFilter() override = default;
+};
+} // end namespace StrainDetail
+
+/** \class VectorGradientRecursiveGaussianImageFilter
+ *
+ * \brief Compute the gradient of each component of a displacement field
+ * image, smoothed by a recursive Gaussian, in one sweep per axis.
+ *
+ * The result matches itk::GradientRecursiveGaussianImageFilter applied to
+ * each Vector component, which is what StrainImageFilter does with such a
+ * GradientFilter.  Instead of ImageDimension separate smoothing and
+ * derivative pipelines per component, the ImageDimension *
+ * ImageDimension derivatives of the components are carried together through
+ * a single traversal of the image along each axis: the first derivative
+ * recursion is applied to the derivatives along that axis, and the smoothing
+ * recursion to the others, with the channels of each pixel interleaved.  The
+ * output images are the working buffers, so no intermediate image is
+ * allocated.
+ *
+ * The output i holds the gradient of the component i, which is the interface
+ * of the VectorGradientFilter of StrainImageFilter.
+ *
+ * \tparam TInputImage An image of displacement Vectors with ImageDimension
+ * components.
+ *
+ * \tparam TOutputImage An image of CovariantVectors with ImageDimension
+ * components.
+ *
+ * \sa StrainImageFilter
+ * \sa GradientRecursiveGaussianImageFilter
+ *
+ * \ingroup Strain
+ */
+template <typename TInputImage,
+          typename TOutputImage =
+            Image<CovariantVector<float, TInputImage::ImageDimension>, TInputImage::ImageDimension>>
+class VectorGradientRecursiveGaussianImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(VectorGradientRecursiveGaussianImageFilter);
+
+  /** ImageDimension enumeration. */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  /** Number of derivatives filtered together: one per component and axis. */
+  static constexpr unsigned int Channels = ImageDimension * ImageDimension;
+
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using OutputImageType = TOutputImage;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using OutputRegionType = typename OutputImageType::RegionType;
+
+  static_assert(InputPixelType::Dimension == ImageDimension,
+                "The displacement vectors must have as many components as the image dimension.");
+  static_assert(OutputPixelType::Dimension == ImageDimension,
+                "The gradients must have as many components as the image dimension.");
+
+  /** Standard class type alias. */
+  using Self = VectorGradientRecursiveGaussianImageFilter;
+  using Superclass = ImageToImageFilter<InputImageType, OutputImageType>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkOverrideGetNameOfClassMacro(VectorGradientRecursiveGaussianImageFilter);
+
+  /** Set/Get the standard deviation of the Gaussian, in physical units.  1.0
+   * by default. */
+  itkSetMacro(Sigma, double);
+  itkGetConstMacro(Sigma, double);
+
+  /** Set/Get whether the derivatives are multiplied by Sigma, as with
+   * GradientRecursiveGaussianImageFilter.  Off by default. */
+  itkSetMacro(NormalizeAcrossScale, bool);
+  itkGetConstMacro(NormalizeAcrossScale, bool);
+  itkBooleanMacro(NormalizeAcrossScale);
+
+  /** Set/Get whether the gradients are rotated by the image direction into
+   * physical space.  On by default. */
+  itkSetMacro(UseImageDirection, bool);
+  itkGetConstMacro(UseImageDirection, bool);
+  itkBooleanMacro(UseImageDirection);
+
+protected:
+  VectorGradientRecursiveGaussianImageFilter();
+  ~VectorGradientRecursiveGaussianImageFilter() override = default;
+
+  /** The recursions run along whole lines, so the whole input is needed. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  /** The recursions run along whole lines, so the whole output is
+   * produced. */
+  void
+  EnlargeOutputRequestedRegion(DataObject * output) override;
+
+  void
+  GenerateData() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Recursion coefficients of each channel, channel i * ImageDimension + j
+   * being the derivative of component i along axis j. */
+  struct ChannelCoefficients
+  {
+    double N[4][Channels];
+    double D[4][Channels];
+    double M[4][Channels];
+    double BN[4][Channels];
+    double BM[4][Channels];
+  };
+
+  /** Filter the lines of the region along the axis.  The first axis reads the
+   * input, and the others read the outputs of the previous axis. */
+  void
+  FilterAxis(unsigned int axis, const OutputRegionType & region, const ChannelCoefficients & coefficients);
+
+  /** Causal and anticausal recursions of the lineLength interleaved pixels of
+   * data, with the boundary conditions of RecursiveSeparableImageFilter.  The
+   * result is written to causal. */
+  static void
+  FilterLine(const double *              data,
+             double *                    causal,
+             double *                    antiCausal,
+             SizeValueType               lineLength,
+             const ChannelCoefficients & coefficients);
+
+  double m_Sigma{ 1.0 };
+
+  bool m_NormalizeAcrossScale{ false };
+
+  bool m_UseImageDirection{ true };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkVectorGradientRecursiveGaussianImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,334 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkVectorGradientRecursiveGaussianImageFilter_hxx
+#define itkVectorGradientRecursiveGaussianImageFilter_hxx
+
+
+#include "itkImageLinearConstIteratorWithIndex.h"
+#include "itkProgressTransformer.h"
+
+#include <vector>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOutputImage>
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::VectorGradientRecursiveGaussianImageFilter()
+{
+  this->SetNumberOfIndexedOutputs(ImageDimension);
+
+  // ImageSource only does this for the first output.
+  for (unsigned int i = 1; i < ImageDimension; ++i)
+  {
+    this->SetNthOutput(i, this->MakeOutput(i));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  // Call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input != nullptr)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::EnlargeOutputRequestedRegion(
+  DataObject * output)
+{
+  auto * outputImage = dynamic_cast<OutputImageType *>(output);
+  if (outputImage != nullptr)
+  {
+    outputImage->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  this->AllocateOutputs();
+
+  const OutputRegionType & region = this->GetOutput()->GetRequestedRegion();
+  for (unsigned int j = 0; j < ImageDimension; ++j)
+  {
+    if (region.GetSize(j) < 4)
+    {
+      itkExceptionMacro("The number of pixels along direction " << j
+                                                                << " is less than 4. This filter requires a minimum of "
+                                                                   "four pixels along each dimension.");
+    }
+  }
+
+  auto coefficientsFilter = StrainDetail::RecursiveGaussianCoefficientsFilter::New();
+  coefficientsFilter->SetSigma(this->m_Sigma);
+  coefficientsFilter->SetNormalizeAcrossScale(this->m_NormalizeAcrossScale);
+
+  for (unsigned int axis = 0; axis < ImageDimension; ++axis)
+  {
+    // Along this axis, the derivatives along the axis are differentiated, and
+    // the other derivatives smoothed.
+    const double spacing = this->GetInput()->GetSpacing()[axis];
+    coefficientsFilter->SetZeroOrder();
+    const StrainDetail::RecursiveGaussianLineCoefficients smoothing = coefficientsFilter->ComputeCoefficients(spacing);
+    coefficientsFilter->SetFirstOrder();
+    const StrainDetail::RecursiveGaussianLineCoefficients derivative =
+      coefficientsFilter->ComputeCoefficients(spacing);
+
+    ChannelCoefficients coefficients;
+    for (unsigned int c = 0; c < Channels; ++c)
+    {
+      const StrainDetail::RecursiveGaussianLineCoefficients & channel =
+        c % ImageDimension == axis ? derivative : smoothing;
+      for (unsigned int m = 0; m < 4; ++m)
+      {
+        coefficients.N[m][c] = channel.N[m];
+        coefficients.D[m][c] = channel.D[m];
+        coefficients.M[m][c] = channel.M[m];
+        coefficients.BN[m][c] = channel.BN[m];
+        coefficients.BM[m][c] = channel.BM[m];
+      }
+    }
+
+    // The work units never split the lines along the axis.
+    ProgressTransformer progress(static_cast<float>(axis) / ImageDimension,
+                                 static_cast<float>(axis + 1) / ImageDimension,
+                                 this);
+    this->GetMultiThreader()->template ParallelizeImageRegionRestrictDirection<ImageDimension>(
+      axis,
+      region,
+      [this, axis, &coefficients](const OutputRegionType & lineRegion) {
+        this->FilterAxis(axis, lineRegion, coefficients);
+      },
+      progress.GetProcessObject());
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::FilterAxis(
+  unsigned int                axis,
+  const OutputRegionType &    region,
+  const ChannelCoefficients & coefficients)
+{
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      outputs[ImageDimension];
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    outputs[i] = this->GetOutput(i);
+  }
+  const OffsetValueType inputStride = input->GetOffsetTable()[axis];
+  const OffsetValueType outputStride = outputs[0]->GetOffsetTable()[axis];
+  const bool            lastAxis = axis + 1 == ImageDimension;
+  const auto &          direction = outputs[0]->GetDirection();
+
+  const SizeValueType lineLength = region.GetSize(axis);
+  std::vector<double> data(lineLength * Channels);
+  std::vector<double> causal(lineLength * Channels);
+  std::vector<double> antiCausal(lineLength * Channels);
+
+  ImageLinearConstIteratorWithIndex<OutputImageType> lineIt(outputs[0], region);
+  lineIt.SetDirection(axis);
+  lineIt.GoToBegin();
+  while (!lineIt.IsAtEnd())
+  {
+    const typename OutputImageType::IndexType lineIndex = lineIt.GetIndex();
+
+    // Gather the channels of the line, interleaved.
+    if (axis == 0)
+    {
+      const InputPixelType * inputLine = input->GetBufferPointer() + input->ComputeOffset(lineIndex);
+      for (SizeValueType n = 0; n < lineLength; ++n)
+      {
+        const InputPixelType & displacement = inputLine[n * inputStride];
+        for (unsigned int i = 0; i < ImageDimension; ++i)
+        {
+          for (unsigned int j = 0; j < ImageDimension; ++j)
+          {
+            data[n * Channels + i * ImageDimension + j] = static_cast<double>(displacement[i]);
+          }
+        }
+      }
+    }
+    else
+    {
+      const OffsetValueType lineOffset = outputs[0]->ComputeOffset(lineIndex);
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        const OutputPixelType * outputLine = outputs[i]->GetBufferPointer() + lineOffset;
+        for (SizeValueType n = 0; n < lineLength; ++n)
+        {
+          for (unsigned int j = 0; j < ImageDimension; ++j)
+          {
+            data[n * Channels + i * ImageDimension + j] = static_cast<double>(outputLine[n * outputStride][j]);
+          }
+        }
+      }
+    }
+
+    FilterLine(data.data(), causal.data(), antiCausal.data(), lineLength, coefficients);
+
+    // Scatter the line back to the outputs, and rotate the gradients into
+    // physical space after the last axis.
+    const OffsetValueType lineOffset = outputs[0]->ComputeOffset(lineIndex);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      OutputPixelType * outputLine = outputs[i]->GetBufferPointer() + lineOffset;
+      for (SizeValueType n = 0; n < lineLength; ++n)
+      {
+        const double *    gradient = causal.data() + n * Channels + i * ImageDimension;
+        OutputPixelType & outputPixel = outputLine[n * outputStride];
+        for (unsigned int k = 0; k < ImageDimension; ++k)
+        {
+          double value = gradient[k];
+          if (lastAxis && this->m_UseImageDirection)
+          {
+            value = 0.0;
+            for (unsigned int j = 0; j < ImageDimension; ++j)
+            {
+              value += direction[k][j] * gradient[j];
+            }
+          }
+          outputPixel[k] = static_cast<typename OutputPixelType::ValueType>(value);
+        }
+      }
+    }
+
+    lineIt.NextLine();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::FilterLine(
+  const double *              data,
+  double *                    causal,
+  double *                    antiCausal,
+  SizeValueType               lineLength,
+  const ChannelCoefficients & coefficients)
+{
+  const double(&N)[4][Channels] = coefficients.N;
+  const double(&D)[4][Channels] = coefficients.D;
+  const double(&M)[4][Channels] = coefficients.M;
+  const double(&BN)[4][Channels] = coefficients.BN;
+  const double(&BM)[4][Channels] = coefficients.BM;
+  const auto length = static_cast<OffsetValueType>(lineLength);
+
+  // The first and last pixels are assumed to extend to infinity.  Near the
+  // ends, the inputs beyond the line are the end pixels, and the outputs
+  // beyond the line are replaced by the end pixels times the boundary
+  // coefficients.
+  const double * first = data;
+  const double * last = data + (length - 1) * Channels;
+  for (OffsetValueType n = 0; n < 4; ++n)
+  {
+    for (unsigned int c = 0; c < Channels; ++c)
+    {
+      double value = 0.0;
+      for (OffsetValueType m = 0; m < 4; ++m)
+      {
+        value += (n >= m ? data[(n - m) * Channels + c] : first[c]) * N[m][c];
+      }
+      double feedback = 0.0;
+      for (OffsetValueType m = 1; m <= 4; ++m)
+      {
+        feedback += n >= m ? causal[(n - m) * Channels + c] * D[m - 1][c] : first[c] * BN[m - 1][c];
+      }
+      causal[n * Channels + c] = value - feedback;
+    }
+  }
+  for (OffsetValueType n = 4; n < length; ++n)
+  {
+    // The inputs n - m and the outputs n - m - 1, for m in [0, 4).
+    const double * x[4];
+    const double * y[4];
+    for (OffsetValueType m = 0; m < 4; ++m)
+    {
+      x[m] = data + (n - m) * Channels;
+      y[m] = causal + (n - m - 1) * Channels;
+    }
+    double * output = causal + n * Channels;
+    for (unsigned int c = 0; c < Channels; ++c)
+    {
+      output[c] = x[0][c] * N[0][c] + x[1][c] * N[1][c] + x[2][c] * N[2][c] + x[3][c] * N[3][c];
+      output[c] -= y[0][c] * D[0][c] + y[1][c] * D[1][c] + y[2][c] * D[2][c] + y[3][c] * D[3][c];
+    }
+  }
+
+  for (OffsetValueType n = length - 1; n >= length - 4; --n)
+  {
+    for (unsigned int c = 0; c < Channels; ++c)
+    {
+      double value = 0.0;
+      for (OffsetValueType m = 1; m <= 4; ++m)
+      {
+        value += (n + m < length ? data[(n + m) * Channels + c] : last[c]) * M[m - 1][c];
+      }
+      double feedback = 0.0;
+      for (OffsetValueType m = 1; m <= 4; ++m)
+      {
+        feedback += n + m < length ? antiCausal[(n + m) * Channels + c] * D[m - 1][c] : last[c] * BM[m - 1][c];
+      }
+      antiCausal[n * Channels + c] = value - feedback;
+    }
+  }
+  for (OffsetValueType n = length - 5; n >= 0; --n)
+  {
+    // The inputs and the outputs n + m + 1, for m in [0, 4).
+    const double * x[4];
+    const double * y[4];
+    for (OffsetValueType m = 0; m < 4; ++m)
+    {
+      x[m] = data + (n + m + 1) * Channels;
+      y[m] = antiCausal + (n + m + 1) * Channels;
+    }
+    double * output = antiCausal + n * Channels;
+    for (unsigned int c = 0; c < Channels; ++c)
+    {
+      output[c] = x[0][c] * M[0][c] + x[1][c] * M[1][c] + x[2][c] * M[2][c] + x[3][c] * M[3][c];
+      output[c] -= y[0][c] * D[0][c] + y[1][c] * D[1][c] + y[2][c] * D[2][c] + y[3][c] * D[3][c];
+    }
+  }
+
+  for (SizeValueType k = 0; k < lineLength * Channels; ++k)
+  {
+    causal[k] += antiCausal[k];
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorGradientRecursiveGaussianImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os,
+                                                                                Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Sigma: " << m_Sigma << std::endl;
+  os << indent << "NormalizeAcrossScale: " << (m_NormalizeAcrossScale ? "On" : "Off") << std::endl;
+  os << indent << "UseImageDirection: " << (m_UseImageDirection ? "On" : "Off") << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -14,10 +14,12 @@ itk_module(Strain
     ITKCommon
     ITKImageGradient
     ITKImageSources
+    ITKSmoothing
+    ITKTransform
+    ITKDisplacementField
   TEST_DEPENDS
     ITKTestKernel
     ITKIOVTK
-    ITKDisplacementField
     ITKIOVTK
   EXCLUDE_FROM_DEFAULT
   DESCRIPTION
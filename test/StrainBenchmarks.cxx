@@ -0,0 +1,540 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Times the filters of the Strain module over a sweep of 2D and 3D image
+// sizes and thread counts, and writes the results as JSON:
+//
+//   StrainBenchmarks results.json [maximumSize] [iterations]
+//
+// The 3D images are at most maximumSize (512 by default) pixels along each
+// axis, and the 2D images at most 8 * maximumSize.  Each case is run once to
+// allocate its buffers, and then timed over iterations (3 by default) runs.
+// The peak resident memory is measured over each case, from a high-water mark
+// reset before it on Linux.
+
+#include "itkAffineTransform.h"
+#include "itkDifferenceOfGaussiansGradientImageFilter.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkGradientRecursiveGaussianImageFilter.h"
+#include "itkHighPriorityRealTimeProbesCollector.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreaderBase.h"
+#include "itkSimilarity2DTransform.h"
+#include "itkSimilarity3DTransform.h"
+#include "itkSplitComponentsImageFilter.h"
+#include "itkStrainImageFilter.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkVectorGradientRecursiveGaussianImageFilter.h"
+#include "itkVersion.h"
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  include <psapi.h>
+#elif defined(__APPLE__)
+#  include <mach/mach.h>
+#  include <sys/resource.h>
+#elif !defined(__linux__)
+#  include <sys/resource.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+#if defined(__linux__)
+// Field of /proc/self/status given in kilobytes, in bytes.
+itk::SizeValueType
+GetProcessStatusMemory(const std::string & field)
+{
+  std::ifstream status("/proc/self/status");
+  std::string   line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, field.size(), field) == 0 && line.size() > field.size() && line[field.size()] == ':')
+    {
+      return static_cast<itk::SizeValueType>(std::stoull(line.substr(field.size() + 1))) * 1024;
+    }
+  }
+  return 0;
+}
+#endif
+
+// Resident memory of the process, in bytes, or 0 if unknown.
+itk::SizeValueType
+GetResidentMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return 0;
+  }
+  return static_cast<itk::SizeValueType>(counters.WorkingSetSize);
+#elif defined(__linux__)
+  return GetProcessStatusMemory("VmRSS");
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+  {
+    return 0;
+  }
+  return static_cast<itk::SizeValueType>(info.resident_size);
+#else
+  return 0;
+#endif
+}
+
+// Peak resident memory of the process since it started, or since the last
+// successful ResetPeakResidentMemory(), in bytes.
+itk::SizeValueType
+GetPeakResidentMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return 0;
+  }
+  return static_cast<itk::SizeValueType>(counters.PeakWorkingSetSize);
+#elif defined(__linux__)
+  // Unlike ru_maxrss, VmHWM is reset by ResetPeakResidentMemory().
+  return GetProcessStatusMemory("VmHWM");
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+#  if defined(__APPLE__)
+  // In bytes on macOS.
+  return static_cast<itk::SizeValueType>(usage.ru_maxrss);
+#  else
+  return static_cast<itk::SizeValueType>(usage.ru_maxrss) * 1024;
+#  endif
+#endif
+}
+
+// Reset the peak resident memory of the process to its resident memory.  Only
+// Linux supports it, since 4.0.
+bool
+ResetPeakResidentMemory()
+{
+#if defined(__linux__)
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+  clearRefs.close();
+  return !clearRefs.fail();
+#else
+  return false;
+#endif
+}
+
+// Gives access to the statistics of the probes of the collector.
+class BenchmarkProbesCollector : public itk::HighPriorityRealTimeProbesCollector
+{
+public:
+  const itk::HighPriorityRealTimeProbe &
+  GetProbe(const std::string & id)
+  {
+    return this->m_Probes[id];
+  }
+};
+
+struct BenchmarkResult
+{
+  std::string                     Name;
+  std::string                     Filter;
+  std::string                     Variant;
+  unsigned int                    Dimension;
+  std::vector<itk::SizeValueType> Size;
+  unsigned int                    Threads;
+  unsigned int                    Iterations;
+  double                          MeanSeconds;
+  double                          MinimumSeconds;
+  double                          VoxelsPerSecond;
+  // The peak is only known if it was reset before the case, or if the peak of
+  // the process rose during the case.
+  bool                            PeakResidentMemoryKnown;
+  itk::SizeValueType              ResidentMemoryBefore;
+  itk::SizeValueType              PeakResidentMemory;
+};
+
+class StrainBenchmarks
+{
+public:
+  explicit StrainBenchmarks(unsigned int iterations)
+    : m_Iterations(iterations)
+  {}
+
+  // Run every case on images of the given size, with the given number of
+  // threads.
+  template <unsigned int VDimension>
+  void
+  Run(const itk::Size<VDimension> & size, unsigned int threads);
+
+  void
+  WriteJSON(std::ostream & os) const;
+
+  void
+  Report(std::ostream & os)
+  {
+    m_Collector.Report(os);
+  }
+
+private:
+  // Time the updates of the filter.  It is updated once before, so that its
+  // buffers are allocated.
+  template <unsigned int VDimension>
+  void
+  Time(itk::ProcessObject *          filter,
+       const std::string &           filterName,
+       const std::string &           variant,
+       const itk::Size<VDimension> & size,
+       unsigned int                  threads);
+
+  BenchmarkProbesCollector     m_Collector;
+  std::vector<BenchmarkResult> m_Results;
+  unsigned int                 m_Iterations;
+};
+
+template <unsigned int VDimension>
+void
+StrainBenchmarks::Time(itk::ProcessObject *          filter,
+                       const std::string &           filterName,
+                       const std::string &           variant,
+                       const itk::Size<VDimension> & size,
+                       unsigned int                  threads)
+{
+  std::ostringstream name;
+  name << filterName << '/' << variant << '/' << VDimension << "D/";
+  for (unsigned int d = 0; d < VDimension; ++d)
+  {
+    name << (d > 0 ? "x" : "") << size[d];
+  }
+  name << '/' << threads << "threads";
+  const std::string id = name.str();
+  std::cout << id << std::endl;
+
+  const bool               peakReset = ResetPeakResidentMemory();
+  const itk::SizeValueType residentBefore = GetResidentMemory();
+  const itk::SizeValueType peakBefore = GetPeakResidentMemory();
+
+  filter->Update();
+  for (unsigned int iteration = 0; iteration < m_Iterations; ++iteration)
+  {
+    filter->Modified();
+    m_Collector.Start(id.c_str());
+    filter->Update();
+    m_Collector.Stop(id.c_str());
+  }
+
+  const itk::SizeValueType peakAfter = GetPeakResidentMemory();
+
+  const itk::HighPriorityRealTimeProbe & probe = m_Collector.GetProbe(id);
+
+  BenchmarkResult result;
+  result.Name = id;
+  result.Filter = filterName;
+  result.Variant = variant;
+  result.Dimension = VDimension;
+  result.Size.assign(size.begin(), size.end());
+  result.Threads = threads;
+  result.Iterations = m_Iterations;
+  result.MeanSeconds = probe.GetMean();
+  result.MinimumSeconds = probe.GetMinimum();
+  result.VoxelsPerSecond = result.MeanSeconds > 0.0 ? size.CalculateProductOfElements() / result.MeanSeconds : 0.0;
+  result.PeakResidentMemoryKnown = residentBefore > 0 && peakAfter > 0 && (peakReset || peakAfter > peakBefore);
+  result.ResidentMemoryBefore = residentBefore;
+  result.PeakResidentMemory = peakAfter;
+  m_Results.push_back(result);
+}
+
+template <unsigned int VDimension>
+void
+StrainBenchmarks::Run(const itk::Size<VDimension> & size, unsigned int threads)
+{
+  using PixelType = float;
+  using CoordRepresentationType = double;
+  using DisplacementVectorType = itk::Vector<PixelType, VDimension>;
+  using DisplacementImageType = itk::Image<DisplacementVectorType, VDimension>;
+  using ComponentImageType = itk::Image<PixelType, VDimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<DisplacementImageType, PixelType, PixelType>;
+  using GradientOutputImageType = typename StrainFilterType::GradientOutputImageType;
+  using DoGGradientFilterType = itk::DifferenceOfGaussiansGradientImageFilter<ComponentImageType, PixelType>;
+  using RecursiveGaussianGradientFilterType =
+    itk::GradientRecursiveGaussianImageFilter<ComponentImageType, GradientOutputImageType>;
+  using VectorGradientFilterType =
+    itk::VectorGradientRecursiveGaussianImageFilter<DisplacementImageType, GradientOutputImageType>;
+  using SplitFilterType = itk::SplitComponentsImageFilter<DisplacementImageType, ComponentImageType>;
+
+  using TransformType = itk::Transform<CoordRepresentationType, VDimension, VDimension>;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, PixelType, PixelType>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, VDimension>;
+  using SimilarityTransformType = typename std::conditional<VDimension == 2,
+                                                            itk::Similarity2DTransform<CoordRepresentationType>,
+                                                            itk::Similarity3DTransform<CoordRepresentationType>>::type;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, VDimension>;
+  using DisplacementFieldType = typename DisplacementFieldTransformType::DisplacementFieldType;
+
+  // The filters created from now on use this many threads.
+  itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(threads);
+
+  typename DisplacementImageType::SpacingType spacing;
+  typename DisplacementImageType::PointType   origin;
+  for (unsigned int d = 0; d < VDimension; ++d)
+  {
+    spacing[d] = 0.1 * (d + 1);
+    origin[d] = -0.5 * spacing[d] * size[d];
+  }
+
+  // A smooth displacement field.
+  auto displacements = DisplacementImageType::New();
+  displacements->SetRegions(size);
+  displacements->SetSpacing(spacing);
+  displacements->SetOrigin(origin);
+  displacements->Allocate();
+  for (itk::ImageRegionIteratorWithIndex<DisplacementImageType> it(displacements, displacements->GetBufferedRegion());
+       !it.IsAtEnd();
+       ++it)
+  {
+    const typename DisplacementImageType::IndexType index = it.GetIndex();
+    DisplacementVectorType                          displacement;
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      displacement[i] = 0.01 * std::sin(0.05 * index[i] + i) + 0.001 * index[(i + 1) % VDimension];
+    }
+    it.Set(displacement);
+  }
+
+  // StrainImageFilter, with every strain form, and every gradient with the
+  // default strain form.
+  const std::pair<typename StrainFilterType::StrainFormType, const char *> strainForms[] = {
+    { StrainFilterType::INFINITESIMAL, "Infinitesimal" },
+    { StrainFilterType::GREENLAGRANGIAN, "GreenLagrangian" },
+    { StrainFilterType::EULERIANALMANSI, "EulerianAlmansi" },
+    { StrainFilterType::HENCKY, "Hencky" },
+    { StrainFilterType::BIOT, "Biot" }
+  };
+  for (const auto & strainForm : strainForms)
+  {
+    auto strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(displacements);
+    strainFilter->SetStrainForm(strainForm.first);
+    this->Time(strainFilter, "StrainImageFilter", std::string(strainForm.second) + "/Gradient", size, threads);
+  }
+  const char * gradients[] = { "Fused", "LowMemory", "DoG", "RecursiveGaussian", "VectorRecursiveGaussian" };
+  for (const std::string gradient : gradients)
+  {
+    auto strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(displacements);
+    if (gradient == "Fused")
+    {
+      strainFilter->FusedGradientOn();
+    }
+    else if (gradient == "LowMemory")
+    {
+      strainFilter->LowMemoryOn();
+    }
+    else if (gradient == "DoG")
+    {
+      strainFilter->SetGradientFilter(DoGGradientFilterType::New());
+    }
+    else if (gradient == "RecursiveGaussian")
+    {
+      strainFilter->SetGradientFilter(RecursiveGaussianGradientFilterType::New());
+    }
+    else
+    {
+      strainFilter->SetVectorGradientFilter(VectorGradientFilterType::New());
+    }
+    this->Time(strainFilter, "StrainImageFilter", "Infinitesimal/" + gradient, size, threads);
+  }
+
+  // SplitComponentsImageFilter
+  {
+    auto splitFilter = SplitFilterType::New();
+    splitFilter->SetInput(displacements);
+    this->Time(splitFilter, "SplitComponentsImageFilter", "Vector", size, threads);
+  }
+
+  // TransformToStrainFilter, on the same grid.
+  auto affineTransform = AffineTransformType::New();
+  {
+    typename AffineTransformType::ParametersType parameters = affineTransform->GetParameters();
+    for (unsigned int p = 0; p < VDimension * VDimension; ++p)
+    {
+      parameters[p] += 0.01 * (p + 1);
+    }
+    affineTransform->SetParameters(parameters);
+  }
+  auto similarityTransform = SimilarityTransformType::New();
+  similarityTransform->SetScale(1.05);
+
+  auto field = DisplacementFieldType::New();
+  field->SetRegions(size);
+  field->SetSpacing(spacing);
+  field->SetOrigin(origin);
+  field->Allocate();
+  itk::ImageRegionConstIterator<DisplacementImageType> displacementIt(displacements,
+                                                                      displacements->GetBufferedRegion());
+  for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd();
+       ++it, ++displacementIt)
+  {
+    it.Set(displacementIt.Get());
+  }
+  displacements = nullptr;
+  auto displacementFieldTransform = DisplacementFieldTransformType::New();
+  displacementFieldTransform->SetDisplacementField(field);
+
+  const std::pair<TransformType *, const char *> transforms[] = {
+    { affineTransform.GetPointer(), "Affine" },
+    { similarityTransform.GetPointer(), "Similarity" },
+    { displacementFieldTransform.GetPointer(), "DisplacementField" }
+  };
+  for (const auto & transform : transforms)
+  {
+    auto strainFilter = TransformToStrainFilterType::New();
+    strainFilter->SetTransform(transform.first);
+    strainFilter->SetSize(size);
+    strainFilter->SetSpacing(spacing);
+    strainFilter->SetOrigin(origin);
+    this->Time(strainFilter, "TransformToStrainFilter", transform.second, size, threads);
+  }
+}
+
+void
+StrainBenchmarks::WriteJSON(std::ostream & os) const
+{
+  os << "{\n";
+  os << "  \"ITKVersion\": \"" << itk::Version::GetITKVersion() << "\",\n";
+  os << "  \"Iterations\": " << m_Iterations << ",\n";
+  os << "  \"Results\": [";
+  for (size_t r = 0; r < m_Results.size(); ++r)
+  {
+    const BenchmarkResult & result = m_Results[r];
+    os << (r > 0 ? "," : "") << "\n    {\n";
+    os << "      \"Name\": \"" << result.Name << "\",\n";
+    os << "      \"Filter\": \"" << result.Filter << "\",\n";
+    os << "      \"Variant\": \"" << result.Variant << "\",\n";
+    os << "      \"Dimension\": " << result.Dimension << ",\n";
+    os << "      \"Size\": [";
+    for (size_t d = 0; d < result.Size.size(); ++d)
+    {
+      os << (d > 0 ? ", " : "") << result.Size[d];
+    }
+    os << "],\n";
+    os << "      \"Threads\": " << result.Threads << ",\n";
+    os << "      \"Iterations\": " << result.Iterations << ",\n";
+    os << "      \"MeanSeconds\": " << result.MeanSeconds << ",\n";
+    os << "      \"MinimumSeconds\": " << result.MinimumSeconds << ",\n";
+    os << "      \"VoxelsPerSecond\": " << result.VoxelsPerSecond << ",\n";
+    os << "      \"ResidentMemoryBeforeBytes\": " << result.ResidentMemoryBefore << ",\n";
+    if (result.PeakResidentMemoryKnown)
+    {
+      os << "      \"PeakResidentMemoryBytes\": " << result.PeakResidentMemory << ",\n";
+      os << "      \"PeakResidentMemoryIncreaseBytes\": "
+         << (result.PeakResidentMemory > result.ResidentMemoryBefore
+               ? result.PeakResidentMemory - result.ResidentMemoryBefore
+               : 0)
+         << "\n";
+    }
+    else
+    {
+      os << "      \"PeakResidentMemoryBytes\": null,\n";
+      os << "      \"PeakResidentMemoryIncreaseBytes\": null\n";
+    }
+    os << "    }";
+  }
+  os << "\n  ]\n";
+  os << "}\n";
+}
+
+} // namespace
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " results.json [maximumSize] [iterations]";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::string        resultsFile = argv[1];
+  const itk::SizeValueType maximumSize = argc > 2 ? std::stoul(argv[2]) : 512;
+  const unsigned int       iterations = argc > 3 ? std::stoul(argv[3]) : 3;
+
+  // 1, 2, 4, ... threads, up to the default.
+  const unsigned int        maximumThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  std::vector<unsigned int> threadCounts;
+  for (unsigned int threads = 1; threads < maximumThreads; threads *= 2)
+  {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maximumThreads);
+
+  StrainBenchmarks benchmarks(iterations);
+  try
+  {
+    for (itk::SizeValueType edge = 256; edge <= 8 * maximumSize; edge *= 4)
+    {
+      for (const unsigned int threads : threadCounts)
+      {
+        benchmarks.Run(itk::Size<2>::Filled(edge), threads);
+      }
+    }
+    for (itk::SizeValueType edge = 64; edge <= maximumSize; edge *= 2)
+    {
+      for (const unsigned int threads : threadCounts)
+      {
+        benchmarks.Run(itk::Size<3>::Filled(edge), threads);
+      }
+    }
+  }
+  catch (const itk::ExceptionObject & exception)
+  {
+    std::cerr << "Benchmark failed: " << exception << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  benchmarks.Report(std::cout);
+
+  std::ofstream results(resultsFile);
+  benchmarks.WriteJSON(results);
+  if (!results)
+  {
+    std::cerr << "Could not write " << resultsFile << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
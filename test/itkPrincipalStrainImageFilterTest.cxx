@@ -0,0 +1,248 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkPrincipalStrainImageFilter.h"
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include "ReadInDisplacements.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+// Compare the principal strains to the eigenvalues of the tensors of the fused
+// StrainImageFilter, and check that the principal directions are their
+// eigenvectors.
+template <typename TInputImage>
+int
+ComparePrincipalStrains(TInputImage * inputDisplacements,
+                        int           strainForm,
+                        unsigned int  finiteDifferenceOrder,
+                        double        tolerance)
+{
+  constexpr unsigned int Dimension = TInputImage::ImageDimension;
+  using PixelType = float;
+  using StrainFilterType = itk::StrainImageFilter<TInputImage, PixelType, PixelType>;
+  using PrincipalStrainFilterType = itk::PrincipalStrainImageFilter<TInputImage, PixelType, PixelType>;
+  using TensorImageType = typename StrainFilterType::OutputImageType;
+  using TensorType = typename TensorImageType::PixelType;
+  using PrincipalStrainImageType = typename PrincipalStrainFilterType::OutputImageType;
+
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(inputDisplacements);
+  strainFilter->SetStrainForm(static_cast<typename StrainFilterType::StrainFormType>(strainForm));
+  strainFilter->FusedGradientOn();
+  strainFilter->SetFiniteDifferenceOrder(finiteDifferenceOrder);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+  auto principalStrainFilter = PrincipalStrainFilterType::New();
+  principalStrainFilter->SetInput(inputDisplacements);
+  principalStrainFilter->SetStrainForm(static_cast<typename PrincipalStrainFilterType::StrainFormType>(strainForm));
+  principalStrainFilter->SetFiniteDifferenceOrder(finiteDifferenceOrder);
+  ITK_TEST_SET_GET_VALUE(finiteDifferenceOrder, principalStrainFilter->GetFiniteDifferenceOrder());
+  ITK_TRY_EXPECT_NO_EXCEPTION(principalStrainFilter->Update());
+  if (principalStrainFilter->GetPrincipalDirectionOutput(0)->GetBufferPointer() != nullptr)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The principal directions are allocated without ComputePrincipalDirections." << std::endl;
+    return EXIT_FAILURE;
+  }
+  typename PrincipalStrainImageType::Pointer principalStrainsOnly = principalStrainFilter->GetPrincipalStrainOutput();
+  principalStrainsOnly->DisconnectPipeline();
+
+  ITK_TEST_SET_GET_BOOLEAN(principalStrainFilter, ComputePrincipalDirections, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(principalStrainFilter->Update());
+
+  const TensorImageType *                                 strain = strainFilter->GetOutput();
+  const typename TensorImageType::RegionType              region = strain->GetBufferedRegion();
+  itk::ImageRegionConstIterator<TensorImageType>          strainIt(strain, region);
+  itk::ImageRegionConstIterator<PrincipalStrainImageType> principalStrainsOnlyIt(principalStrainsOnly, region);
+  itk::ImageRegionConstIterator<PrincipalStrainImageType> principalStrainsIt(
+    principalStrainFilter->GetPrincipalStrainOutput(), region);
+  std::vector<itk::ImageRegionConstIterator<PrincipalStrainImageType>> directionIts;
+  for (unsigned int k = 0; k < Dimension; ++k)
+  {
+    directionIts.emplace_back(principalStrainFilter->GetPrincipalDirectionOutput(k), region);
+  }
+  for (; !strainIt.IsAtEnd(); ++strainIt, ++principalStrainsOnlyIt, ++principalStrainsIt)
+  {
+    const TensorType tensor = strainIt.Get();
+    double           scale = 0.0;
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      scale = std::max(scale, static_cast<double>(std::abs(tensor[c])));
+    }
+
+    typename TensorType::EigenValuesArrayType expected;
+    tensor.ComputeEigenValues(expected);
+    double error = 0.0;
+    for (unsigned int k = 0; k < Dimension; ++k)
+    {
+      const double principalStrain = principalStrainsIt.Get()[k];
+      error = std::max(error, std::abs(principalStrain - expected[k]));
+      error = std::max(error, std::abs(principalStrainsOnlyIt.Get()[k] - principalStrain));
+
+      const typename PrincipalStrainImageType::PixelType direction = directionIts[k].Get();
+      for (unsigned int i = 0; i < Dimension; ++i)
+      {
+        double residual = -principalStrain * direction[i];
+        for (unsigned int j = 0; j < Dimension; ++j)
+        {
+          residual += tensor(i, j) * direction[j];
+        }
+        error = std::max(error, std::abs(residual));
+      }
+      ++directionIts[k];
+    }
+    if (error > tolerance * (1.0 + scale))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Principal strains of " << tensor << " at index " << strainIt.GetIndex() << ": expected "
+                << expected << " but got " << principalStrainsIt.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int
+itkPrincipalStrainImageFilterTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " inputDisplacementImage strainForm";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const char * inputDisplacementImageFileName = argv[1];
+
+  int strainForm = 0;
+  if (!strcmp(argv[2], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[2], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[2], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else if (!strcmp(argv[2], "HENCKY"))
+  {
+    strainForm = 3;
+  }
+  else if (!strcmp(argv[2], "BIOT"))
+  {
+    strainForm = 4;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using PixelType = float;
+  using InputImageType2D = itk::Image<itk::Vector<PixelType, 2>, 2>;
+  using InputImageType3D = itk::Image<itk::Vector<PixelType, 3>, 3>;
+
+  InputImageType2D::Pointer inputDisplacements2D;
+  if (ReadInDisplacements<InputImageType2D>(inputDisplacementImageFileName, inputDisplacements2D) == EXIT_FAILURE)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  inputDisplacements2D->DisconnectPipeline();
+
+  auto principalStrainFilter = itk::PrincipalStrainImageFilter<InputImageType2D>::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(principalStrainFilter, PrincipalStrainImageFilter, ImageToImageFilter);
+
+  // Only the orders 2, 4, and 6 have a stencil.
+  principalStrainFilter->SetInput(inputDisplacements2D);
+  principalStrainFilter->SetFiniteDifferenceOrder(3);
+  ITK_TRY_EXPECT_EXCEPTION(principalStrainFilter->Update());
+
+  for (unsigned int finiteDifferenceOrder = 2; finiteDifferenceOrder <= 6; finiteDifferenceOrder += 2)
+  {
+    if (ComparePrincipalStrains(inputDisplacements2D.GetPointer(), strainForm, finiteDifferenceOrder, 1e-5) ==
+        EXIT_FAILURE)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A random 3D field, with a uniaxial stretch in a corner, where two
+  // principal strains are equal.
+  auto                         inputDisplacements3D = InputImageType3D::New();
+  InputImageType3D::SizeType   size = { { 17, 12, 9 } };
+  InputImageType3D::RegionType region(size);
+  inputDisplacements3D->SetRegions(region);
+  InputImageType3D::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.0;
+  spacing[2] = 1.6;
+  inputDisplacements3D->SetSpacing(spacing);
+  inputDisplacements3D->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(41);
+  for (itk::ImageRegionIterator<InputImageType3D> it(inputDisplacements3D, region); !it.IsAtEnd(); ++it)
+  {
+    const InputImageType3D::IndexType index = it.GetIndex();
+    InputImageType3D::PixelType       displacement;
+    if (index[0] < 6 && index[1] < 6 && index[2] < 6)
+    {
+      displacement.Fill(0.0f);
+      displacement[0] = 0.01f * index[0];
+    }
+    else
+    {
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        displacement[i] = static_cast<PixelType>(generator->GetUniformVariate(-0.1, 0.1));
+      }
+    }
+    it.Set(displacement);
+  }
+
+  if (ComparePrincipalStrains(inputDisplacements3D.GetPointer(), strainForm, 2, 1e-5) == EXIT_FAILURE)
+  {
+    return EXIT_FAILURE;
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkSplitComponentsImageFilter.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+namespace
+{
+
+// Split the input, on a region smaller than its buffer and with the given
+// components mask, and compare the outputs and the component views to the
+// input pixels.
+template <typename TInputImage, unsigned int VComponents>
+bool
+TestSplitComponents(TInputImage * input, const itk::FixedArray<bool, VComponents> & componentsMask)
+{
+  using OutputImageType = itk::Image<double, TInputImage::ImageDimension>;
+  using SplitFilterType = itk::SplitComponentsImageFilter<TInputImage, OutputImageType, VComponents>;
+
+  auto splitFilter = SplitFilterType::New();
+  splitFilter->SetInput(input);
+  splitFilter->SetComponentsMask(componentsMask);
+
+  typename TInputImage::RegionType region = input->GetBufferedRegion();
+  region.ShrinkByRadius(1);
+  splitFilter->GetOutput(0)->SetRequestedRegion(region);
+  ITK_TRY_EXPECT_NO_EXCEPTION(splitFilter->Update());
+
+  for (unsigned int c = 0; c < VComponents; ++c)
+  {
+    const OutputImageType * output = splitFilter->GetOutput(c);
+    if (componentsMask[c] != (output->GetBufferPointer() != nullptr))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Only the components of the mask are allocated, not " << c << std::endl;
+      return false;
+    }
+    const auto view = splitFilter->GetComponentView(c);
+    for (itk::ImageRegionConstIteratorWithIndex<TInputImage> it(input, region); !it.IsAtEnd(); ++it)
+    {
+      const auto expected = static_cast<double>(it.Get()[c]);
+      if (componentsMask[c] && output->GetPixel(it.GetIndex()) != expected)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Component " << c << " differs at index " << it.GetIndex() << ": expected " << expected
+                  << " but got " << output->GetPixel(it.GetIndex()) << std::endl;
+        return false;
+      }
+      if (static_cast<double>(view->GetPixel(it.GetIndex())) != expected)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "View of component " << c << " differs at index " << it.GetIndex() << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int
+itkSplitComponentsImageFilterTest(int, char *[])
+{
+  constexpr unsigned int Dimension = 3;
+  using DisplacementImageType = itk::Image<itk::Vector<float, Dimension>, Dimension>;
+  using TensorImageType = itk::Image<itk::SymmetricSecondRankTensor<float, Dimension>, Dimension>;
+  using VectorImageType = itk::VectorImage<float, Dimension>;
+  constexpr unsigned int TensorComponents = 6;
+
+  DisplacementImageType::IndexType start;
+  start[0] = 2;
+  start[1] = -3;
+  start[2] = 1;
+  DisplacementImageType::SizeType size;
+  size[0] = 13;
+  size[1] = 8;
+  size[2] = 5;
+  const DisplacementImageType::RegionType region(start, size);
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(5);
+
+  auto displacements = DisplacementImageType::New();
+  displacements->SetRegions(region);
+  displacements->Allocate();
+  for (itk::ImageRegionIterator<DisplacementImageType> it(displacements, region); !it.IsAtEnd(); ++it)
+  {
+    DisplacementImageType::PixelType displacement;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      displacement[d] = generator->GetUniformVariate(-1.0, 1.0);
+    }
+    it.Set(displacement);
+  }
+
+  auto tensors = TensorImageType::New();
+  tensors->SetRegions(region);
+  tensors->Allocate();
+  for (itk::ImageRegionIterator<TensorImageType> it(tensors, region); !it.IsAtEnd(); ++it)
+  {
+    TensorImageType::PixelType tensor;
+    for (unsigned int c = 0; c < TensorComponents; ++c)
+    {
+      tensor[c] = generator->GetUniformVariate(-1.0, 1.0);
+    }
+    it.Set(tensor);
+  }
+
+  // Four components, of which the first three are split.
+  auto vectors = VectorImageType::New();
+  vectors->SetRegions(region);
+  vectors->SetVectorLength(Dimension + 1);
+  vectors->Allocate();
+  for (itk::ImageRegionIterator<VectorImageType> it(vectors, region); !it.IsAtEnd(); ++it)
+  {
+    VectorImageType::PixelType vector(Dimension + 1);
+    for (unsigned int c = 0; c < Dimension + 1; ++c)
+    {
+      vector[c] = generator->GetUniformVariate(-1.0, 1.0);
+    }
+    it.Set(vector);
+  }
+
+  using SplitFilterType = itk::SplitComponentsImageFilter<DisplacementImageType, itk::Image<float, Dimension>>;
+  auto splitFilter = SplitFilterType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(splitFilter, SplitComponentsImageFilter, ImageToImageFilter);
+
+  itk::FixedArray<bool, Dimension> allComponents;
+  allComponents.Fill(true);
+  itk::FixedArray<bool, Dimension> someComponents = allComponents;
+  someComponents[1] = false;
+  itk::FixedArray<bool, TensorComponents> allTensorComponents;
+  allTensorComponents.Fill(true);
+  itk::FixedArray<bool, TensorComponents> someTensorComponents = allTensorComponents;
+  someTensorComponents[0] = someTensorComponents[4] = false;
+
+  if (!TestSplitComponents(displacements.GetPointer(), allComponents) ||
+      !TestSplitComponents(displacements.GetPointer(), someComponents) ||
+      !TestSplitComponents(tensors.GetPointer(), allTensorComponents) ||
+      !TestSplitComponents(tensors.GetPointer(), someTensorComponents) ||
+      !TestSplitComponents(vectors.GetPointer(), allComponents) ||
+      !TestSplitComponents(vectors.GetPointer(), someComponents))
+  {
+    return EXIT_FAILURE;
+  }
+
+  splitFilter->SetInput(displacements);
+  ITK_TRY_EXPECT_EXCEPTION(splitFilter->GetComponentView(Dimension));
+
+  // A VectorImage needs as many components as are split.
+  using VectorSplitFilterType = itk::SplitComponentsImageFilter<VectorImageType, itk::Image<float, Dimension>, 5>;
+  auto vectorSplitFilter = VectorSplitFilterType::New();
+  vectorSplitFilter->SetInput(vectors);
+  ITK_TRY_EXPECT_EXCEPTION(vectorSplitFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
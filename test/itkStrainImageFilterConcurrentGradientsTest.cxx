@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkGradientImageFilter.h"
+#include "itkGradientRecursiveGaussianImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <vector>
+
+int
+itkStrainImageFilterConcurrentGradientsTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " imageSize gradient [numberOfRepetitions]";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const unsigned int imageSize = std::stoi(argv[1]);
+  const std::string  gradient = argv[2];
+  unsigned int       numberOfRepetitions = 3;
+  if (argc > 3)
+  {
+    numberOfRepetitions = std::stoi(argv[3]);
+  }
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using GradientOutputImageType = StrainFilterType::GradientOutputImageType;
+  using GradientFilterType = StrainFilterType::GradientFilterType;
+  using ComponentImageType = itk::Image<PixelType, Dimension>;
+
+  // A smooth synthetic displacement field.
+  InputImageType::Pointer    displacements = InputImageType::New();
+  InputImageType::RegionType region;
+  region.SetSize(InputImageType::SizeType::Filled(imageSize));
+  displacements->SetRegions(region);
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.5;
+  displacements->SetSpacing(spacing);
+  displacements->Allocate();
+  itk::ImageRegionIteratorWithIndex<InputImageType> displacementIt(displacements, region);
+  for (; !displacementIt.IsAtEnd(); ++displacementIt)
+  {
+    const InputImageType::IndexType index = displacementIt.GetIndex();
+    DisplacementVectorType          displacement;
+    displacement[0] = 0.5 * std::sin(0.1 * index[0]) * std::cos(0.05 * index[1]);
+    displacement[1] = 0.3 * std::cos(0.07 * index[1] + 0.02 * index[2]);
+    displacement[2] = 0.2 * std::sin(0.03 * index[0] * index[2] / static_cast<double>(imageSize));
+    displacementIt.Set(displacement);
+  }
+
+  // Sequential and concurrent gradient pipelines.
+  using GaussianGradientFilterType =
+    itk::GradientRecursiveGaussianImageFilter<ComponentImageType, GradientOutputImageType>;
+  constexpr double          sigma = 1.5;
+  StrainFilterType::Pointer strainFilters[2];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(displacements);
+    strainFilter->SetStrainForm(StrainFilterType::GREENLAGRANGIAN);
+    if (gradient == "RecursiveGaussian")
+    {
+      GaussianGradientFilterType::Pointer gradientFilter = GaussianGradientFilterType::New();
+      gradientFilter->SetSigma(sigma);
+      strainFilter->SetGradientFilter(gradientFilter.GetPointer());
+    }
+    else if (gradient != "Gradient")
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Unknown gradient: " << gradient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  ITK_TEST_SET_GET_BOOLEAN(strainFilters[1], ConcurrentGradients, true);
+  std::vector<GradientFilterType::Pointer> componentGradientFilters;
+
+  ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->SetComponentGradientFilter(Dimension, nullptr));
+  ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->GetComponentGradientFilter(Dimension));
+  if (gradient == "RecursiveGaussian")
+  {
+    // The sigma of the GradientFilter cannot be copied to the other
+    // components, they need their own filters.
+    ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->Update());
+
+    GaussianGradientFilterType::Pointer sharedGradientFilter = GaussianGradientFilterType::New();
+    sharedGradientFilter->SetSigma(sigma);
+    for (unsigned int i = 1; i < Dimension; ++i)
+    {
+      strainFilters[1]->SetComponentGradientFilter(i, sharedGradientFilter);
+    }
+    ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->Update());
+
+    for (unsigned int i = 1; i < Dimension; ++i)
+    {
+      GaussianGradientFilterType::Pointer componentGradientFilter = GaussianGradientFilterType::New();
+      componentGradientFilter->SetSigma(sigma);
+      strainFilters[1]->SetComponentGradientFilter(i, componentGradientFilter);
+      ITK_TEST_SET_GET_VALUE(componentGradientFilter.GetPointer(), strainFilters[1]->GetComponentGradientFilter(i));
+      componentGradientFilters.push_back(componentGradientFilter.GetPointer());
+    }
+  }
+  else
+  {
+    // The first component may have its own filter, while the others get new
+    // ones with the default GradientFilter.
+    using DefaultGradientFilterType = itk::GradientImageFilter<ComponentImageType, PixelType, PixelType>;
+    DefaultGradientFilterType::Pointer componentGradientFilter = DefaultGradientFilterType::New();
+    strainFilters[1]->SetComponentGradientFilter(0, componentGradientFilter);
+    componentGradientFilters.push_back(componentGradientFilter.GetPointer());
+  }
+
+  // The buffers of the component images read by the gradient filters.
+  std::vector<ComponentImageType::PixelContainer::ConstPointer> componentBuffers(componentGradientFilters.size());
+  for (size_t f = 0; f < componentGradientFilters.size(); ++f)
+  {
+    const GradientFilterType * componentGradientFilter = componentGradientFilters[f];
+    componentGradientFilters[f]->AddObserver(
+      itk::StartEvent(), [componentGradientFilter, &componentBuffers, f](const itk::EventObject &) {
+        componentBuffers[f] = componentGradientFilter->GetInput()->GetPixelContainer();
+      });
+  }
+
+  itk::TimeProbe probes[2];
+  for (unsigned int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    for (unsigned int ii = 0; ii < 2; ++ii)
+    {
+      strainFilters[ii]->Modified();
+      probes[ii].Start();
+      ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[ii]->Update());
+      probes[ii].Stop();
+    }
+  }
+
+  // The gradient filters drop the component images once they ran, so that the
+  // buffers are released before the tensors are assembled.
+  for (size_t f = 0; f < componentGradientFilters.size(); ++f)
+  {
+    if (componentGradientFilters[f]->GetInput() != nullptr || componentBuffers[f].IsNull() ||
+        componentBuffers[f]->GetReferenceCount() != 1)
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "The buffer of a component image is still referenced after the update." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Image size: " << imageSize << "^" << Dimension << ", gradient: " << gradient << std::endl;
+  std::cout << "Sequential gradients mean time: " << probes[0].GetMean() << probes[0].GetUnit() << std::endl;
+  std::cout << "Concurrent gradients mean time: " << probes[1].GetMean() << probes[1].GetUnit() << std::endl;
+  std::cout << "Speedup: " << probes[0].GetMean() / probes[1].GetMean() << std::endl;
+
+
+  const TensorImageType *                        sequential = strainFilters[0]->GetOutput();
+  const TensorImageType *                        concurrent = strainFilters[1]->GetOutput();
+  itk::ImageRegionConstIterator<TensorImageType> sequentialIt(sequential, region);
+  itk::ImageRegionConstIterator<TensorImageType> concurrentIt(concurrent, region);
+  for (; !sequentialIt.IsAtEnd(); ++sequentialIt, ++concurrentIt)
+  {
+    const TensorImageType::PixelType sequentialPixel = sequentialIt.Get();
+    const TensorImageType::PixelType concurrentPixel = concurrentIt.Get();
+    for (unsigned int ii = 0; ii < TensorImageType::PixelType::InternalDimension; ++ii)
+    {
+      if (std::abs(sequentialPixel[ii] - concurrentPixel[ii]) > 1e-6f)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Concurrent output differs at index " << sequentialIt.GetIndex() << ": expected "
+                  << sequentialPixel << " but got " << concurrentPixel << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMatrix.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <string>
+#include <utility>
+
+int
+itkStrainImageFilterLargeDeformationTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " gradient";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string gradient = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+  using MatrixType = itk::Matrix<double, Dimension, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using TensorType = TensorImageType::PixelType;
+
+  // A homogeneous deformation F = R U, whose stretch U = Q diag(s) Q^T has
+  // principal stretches well away from 1, and a rotation R that the material
+  // strains do not depend on.
+  const double stretches[Dimension] = { 1.6, 0.7, 1.25 };
+  const auto   rotation = [](unsigned int axis, double angle) {
+    MatrixType         matrix;
+    const unsigned int i = (axis + 1) % Dimension;
+    const unsigned int j = (axis + 2) % Dimension;
+    matrix.SetIdentity();
+    matrix(i, i) = std::cos(angle);
+    matrix(i, j) = -std::sin(angle);
+    matrix(j, i) = std::sin(angle);
+    matrix(j, j) = std::cos(angle);
+    return matrix;
+  };
+  const MatrixType principalAxes = rotation(0, 0.4) * rotation(2, -0.7);
+  const MatrixType rigidRotation = rotation(1, 0.9) * rotation(0, -0.3);
+  MatrixType       principalStretches;
+  principalStretches.Fill(0.0);
+  for (unsigned int k = 0; k < Dimension; ++k)
+  {
+    principalStretches(k, k) = stretches[k];
+  }
+  const MatrixType deformationGradient =
+    rigidRotation * principalAxes * principalStretches * MatrixType(principalAxes.GetTranspose());
+
+  InputImageType::SizeType size;
+  size[0] = 17;
+  size[1] = 13;
+  size[2] = 9;
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.8;
+  spacing[2] = 1.1;
+  InputImageType::PointType origin;
+  origin[0] = -3.0;
+  origin[1] = 1.0;
+  origin[2] = -2.0;
+
+  auto displacements = InputImageType::New();
+  displacements->SetRegions(size);
+  displacements->SetSpacing(spacing);
+  displacements->SetOrigin(origin);
+  displacements->Allocate();
+  for (itk::ImageRegionIterator<InputImageType> it(displacements, displacements->GetBufferedRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    InputImageType::PointType point;
+    displacements->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    DisplacementVectorType displacement;
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      double value = -point[i];
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        value += deformationGradient(i, j) * point[j];
+      }
+      displacement[i] = value;
+    }
+    it.Set(displacement);
+  }
+
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(displacements);
+  if (gradient == "Fused")
+  {
+    strainFilter->FusedGradientOn();
+  }
+  else if (gradient == "LowMemory")
+  {
+    strainFilter->LowMemoryOn();
+  }
+  else if (gradient != "Gradient")
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown gradient: " << gradient << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The finite differences of a linear displacement are exact away from the
+  // boundary.
+  TensorImageType::RegionType interiorRegion = displacements->GetBufferedRegion();
+  interiorRegion.ShrinkByRadius(1);
+
+  const std::pair<StrainFilterType::StrainFormType, double (*)(double)> strainForms[] = {
+    { StrainFilterType::HENCKY, [](double stretch) { return std::log(stretch); } },
+    { StrainFilterType::BIOT, [](double stretch) { return stretch - 1.0; } }
+  };
+  for (const auto & strainForm : strainForms)
+  {
+    strainFilter->SetStrainForm(strainForm.first);
+    ITK_TEST_SET_GET_VALUE(strainForm.first, strainFilter->GetStrainForm());
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+    // Q diag(f(s)) Q^T
+    TensorType expected;
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      for (unsigned int j = i; j < Dimension; ++j)
+      {
+        double value = 0.0;
+        for (unsigned int k = 0; k < Dimension; ++k)
+        {
+          value += strainForm.second(stretches[k]) * principalAxes(i, k) * principalAxes(j, k);
+        }
+        expected(i, j) = value;
+      }
+    }
+
+    constexpr double tolerance = 1e-4;
+    for (itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilter->GetOutput(), interiorRegion);
+         !strainIt.IsAtEnd();
+         ++strainIt)
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (std::abs(strainIt.Get()[c] - expected[c]) > tolerance)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Strain form " << strainForm.first << ": expected " << expected << " at index "
+                    << strainIt.GetIndex() << " but got " << strainIt.Get() << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(StrainFilterType::BIOT + 1));
+  ITK_TRY_EXPECT_EXCEPTION(strainFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include "ReadInDisplacements.h"
+
+#include <cmath>
+#include <cstring>
+
+int
+itkStrainImageFilterMaskTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " inputDisplacementImage strainForm gradient";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const char *      inputDisplacementImageFileName = argv[1];
+  const std::string gradient = argv[3];
+
+  constexpr unsigned int Dimension = 2;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using TensorType = TensorImageType::PixelType;
+  using MaskImageType = StrainFilterType::MaskImageType;
+
+  int strainForm = 0;
+  if (!strcmp(argv[2], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[2], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[2], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  InputImageType::Pointer inputDisplacements;
+  if (ReadInDisplacements<InputImageType>(inputDisplacementImageFileName, inputDisplacements) == EXIT_FAILURE)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  inputDisplacements->DisconnectPipeline();
+
+  // An irregular mask: random pixels, many isolated, plus a full scanline and
+  // a rectangle, so that the runs have very different lengths.
+  const InputImageType::RegionType & region = inputDisplacements->GetLargestPossibleRegion();
+  auto                               mask = MaskImageType::New();
+  mask->CopyInformation(inputDisplacements);
+  mask->SetRegions(region);
+  mask->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(11);
+  for (itk::ImageRegionIterator<MaskImageType> it(mask, region); !it.IsAtEnd(); ++it)
+  {
+    const MaskImageType::OffsetType offset = it.GetIndex() - region.GetIndex();
+    const bool inRectangle = offset[0] >= 3 && offset[0] < 20 && offset[1] >= 5 && offset[1] < 9;
+    const bool onLine = offset[1] == static_cast<itk::OffsetValueType>(region.GetSize(1) / 2);
+    it.Set(inRectangle || onLine || generator->GetUniformVariate(0.0, 1.0) < 0.2 ? 1 : 0);
+  }
+
+  StrainFilterType::Pointer strainFilters[3];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(inputDisplacements);
+    strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(strainForm));
+    if (gradient == "Fused")
+    {
+      strainFilter->FusedGradientOn();
+    }
+    else if (gradient == "LowMemory")
+    {
+      strainFilter->LowMemoryOn();
+    }
+    else if (gradient != "Gradient")
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Unknown gradient: " << gradient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The work units split the runs of the mask.
+  strainFilters[1]->SetMaskImage(mask);
+  ITK_TEST_SET_GET_VALUE(mask.GetPointer(), strainFilters[1]->GetMaskImage());
+  strainFilters[1]->SetNumberOfWorkUnits(7);
+  strainFilters[2]->SetMaskImage(mask);
+  ITK_TEST_SET_GET_BOOLEAN(strainFilters[2], CompactMaskedOutput, true);
+
+  for (auto & strainFilter : strainFilters)
+  {
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  }
+
+  if (strainFilters[2]->GetOutput()->GetBufferPointer() != nullptr)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The output is allocated with CompactMaskedOutput." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!strainFilters[1]->GetMaskedIndices().empty() || !strainFilters[1]->GetMaskedTensors().empty())
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The compact list is filled without CompactMaskedOutput." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The strain matches the unmasked strain at the mask pixels, and is zero
+  // elsewhere.  The compact list holds the mask pixels in buffer order.
+  const StrainFilterType::MaskedIndicesType & maskedIndices = strainFilters[2]->GetMaskedIndices();
+  const StrainFilterType::MaskedTensorsType & maskedTensors = strainFilters[2]->GetMaskedTensors();
+  ITK_TEST_EXPECT_EQUAL(maskedIndices.size(), maskedTensors.size());
+
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilters[0]->GetOutput(), region);
+  itk::ImageRegionConstIterator<TensorImageType> maskedStrainIt(strainFilters[1]->GetOutput(), region);
+  itk::ImageRegionConstIterator<MaskImageType>   maskIt(mask, region);
+  size_t                                         maskPixel = 0;
+  for (; !strainIt.IsAtEnd(); ++strainIt, ++maskedStrainIt, ++maskIt)
+  {
+    const TensorType & strain = strainIt.Get();
+    const TensorType & maskedStrain = maskedStrainIt.Get();
+    if (!maskIt.Get())
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (maskedStrain[c] != 0.0f)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Nonzero strain " << maskedStrain << " outside of the mask at index " << strainIt.GetIndex()
+                    << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+      continue;
+    }
+
+    if (maskPixel >= maskedIndices.size() || maskedIndices[maskPixel] != strainIt.GetIndex())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Mask pixel " << maskPixel << " at index " << strainIt.GetIndex()
+                << " is missing from the compact list." << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (std::abs(maskedStrain[c] - strain[c]) > 1e-6 * (1.0 + std::abs(strain[c])) ||
+          maskedTensors[maskPixel][c] != maskedStrain[c])
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Masked strain differs at index " << strainIt.GetIndex() << ": expected " << strain
+                  << " but got " << maskedStrain << " and " << maskedTensors[maskPixel] << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    ++maskPixel;
+  }
+  ITK_TEST_EXPECT_EQUAL(maskPixel, maskedIndices.size());
+
+  // An empty mask produces a zero output.
+  auto emptyMask = MaskImageType::New();
+  emptyMask->CopyInformation(inputDisplacements);
+  emptyMask->SetRegions(region);
+  emptyMask->Allocate(true);
+  strainFilters[1]->SetMaskImage(emptyMask);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[1]->Update());
+  itk::ImageRegionConstIterator<TensorImageType> emptyMaskStrainIt(strainFilters[1]->GetOutput(), region);
+  for (; !emptyMaskStrainIt.IsAtEnd(); ++emptyMaskStrainIt)
+  {
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (emptyMaskStrainIt.Get()[c] != 0.0f)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Nonzero strain with an empty mask at index " << emptyMaskStrainIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <string>
+
+namespace
+{
+
+// The (i, j) indices of the components in Voigt order.
+constexpr unsigned int VoigtComponents[6][2] = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 1, 2 }, { 0, 2 }, { 0, 1 } };
+
+// Compare the components of the strain filter to the tensors, or to zero
+// outside of the mask.
+template <typename TStrainFilter, typename TTensorImage, typename TMaskImage>
+bool
+CompareOutputLayout(TStrainFilter * strainFilter, const TTensorImage * expected, const TMaskImage * mask)
+{
+  using ComponentImageType = typename TStrainFilter::ComponentImageType;
+  using VoigtImageType = typename TStrainFilter::VoigtImageType;
+  using TensorType = typename TTensorImage::PixelType;
+
+  const bool             components = strainFilter->GetOutputLayout() == TStrainFilter::COMPONENTIMAGES;
+  const VoigtImageType * voigtImage = strainFilter->GetVoigtOutput();
+  const TTensorImage *   tensorImage = strainFilter->GetOutput();
+  const auto &           region = expected->GetBufferedRegion();
+  if (tensorImage->GetBufferPointer() != nullptr || (components == (voigtImage->GetBufferPointer() != nullptr)))
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Outputs of other layouts are allocated." << std::endl;
+    return false;
+  }
+
+  for (itk::ImageRegionConstIterator<TTensorImage> expectedIt(expected, region); !expectedIt.IsAtEnd(); ++expectedIt)
+  {
+    const auto & index = expectedIt.GetIndex();
+    TensorType   tensor = expectedIt.Get();
+    if (mask != nullptr && !mask->GetPixel(index))
+    {
+      tensor.Fill(0.0f);
+    }
+    for (unsigned int k = 0; k < TStrainFilter::TensorComponents; ++k)
+    {
+      const ComponentImageType * componentImage = strainFilter->GetComponentOutput(k);
+      if ((components && componentImage->GetBufferPointer() == nullptr) ||
+          (!components && componentImage->GetBufferPointer() != nullptr))
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Component image " << k << " is allocated only with the COMPONENTIMAGES layout." << std::endl;
+        return false;
+      }
+      const auto expectedComponent = tensor(VoigtComponents[k][0], VoigtComponents[k][1]);
+      const auto component = components ? componentImage->GetPixel(index) : voigtImage->GetPixel(index)[k];
+      if (component != expectedComponent)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Component " << k << " differs at index " << index << ": expected " << expectedComponent
+                  << " but got " << component << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int
+itkStrainImageFilterOutputLayoutTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " gradient";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string gradient = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using VoigtImageType = StrainFilterType::VoigtImageType;
+  using MaskImageType = StrainFilterType::MaskImageType;
+
+  // A smooth displacement plus noise, with an oblique direction.
+  InputImageType::SizeType size;
+  size[0] = 21;
+  size[1] = 17;
+  size[2] = 9;
+  InputImageType::IndexType start;
+  start[0] = -3;
+  start[1] = 5;
+  start[2] = 0;
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.0;
+  spacing[2] = 1.4;
+  InputImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[1][1] = direction[2][2] = std::cos(0.2);
+  direction[1][2] = -std::sin(0.2);
+  direction[2][1] = std::sin(0.2);
+  const InputImageType::RegionType region(start, size);
+
+  auto displacements = InputImageType::New();
+  displacements->SetRegions(region);
+  displacements->SetSpacing(spacing);
+  displacements->SetDirection(direction);
+  displacements->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(17);
+  for (itk::ImageRegionIterator<InputImageType> it(displacements, region); !it.IsAtEnd(); ++it)
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    DisplacementVectorType          displacement;
+    displacement[0] = 0.1 * std::sin(0.3 * index[0]) + 0.02 * index[2] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[1] = 0.04 * index[0] - 0.03 * index[1] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[2] = 0.2 * std::cos(0.2 * index[1]) + generator->GetUniformVariate(-0.01, 0.01);
+    it.Set(displacement);
+  }
+
+  auto mask = MaskImageType::New();
+  mask->SetRegions(region);
+  mask->SetSpacing(spacing);
+  mask->SetDirection(direction);
+  mask->Allocate();
+  for (itk::ImageRegionIterator<MaskImageType> it(mask, region); !it.IsAtEnd(); ++it)
+  {
+    it.Set(generator->GetUniformVariate(0.0, 1.0) < 0.4 ? 1 : 0);
+  }
+
+  StrainFilterType::Pointer strainFilters[3];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(displacements);
+    strainFilter->SetStrainForm(StrainFilterType::GREENLAGRANGIAN);
+    if (gradient == "Fused")
+    {
+      strainFilter->FusedGradientOn();
+    }
+    else if (gradient == "LowMemory")
+    {
+      strainFilter->LowMemoryOn();
+    }
+    else if (gradient != "Gradient")
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Unknown gradient: " << gradient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ITK_TEST_SET_GET_VALUE(StrainFilterType::TENSORIMAGE, strainFilters[0]->GetOutputLayout());
+  strainFilters[1]->SetOutputLayout(StrainFilterType::COMPONENTIMAGES);
+  ITK_TEST_SET_GET_VALUE(StrainFilterType::COMPONENTIMAGES, strainFilters[1]->GetOutputLayout());
+  strainFilters[2]->SetOutputLayout(StrainFilterType::VOIGTIMAGE);
+  ITK_TEST_SET_GET_VALUE(StrainFilterType::VOIGTIMAGE, strainFilters[2]->GetOutputLayout());
+  for (auto & strainFilter : strainFilters)
+  {
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  }
+  const TensorImageType * expected = strainFilters[0]->GetOutput();
+
+  ITK_TEST_EXPECT_EQUAL(strainFilters[2]->GetVoigtOutput()->GetNumberOfComponentsPerPixel(), 6u);
+  for (unsigned int l = 1; l < 3; ++l)
+  {
+    if (!CompareOutputLayout(strainFilters[l].GetPointer(), expected, static_cast<MaskImageType *>(nullptr)))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The VectorImage is streamed like the tensor image.
+  using StreamingFilterType = itk::StreamingImageFilter<VoigtImageType, VoigtImageType>;
+  auto streamingFilter = StreamingFilterType::New();
+  streamingFilter->SetInput(strainFilters[2]->GetVoigtOutput());
+  streamingFilter->SetNumberOfStreamDivisions(3);
+  ITK_TRY_EXPECT_NO_EXCEPTION(streamingFilter->Update());
+  itk::ImageRegionConstIterator<VoigtImageType> streamedIt(streamingFilter->GetOutput(), region);
+  itk::ImageRegionConstIterator<TensorImageType> expectedIt(expected, region);
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++streamedIt)
+  {
+    for (unsigned int k = 0; k < StrainFilterType::TensorComponents; ++k)
+    {
+      if (streamedIt.Get()[k] != expectedIt.Get()(VoigtComponents[k][0], VoigtComponents[k][1]))
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Streamed component " << k << " differs at index " << expectedIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // With a mask, the components are zero outside of the mask.
+  strainFilters[1]->SetMaskImage(mask);
+  strainFilters[2]->SetMaskImage(mask);
+  for (unsigned int l = 1; l < 3; ++l)
+  {
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[l]->Update());
+    if (!CompareOutputLayout(strainFilters[l].GetPointer(), expected, mask.GetPointer()))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Back to the tensor image, the component images are released.
+  strainFilters[1]->SetMaskImage(nullptr);
+  strainFilters[1]->SetOutputLayout(StrainFilterType::TENSORIMAGE);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[1]->Update());
+  for (unsigned int k = 0; k < StrainFilterType::TensorComponents; ++k)
+  {
+    ITK_TEST_EXPECT_TRUE(strainFilters[1]->GetComponentOutput(k)->GetBufferPointer() == nullptr);
+  }
+  itk::ImageRegionConstIterator<TensorImageType> tensorIt(strainFilters[1]->GetOutput(), region);
+  for (expectedIt.GoToBegin(); !expectedIt.IsAtEnd(); ++expectedIt, ++tensorIt)
+  {
+    if (tensorIt.Get() != expectedIt.Get())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain differs at index " << expectedIt.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  strainFilters[1]->SetOutputLayout(static_cast<StrainFilterType::OutputLayoutType>(3));
+  ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
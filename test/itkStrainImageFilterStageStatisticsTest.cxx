@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkVectorGradientRecursiveGaussianImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+int
+itkStrainImageFilterStageStatisticsTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " gradient";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string gradient = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using GradientOutputImageType = StrainFilterType::GradientOutputImageType;
+  using VectorGradientFilterType =
+    itk::VectorGradientRecursiveGaussianImageFilter<InputImageType, GradientOutputImageType>;
+
+  InputImageType::SizeType size;
+  size[0] = 24;
+  size[1] = 19;
+  size[2] = 11;
+  const InputImageType::RegionType region(size);
+  const itk::SizeValueType         numberOfPixels = region.GetNumberOfPixels();
+
+  auto displacements = InputImageType::New();
+  displacements->SetRegions(region);
+  displacements->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(11);
+  for (itk::ImageRegionIterator<InputImageType> it(displacements, region); !it.IsAtEnd(); ++it)
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    DisplacementVectorType          displacement;
+    displacement[0] = 0.1 * std::sin(0.3 * index[0]) + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[1] = 0.04 * index[0] - 0.03 * index[1] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[2] = 0.2 * std::cos(0.2 * index[2]) + generator->GetUniformVariate(-0.01, 0.01);
+    it.Set(displacement);
+  }
+
+  StrainFilterType::Pointer strainFilters[2];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(displacements);
+    strainFilter->SetStrainForm(StrainFilterType::GREENLAGRANGIAN);
+    if (gradient == "Fused")
+    {
+      strainFilter->FusedGradientOn();
+    }
+    else if (gradient == "LowMemory")
+    {
+      strainFilter->LowMemoryOn();
+    }
+    else if (gradient == "Concurrent")
+    {
+      strainFilter->ConcurrentGradientsOn();
+    }
+    else if (gradient == "VectorGradient")
+    {
+      strainFilter->SetVectorGradientFilter(VectorGradientFilterType::New());
+    }
+    else if (gradient != "Gradient")
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Unknown gradient: " << gradient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  StrainFilterType * strainFilter = strainFilters[1];
+
+  // Nothing is measured by default.
+  std::vector<itk::StrainStageEvent> events;
+  strainFilter->AddObserver(itk::StrainStageEvent(), [&events](const itk::EventObject & event) {
+    events.push_back(dynamic_cast<const itk::StrainStageEvent &>(event));
+  });
+  ITK_TEST_SET_GET_VALUE(false, strainFilter->GetCollectStageStatistics());
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  ITK_TEST_EXPECT_TRUE(events.empty());
+  for (unsigned int stage = 0; stage < StrainFilterType::NumberOfStages; ++stage)
+  {
+    const auto & statistics = strainFilter->GetStageStatistics(static_cast<StrainFilterType::StageType>(stage));
+    ITK_TEST_EXPECT_EQUAL(statistics.WallTime, 0.0);
+    ITK_TEST_EXPECT_EQUAL(statistics.BytesAllocated, 0u);
+    ITK_TEST_EXPECT_EQUAL(statistics.Threads, 0u);
+  }
+
+  ITK_TEST_SET_GET_BOOLEAN(strainFilter, CollectStageStatistics, true);
+  const auto start = std::chrono::steady_clock::now();
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  const double updateTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[0]->Update());
+
+  // The strain does not depend on the instrumentation.
+  itk::ImageRegionConstIterator<TensorImageType> expectedIt(strainFilters[0]->GetOutput(), region);
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilter->GetOutput(), region);
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++strainIt)
+  {
+    if (strainIt.Get() != expectedIt.Get())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain differs at index " << expectedIt.GetIndex() << ": expected " << expectedIt.Get()
+                << " but got " << strainIt.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // One event per stage, in order, with the statistics of the filter.
+  ITK_TEST_EXPECT_EQUAL(events.size(), static_cast<size_t>(StrainFilterType::NumberOfStages));
+  if (events.size() != StrainFilterType::NumberOfStages)
+  {
+    return EXIT_FAILURE;
+  }
+  double totalWallTime = 0.0;
+  for (unsigned int stage = 0; stage < StrainFilterType::NumberOfStages; ++stage)
+  {
+    const auto   stageType = static_cast<StrainFilterType::StageType>(stage);
+    const auto & statistics = strainFilter->GetStageStatistics(stageType);
+    std::cout << StrainFilterType::GetStageName(stageType) << ": " << statistics << std::endl;
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStage(), stage);
+    ITK_TEST_EXPECT_EQUAL(std::string(events[stage].GetStageName()),
+                          std::string(StrainFilterType::GetStageName(stageType)));
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStatistics().WallTime, statistics.WallTime);
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStatistics().BytesAllocated, statistics.BytesAllocated);
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStatistics().Threads, statistics.Threads);
+    ITK_TEST_EXPECT_TRUE(statistics.WallTime >= 0.0);
+    totalWallTime += statistics.WallTime;
+  }
+  ITK_TEST_EXPECT_TRUE(totalWallTime <= updateTime);
+
+  const auto & split = strainFilter->GetStageStatistics(StrainFilterType::COMPONENTSPLIT);
+  const auto & gradients = strainFilter->GetStageStatistics(StrainFilterType::GRADIENT);
+  const auto & assembly = strainFilter->GetStageStatistics(StrainFilterType::TENSORASSEMBLY);
+  ITK_TEST_EXPECT_TRUE(gradients.Threads > 0);
+  ITK_TEST_EXPECT_TRUE(assembly.Threads > 0);
+  ITK_TEST_EXPECT_EQUAL(assembly.BytesAllocated,
+                        numberOfPixels * StrainFilterType::TensorComponents * sizeof(PixelType));
+  if (gradient == "Fused" || gradient == "VectorGradient")
+  {
+    ITK_TEST_EXPECT_EQUAL(split.WallTime, 0.0);
+    ITK_TEST_EXPECT_EQUAL(split.BytesAllocated, 0u);
+    ITK_TEST_EXPECT_EQUAL(split.Threads, 0u);
+  }
+  else
+  {
+    // The whole image is requested, so each component image spans it.
+    ITK_TEST_EXPECT_TRUE(split.Threads > 0);
+    ITK_TEST_EXPECT_EQUAL(split.BytesAllocated, Dimension * numberOfPixels * sizeof(PixelType));
+  }
+  const itk::SizeValueType gradientBytes =
+    gradient == "Fused" ? 0 : Dimension * numberOfPixels * sizeof(StrainFilterType::GradientOutputPixelType);
+  ITK_TEST_EXPECT_EQUAL(gradients.BytesAllocated, gradientBytes);
+
+  // The statistics are those of the last update.
+  strainFilter->CollectStageStatisticsOff();
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  ITK_TEST_EXPECT_EQUAL(strainFilter->GetStageStatistics(StrainFilterType::TENSORASSEMBLY).Threads, 0u);
+  ITK_TEST_EXPECT_EQUAL(events.size(), static_cast<size_t>(StrainFilterType::NumberOfStages));
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
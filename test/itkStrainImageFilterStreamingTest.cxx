@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkGradientRecursiveGaussianImageFilter.h"
+#include "itkVectorGradientRecursiveGaussianImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkStreamingImageFilter.h"
+#include "itkTestingMacros.h"
+
+#include "ReadInDisplacements.h"
+
+int
+itkStrainImageFilterStreamingTest(int argc, char * argv[])
+{
+  if (argc < 5)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " inputDisplacementImage strainForm gradient numberOfStreamDivisions";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const char *       inputDisplacementImageFileName = argv[1];
+  const std::string  gradient = argv[3];
+  const unsigned int numberOfStreamDivisions = std::stoi(argv[4]);
+
+  constexpr unsigned int Dimension = 2;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using GradientOutputImageType = StrainFilterType::GradientOutputImageType;
+
+  int strainForm = 0;
+  if (!strcmp(argv[2], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[2], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[2], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  InputImageType::Pointer inputDisplacements;
+  if (ReadInDisplacements<InputImageType>(inputDisplacementImageFileName, inputDisplacements) == EXIT_FAILURE)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  inputDisplacements->DisconnectPipeline();
+
+  // One filter computes the whole output at once, the other one is streamed.
+  StrainFilterType::Pointer strainFilters[2];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(inputDisplacements);
+    strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(strainForm));
+    if (gradient == "Fused")
+    {
+      strainFilter->FusedGradientOn();
+    }
+    else if (gradient == "RecursiveGaussian")
+    {
+      using GradientFilterType =
+        itk::GradientRecursiveGaussianImageFilter<itk::Image<PixelType, Dimension>, GradientOutputImageType>;
+      GradientFilterType::Pointer gradientFilter = GradientFilterType::New();
+      gradientFilter->SetSigma(1.0);
+      strainFilter->SetGradientFilter(gradientFilter.GetPointer());
+    }
+    else if (gradient == "VectorRecursiveGaussian")
+    {
+      using VectorGradientFilterType =
+        itk::VectorGradientRecursiveGaussianImageFilter<InputImageType, GradientOutputImageType>;
+      VectorGradientFilterType::Pointer vectorGradientFilter = VectorGradientFilterType::New();
+      vectorGradientFilter->SetSigma(1.0);
+      strainFilter->SetVectorGradientFilter(vectorGradientFilter.GetPointer());
+    }
+    else if (gradient != "Gradient")
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Unknown gradient: " << gradient << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[0]->Update());
+
+  using StreamingFilterType = itk::StreamingImageFilter<TensorImageType, TensorImageType>;
+  StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+  streamer->SetInput(strainFilters[1]->GetOutput());
+  streamer->SetNumberOfStreamDivisions(numberOfStreamDivisions);
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(streamer->Update());
+
+
+  // With a finite stencil, the last requested input region is only a padded
+  // stream piece.
+  if (gradient != "RecursiveGaussian" && gradient != "VectorRecursiveGaussian" && numberOfStreamDivisions > 1 &&
+      inputDisplacements->GetRequestedRegion() == inputDisplacements->GetLargestPossibleRegion())
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The whole input was requested: " << inputDisplacements->GetRequestedRegion() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The recursive Gaussian gradient filters produce their whole output for
+  // every stream piece, and the intermediate memory is reported accordingly.
+  if (gradient == "RecursiveGaussian" || gradient == "VectorRecursiveGaussian")
+  {
+    const TensorImageType::RegionType largestRegion = strainFilters[1]->GetOutput()->GetLargestPossibleRegion();
+    TensorImageType::RegionType       pieceRegion = largestRegion;
+    pieceRegion.SetSize(0, 1);
+    ITK_TEST_EXPECT_EQUAL(strainFilters[1]->ComputeIntermediateMemorySize(largestRegion),
+                          strainFilters[1]->ComputeIntermediateMemorySize(pieceRegion));
+    if (gradient == "VectorRecursiveGaussian")
+    {
+      ITK_TEST_EXPECT_EQUAL(Dimension * largestRegion.GetNumberOfPixels() *
+                              sizeof(StrainFilterType::GradientOutputPixelType),
+                            strainFilters[1]->ComputeIntermediateMemorySize(pieceRegion));
+    }
+  }
+
+  const TensorImageType * expected = strainFilters[0]->GetOutput();
+  const TensorImageType * streamed = streamer->GetOutput();
+  if (streamed->GetBufferedRegion() != expected->GetBufferedRegion())
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Streamed output region: " << streamed->GetBufferedRegion()
+              << " differs from the expected region: " << expected->GetBufferedRegion() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  itk::ImageRegionConstIterator<TensorImageType> expectedIt(expected, expected->GetBufferedRegion());
+  itk::ImageRegionConstIterator<TensorImageType> streamedIt(streamed, expected->GetBufferedRegion());
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++streamedIt)
+  {
+    if (expectedIt.Get() != streamedIt.Get())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Streamed output differs at index " << expectedIt.GetIndex() << ": expected " << expectedIt.Get()
+                << " but got " << streamedIt.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
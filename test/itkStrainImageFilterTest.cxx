@@ -29,7 +29,7 @@ itkStrainImageFilterTest(int argc, char * argv[])
   {
     std::cerr << "Missing parameters." << std::endl;
     std::cerr << "Usage: " << argv[0];
-    std::cerr << " inputDisplacementImage outputPrefix strainForm";
+    std::cerr << " inputDisplacementImage outputPrefix strainForm [fusedGradient] [lowMemory]";
     std::cerr << std::endl;
     return EXIT_FAILURE;
   }
@@ -92,6 +92,40 @@ itkStrainImageFilterTest(int argc, char * argv[])
   strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(strainForm));
   ITK_TEST_SET_GET_VALUE(static_cast<StrainFilterType::StrainFormType>(strainForm), strainFilter->GetStrainForm());
 
+  bool fusedGradient = false;
+  if (argc > 4)
+  {
+    fusedGradient = static_cast<bool>(std::stoi(argv[4]));
+  }
+  ITK_TEST_SET_GET_BOOLEAN(strainFilter, FusedGradient, fusedGradient);
+
+  bool lowMemory = false;
+  if (argc > 5)
+  {
+    lowMemory = static_cast<bool>(std::stoi(argv[5]));
+  }
+  ITK_TEST_SET_GET_BOOLEAN(strainFilter, LowMemory, lowMemory);
+
+  // Check the reported intermediate memory for the whole image.
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->UpdateOutputInformation());
+  const TensorImageType::RegionType region = strainFilter->GetOutput()->GetLargestPossibleRegion();
+  const itk::SizeValueType          componentImageSize = region.GetNumberOfPixels() * sizeof(PixelType);
+  const itk::SizeValueType          gradientImageSize =
+    region.GetNumberOfPixels() * sizeof(StrainFilterType::GradientOutputPixelType);
+  itk::SizeValueType expectedMemorySize = Dimension * (componentImageSize + gradientImageSize);
+  if (fusedGradient)
+  {
+    expectedMemorySize = 0;
+  }
+  else if (lowMemory)
+  {
+    expectedMemorySize = componentImageSize + gradientImageSize;
+  }
+  const auto * gradientInput = strainFilter->GetGradientFilter()->GetInput();
+  ITK_TEST_EXPECT_EQUAL(expectedMemorySize, strainFilter->ComputeIntermediateMemorySize(region));
+  // The query leaves the gradient filter connected to its previous input.
+  ITK_TEST_EXPECT_TRUE(strainFilter->GetGradientFilter()->GetInput() == gradientInput);
+
   ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
 
 
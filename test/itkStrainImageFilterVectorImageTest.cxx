@@ -0,0 +1,150 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+int
+itkStrainImageFilterVectorImageTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " gradient";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string gradient = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+  using VectorInputImageType = itk::VectorImage<PixelType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using VectorStrainFilterType = itk::StrainImageFilter<VectorInputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+
+  InputImageType::SizeType size;
+  size[0] = 19;
+  size[1] = 14;
+  size[2] = 8;
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.6;
+  spacing[1] = 1.0;
+  spacing[2] = 1.5;
+  const InputImageType::RegionType region(size);
+
+  auto displacements = InputImageType::New();
+  displacements->SetRegions(region);
+  displacements->SetSpacing(spacing);
+  displacements->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(29);
+  for (itk::ImageRegionIterator<InputImageType> it(displacements, region); !it.IsAtEnd(); ++it)
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    DisplacementVectorType          displacement;
+    displacement[0] = 0.1 * std::sin(0.3 * index[0]) + 0.02 * index[2] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[1] = 0.04 * index[0] - 0.03 * index[1] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[2] = 0.2 * std::cos(0.2 * index[1]) + generator->GetUniformVariate(-0.01, 0.01);
+    it.Set(displacement);
+  }
+
+  // The VectorImage imports an external buffer, as a view of a NumPy array
+  // does.
+  std::vector<PixelType> buffer(region.GetNumberOfPixels() * Dimension);
+  std::copy_n(displacements->GetBufferPointer()->GetDataPointer(), buffer.size(), buffer.begin());
+  auto vectorDisplacements = VectorInputImageType::New();
+  vectorDisplacements->SetRegions(region);
+  vectorDisplacements->SetSpacing(spacing);
+  vectorDisplacements->SetVectorLength(Dimension);
+  vectorDisplacements->GetPixelContainer()->SetImportPointer(buffer.data(), buffer.size(), false);
+
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(displacements);
+  auto vectorStrainFilter = VectorStrainFilterType::New();
+  vectorStrainFilter->SetInput(vectorDisplacements);
+  if (gradient == "Fused")
+  {
+    strainFilter->FusedGradientOn();
+    vectorStrainFilter->FusedGradientOn();
+  }
+  else if (gradient == "LowMemory")
+  {
+    strainFilter->LowMemoryOn();
+    vectorStrainFilter->LowMemoryOn();
+  }
+  else if (gradient != "Gradient")
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown gradient: " << gradient << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (const auto strainForm :
+       { StrainFilterType::INFINITESIMAL, StrainFilterType::GREENLAGRANGIAN, StrainFilterType::EULERIANALMANSI })
+  {
+    strainFilter->SetStrainForm(strainForm);
+    vectorStrainFilter->SetStrainForm(static_cast<VectorStrainFilterType::StrainFormType>(strainForm));
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+    ITK_TRY_EXPECT_NO_EXCEPTION(vectorStrainFilter->Update());
+
+    // The imported buffer is read in place.
+    ITK_TEST_EXPECT_TRUE(vectorStrainFilter->GetInput()->GetBufferPointer() == buffer.data());
+
+    itk::ImageRegionConstIterator<TensorImageType> expectedIt(strainFilter->GetOutput(), region);
+    itk::ImageRegionConstIterator<TensorImageType> strainIt(vectorStrainFilter->GetOutput(), region);
+    for (; !expectedIt.IsAtEnd(); ++expectedIt, ++strainIt)
+    {
+      if (strainIt.Get() != expectedIt.Get())
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Strain differs at index " << expectedIt.GetIndex() << ": expected " << expectedIt.Get()
+                  << " but got " << strainIt.Get() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // The pixels must have ImageDimension components.
+  auto planarDisplacements = VectorInputImageType::New();
+  planarDisplacements->SetRegions(region);
+  planarDisplacements->SetVectorLength(Dimension - 1);
+  planarDisplacements->Allocate(true);
+  vectorStrainFilter->SetInput(planarDisplacements);
+  ITK_TRY_EXPECT_EXCEPTION(vectorStrainFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainInvariantImageFilter.h"
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include "ReadInDisplacements.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Compare the invariants to those of the tensors of the fused StrainImageFilter.
+template <typename TInputImage>
+int
+CompareInvariants(TInputImage * inputDisplacements,
+                  int           strainForm,
+                  unsigned int  finiteDifferenceOrder,
+                  double        tolerance)
+{
+  constexpr unsigned int Dimension = TInputImage::ImageDimension;
+  using PixelType = float;
+  using StrainFilterType = itk::StrainImageFilter<TInputImage, PixelType, PixelType>;
+  using InvariantFilterType = itk::StrainInvariantImageFilter<TInputImage, PixelType, PixelType>;
+  using TensorImageType = typename StrainFilterType::OutputImageType;
+  using TensorType = typename TensorImageType::PixelType;
+  using InvariantImageType = typename InvariantFilterType::OutputImageType;
+
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(inputDisplacements);
+  strainFilter->SetStrainForm(static_cast<typename StrainFilterType::StrainFormType>(strainForm));
+  strainFilter->FusedGradientOn();
+  strainFilter->SetFiniteDifferenceOrder(finiteDifferenceOrder);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+  auto invariantFilter = InvariantFilterType::New();
+  invariantFilter->SetInput(inputDisplacements);
+  invariantFilter->SetStrainForm(static_cast<typename InvariantFilterType::StrainFormType>(strainForm));
+  invariantFilter->SetFiniteDifferenceOrder(finiteDifferenceOrder);
+  ITK_TEST_SET_GET_VALUE(finiteDifferenceOrder, invariantFilter->GetFiniteDifferenceOrder());
+  ITK_TRY_EXPECT_NO_EXCEPTION(invariantFilter->Update());
+
+  const TensorImageType *                        strain = strainFilter->GetOutput();
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strain, strain->GetBufferedRegion());
+  itk::ImageRegionConstIterator<InvariantImageType> volumetricIt(invariantFilter->GetVolumetricStrainOutput(),
+                                                                 strain->GetBufferedRegion());
+  itk::ImageRegionConstIterator<InvariantImageType> equivalentIt(invariantFilter->GetEquivalentStrainOutput(),
+                                                                 strain->GetBufferedRegion());
+  itk::ImageRegionConstIterator<InvariantImageType> maximumShearIt(invariantFilter->GetMaximumShearStrainOutput(),
+                                                                   strain->GetBufferedRegion());
+  for (; !strainIt.IsAtEnd(); ++strainIt, ++volumetricIt, ++equivalentIt, ++maximumShearIt)
+  {
+    const TensorType tensor = strainIt.Get();
+
+    const double volumetric = tensor.GetTrace();
+    double       contraction = 0.0;
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        const double deviatoric = tensor(i, j) - (i == j ? volumetric / Dimension : 0.0);
+        contraction += deviatoric * deviatoric;
+      }
+    }
+    const double equivalent = std::sqrt(2.0 / 3.0 * contraction);
+    typename TensorType::EigenValuesArrayType eigenValues;
+    tensor.ComputeEigenValues(eigenValues);
+    const double maximumShear = 0.5 * (eigenValues[Dimension - 1] - eigenValues[0]);
+
+    if (std::abs(volumetricIt.Get() - volumetric) > tolerance * (1.0 + std::abs(volumetric)) ||
+        std::abs(equivalentIt.Get() - equivalent) > tolerance * (1.0 + equivalent) ||
+        std::abs(maximumShearIt.Get() - maximumShear) > tolerance * (1.0 + maximumShear))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Invariants of " << tensor << " at index " << strainIt.GetIndex() << ": expected " << volumetric
+                << ", " << equivalent << ", " << maximumShear << " but got " << volumetricIt.Get() << ", "
+                << equivalentIt.Get() << ", " << maximumShearIt.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The outputs that are not selected are not allocated, and the others do
+  // not change.
+  typename InvariantFilterType::InvariantsMaskType invariantsMask;
+  invariantsMask.Fill(true);
+  invariantsMask[InvariantFilterType::VOLUMETRIC] = false;
+  invariantsMask[InvariantFilterType::MAXIMUMSHEAR] = false;
+  auto maskedFilter = InvariantFilterType::New();
+  maskedFilter->SetInput(inputDisplacements);
+  maskedFilter->SetStrainForm(static_cast<typename InvariantFilterType::StrainFormType>(strainForm));
+  maskedFilter->SetFiniteDifferenceOrder(finiteDifferenceOrder);
+  maskedFilter->SetInvariantsMask(invariantsMask);
+  ITK_TEST_SET_GET_VALUE(invariantsMask, maskedFilter->GetInvariantsMask());
+  ITK_TRY_EXPECT_NO_EXCEPTION(maskedFilter->Update());
+
+  if (maskedFilter->GetVolumetricStrainOutput()->GetBufferPointer() != nullptr ||
+      maskedFilter->GetMaximumShearStrainOutput()->GetBufferPointer() != nullptr)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The outputs of the invariants that are not selected are allocated." << std::endl;
+    return EXIT_FAILURE;
+  }
+  itk::ImageRegionConstIterator<InvariantImageType> maskedIt(maskedFilter->GetEquivalentStrainOutput(),
+                                                             strain->GetBufferedRegion());
+  for (equivalentIt.GoToBegin(); !maskedIt.IsAtEnd(); ++maskedIt, ++equivalentIt)
+  {
+    if (maskedIt.Get() != equivalentIt.Get())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "The equivalent strain differs with the InvariantsMask at index " << maskedIt.GetIndex()
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int
+itkStrainInvariantImageFilterTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " inputDisplacementImage strainForm";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const char * inputDisplacementImageFileName = argv[1];
+
+  int strainForm = 0;
+  if (!strcmp(argv[2], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[2], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[2], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else if (!strcmp(argv[2], "HENCKY"))
+  {
+    strainForm = 3;
+  }
+  else if (!strcmp(argv[2], "BIOT"))
+  {
+    strainForm = 4;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using PixelType = float;
+  using InputImageType2D = itk::Image<itk::Vector<PixelType, 2>, 2>;
+  using InputImageType3D = itk::Image<itk::Vector<PixelType, 3>, 3>;
+
+  InputImageType2D::Pointer inputDisplacements2D;
+  if (ReadInDisplacements<InputImageType2D>(inputDisplacementImageFileName, inputDisplacements2D) == EXIT_FAILURE)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  inputDisplacements2D->DisconnectPipeline();
+
+  auto invariantFilter = itk::StrainInvariantImageFilter<InputImageType2D>::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(invariantFilter, StrainInvariantImageFilter, ImageToImageFilter);
+
+  // Only the orders 2, 4, and 6 have a stencil.
+  invariantFilter->SetInput(inputDisplacements2D);
+  invariantFilter->SetFiniteDifferenceOrder(3);
+  ITK_TRY_EXPECT_EXCEPTION(invariantFilter->Update());
+
+  for (unsigned int finiteDifferenceOrder = 2; finiteDifferenceOrder <= 6; finiteDifferenceOrder += 2)
+  {
+    if (CompareInvariants(inputDisplacements2D.GetPointer(), strainForm, finiteDifferenceOrder, 1e-5) == EXIT_FAILURE)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A random 3D field exercises the eigenvalues of the maximum shear strain.
+  auto                         inputDisplacements3D = InputImageType3D::New();
+  InputImageType3D::SizeType   size = { { 17, 12, 9 } };
+  InputImageType3D::RegionType region(size);
+  inputDisplacements3D->SetRegions(region);
+  InputImageType3D::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.0;
+  spacing[2] = 1.6;
+  inputDisplacements3D->SetSpacing(spacing);
+  inputDisplacements3D->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(37);
+  for (itk::ImageRegionIterator<InputImageType3D> it(inputDisplacements3D, region); !it.IsAtEnd(); ++it)
+  {
+    InputImageType3D::PixelType displacement;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      displacement[i] = static_cast<PixelType>(generator->GetUniformVariate(-0.1, 0.1));
+    }
+    it.Set(displacement);
+  }
+
+  if (CompareInvariants(inputDisplacements3D.GetPointer(), strainForm, 2, 1e-5) == EXIT_FAILURE)
+  {
+    return EXIT_FAILURE;
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,355 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkStrainImageFilter.h"
+#include "itkStrainPointEvaluator.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+template <typename TTensor>
+bool
+TensorsAreClose(const TTensor & expected, const TTensor & strain, double tolerance)
+{
+  for (unsigned int c = 0; c < TTensor::InternalDimension; ++c)
+  {
+    if (std::abs(strain[c] - expected[c]) > tolerance * (1.0 + std::abs(expected[c])))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int
+itkStrainPointEvaluatorTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " strainForm";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using CoordRepresentationType = double;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using DisplacementFieldType = itk::Image<DisplacementVectorType, Dimension>;
+
+  using EvaluatorType = itk::StrainPointEvaluator<DisplacementFieldType, PixelType, PixelType>;
+  using StrainFilterType = itk::StrainImageFilter<DisplacementFieldType, PixelType, PixelType>;
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using TensorType = EvaluatorType::OutputPixelType;
+  using PointType = EvaluatorType::InputPointType;
+
+  int strainForm = 0;
+  if (!strcmp(argv[1], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[1], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[1], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto evaluator = EvaluatorType::New();
+
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(evaluator, StrainPointEvaluator, Object);
+
+  // Nothing to evaluate the strain from.
+  PointType  point;
+  TensorType strain;
+  point.Fill(0.0);
+  ITK_TRY_EXPECT_EXCEPTION(evaluator->Evaluate(&point, 1, &strain));
+
+  evaluator->SetStrainForm(static_cast<EvaluatorType::StrainFormType>(strainForm));
+  ITK_TEST_SET_GET_VALUE(static_cast<EvaluatorType::StrainFormType>(strainForm), evaluator->GetStrainForm());
+  ITK_TEST_SET_GET_BOOLEAN(evaluator, UseNumericalJacobian, false);
+  evaluator->SetNumericalJacobianPhysicalStep(1e-2);
+  ITK_TEST_SET_GET_VALUE(1e-2, evaluator->GetNumericalJacobianPhysicalStep());
+
+  DisplacementFieldType::SizeType size;
+  size[0] = 17;
+  size[1] = 13;
+  size[2] = 9;
+  DisplacementFieldType::IndexType start;
+  start[0] = 3;
+  start[1] = -2;
+  start[2] = 0;
+  DisplacementFieldType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.2;
+  DisplacementFieldType::PointType origin;
+  origin.Fill(-5.0);
+  DisplacementFieldType::DirectionType direction;
+  direction.SetIdentity();
+  direction[0][0] = direction[1][1] = std::cos(0.3);
+  direction[0][1] = -std::sin(0.3);
+  direction[1][0] = std::sin(0.3);
+
+  auto field = DisplacementFieldType::New();
+  field->SetRegions(DisplacementFieldType::RegionType(start, size));
+  field->SetSpacing(spacing);
+  field->SetOrigin(origin);
+  field->SetDirection(direction);
+  field->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(7);
+  for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    DisplacementVectorType displacement;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      displacement[d] = generator->GetUniformVariate(-0.1, 0.1);
+    }
+    it.Set(displacement);
+  }
+
+  evaluator->SetDisplacementField(field);
+  ITK_TEST_SET_GET_VALUE(field.GetPointer(), evaluator->GetDisplacementField());
+
+  // At the grid points, the strain is that of the fused stencil of
+  // StrainImageFilter.
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(field);
+  strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(strainForm));
+  strainFilter->FusedGradientOn();
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+  auto gridPoints = EvaluatorType::PointsContainer::New();
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilter->GetOutput(),
+                                                          strainFilter->GetOutput()->GetBufferedRegion());
+  for (EvaluatorType::PointSetType::PointIdentifier id = 0; !strainIt.IsAtEnd(); ++strainIt, ++id)
+  {
+    EvaluatorType::PointSetType::PointType gridPoint;
+    field->TransformIndexToPhysicalPoint(strainIt.GetIndex(), gridPoint);
+    // Sparse identifiers, which the output keeps.
+    gridPoints->InsertElement(3 * id + 1, gridPoint);
+  }
+
+  EvaluatorType::PointSetType::Pointer gridStrains;
+  ITK_TRY_EXPECT_NO_EXCEPTION(gridStrains = evaluator->Evaluate(gridPoints));
+  ITK_TEST_EXPECT_EQUAL(gridStrains->GetNumberOfPoints(), gridPoints->Size());
+
+  strainIt.GoToBegin();
+  for (EvaluatorType::PointSetType::PointIdentifier id = 0; !strainIt.IsAtEnd(); ++strainIt, ++id)
+  {
+    TensorType gridStrain;
+    if (!gridStrains->GetPointData(3 * id + 1, &gridStrain) ||
+        !TensorsAreClose(strainIt.Get(), gridStrain, 1e-5))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain differs at index " << strainIt.GetIndex() << ": expected " << strainIt.Get()
+                << " but got " << gridStrain << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Random points, some of them outside of the field.
+  DisplacementFieldType::PointType lower;
+  DisplacementFieldType::PointType upper;
+  field->TransformIndexToPhysicalPoint(start, lower);
+  field->TransformIndexToPhysicalPoint(field->GetBufferedRegion().GetUpperIndex(), upper);
+  std::vector<PointType> points(5000);
+  for (auto & randomPoint : points)
+  {
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double margin = 0.1 * std::abs(upper[d] - lower[d]);
+      randomPoint[d] = generator->GetUniformVariate(std::min(lower[d], upper[d]) - margin,
+                                                    std::max(lower[d], upper[d]) + margin);
+    }
+  }
+
+  // The strain of a point does not depend on the other points.
+  std::vector<TensorType> strains(points.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(evaluator->Evaluate(points.data(), points.size(), strains.data()));
+  std::vector<PointType>  reversedPoints(points.rbegin(), points.rend());
+  std::vector<TensorType> reversedStrains(points.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(evaluator->Evaluate(reversedPoints.data(), points.size(), reversedStrains.data()));
+  for (size_t n = 0; n < points.size(); ++n)
+  {
+    if (!TensorsAreClose(strains[n], reversedStrains[points.size() - 1 - n], 0.0))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain at " << points[n] << " depends on the order of the points: " << strains[n] << " and "
+                << reversedStrains[points.size() - 1 - n] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A DisplacementFieldTransform is evaluated from its field.
+  using TransformFieldType = DisplacementFieldTransformType::DisplacementFieldType;
+  auto transformField = TransformFieldType::New();
+  transformField->CopyInformation(field);
+  transformField->SetRegions(field->GetBufferedRegion());
+  transformField->Allocate();
+  itk::ImageRegionConstIterator<DisplacementFieldType> fieldIt(field, field->GetBufferedRegion());
+  itk::ImageRegionIterator<TransformFieldType>         transformFieldIt(transformField, field->GetBufferedRegion());
+  for (; !fieldIt.IsAtEnd(); ++fieldIt, ++transformFieldIt)
+  {
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      transformFieldIt.Value()[d] = fieldIt.Get()[d];
+    }
+  }
+  auto displacementFieldTransform = DisplacementFieldTransformType::New();
+  displacementFieldTransform->SetDisplacementField(transformField);
+
+  auto transformEvaluator = EvaluatorType::New();
+  transformEvaluator->SetStrainForm(static_cast<EvaluatorType::StrainFormType>(strainForm));
+  transformEvaluator->SetTransform(displacementFieldTransform);
+  ITK_TEST_SET_GET_VALUE(displacementFieldTransform.GetPointer(), transformEvaluator->GetTransform());
+  std::vector<TensorType> transformStrains(points.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(transformEvaluator->Evaluate(points.data(), points.size(), transformStrains.data()));
+  for (size_t n = 0; n < points.size(); ++n)
+  {
+    if (!TensorsAreClose(strains[n], transformStrains[n], 1e-5))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "DisplacementFieldTransform strain differs at " << points[n] << ": expected " << strains[n]
+                << " but got " << transformStrains[n] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The gradient of a linear field is constant between the grid points, away
+  // from the boundary where the stencil is one-sided.
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  AffineTransformType::ParametersType parameters = affineTransform->GetParameters();
+  for (unsigned int p = 0; p < Dimension * Dimension; ++p)
+  {
+    parameters[p] += generator->GetUniformVariate(-0.1, 0.1);
+  }
+  affineTransform->SetParameters(parameters);
+  for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    DisplacementFieldType::PointType gridPoint;
+    field->TransformIndexToPhysicalPoint(it.GetIndex(), gridPoint);
+    const DisplacementFieldType::PointType mappedPoint = affineTransform->TransformPoint(gridPoint);
+    DisplacementVectorType                 displacement;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      displacement[d] = mappedPoint[d] - gridPoint[d];
+    }
+    it.Set(displacement);
+  }
+  field->Modified();
+
+  auto strainTransformFilter = TransformToStrainFilterType::New();
+  strainTransformFilter->SetTransform(affineTransform);
+  strainTransformFilter->SetStrainForm(static_cast<TransformToStrainFilterType::StrainFormType>(strainForm));
+  TensorType constantStrain;
+  ITK_TEST_EXPECT_TRUE(strainTransformFilter->ComputeConstantStrain(constantStrain));
+
+  std::vector<PointType> interiorPoints(1000);
+  for (auto & interiorPoint : interiorPoints)
+  {
+    itk::ContinuousIndex<double, Dimension> continuousIndex;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      continuousIndex[d] = start[d] + generator->GetUniformVariate(1.0, size[d] - 2.0);
+    }
+    field->TransformContinuousIndexToPhysicalPoint(continuousIndex, interiorPoint);
+  }
+  std::vector<TensorType> interiorStrains(interiorPoints.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(
+    evaluator->Evaluate(interiorPoints.data(), interiorPoints.size(), interiorStrains.data()));
+  for (size_t n = 0; n < interiorPoints.size(); ++n)
+  {
+    if (!TensorsAreClose(constantStrain, interiorStrains[n], 1e-5))
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain of the linear field differs at " << interiorPoints[n] << ": expected " << constantStrain
+                << " but got " << interiorStrains[n] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The Jacobian of the transform, analytic or numerical, gives the constant
+  // strain of the affine transform at any point.
+  transformEvaluator->SetTransform(affineTransform);
+  for (bool useNumericalJacobian : { false, true })
+  {
+    transformEvaluator->SetUseNumericalJacobian(useNumericalJacobian);
+    ITK_TRY_EXPECT_NO_EXCEPTION(transformEvaluator->Evaluate(points.data(), points.size(), transformStrains.data()));
+    for (size_t n = 0; n < points.size(); ++n)
+    {
+      if (!TensorsAreClose(constantStrain, transformStrains[n], useNumericalJacobian ? 1e-4 : 1e-6))
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Transform strain differs at " << points[n] << " with UseNumericalJacobian "
+                  << useNumericalJacobian << ": expected " << constantStrain << " but got " << transformStrains[n]
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Without a field, the transform is evaluated.
+  evaluator->SetTransform(affineTransform);
+  evaluator->SetDisplacementField(nullptr);
+  ITK_TRY_EXPECT_NO_EXCEPTION(evaluator->Evaluate(&point, 1, &strain));
+  ITK_TEST_EXPECT_TRUE(TensorsAreClose(constantStrain, strain, 1e-6));
+
+  // A field must have two pixels along each axis.
+  size[2] = 1;
+  field->SetRegions(DisplacementFieldType::RegionType(start, size));
+  field->Allocate();
+  evaluator->SetDisplacementField(field);
+  ITK_TRY_EXPECT_EXCEPTION(evaluator->Evaluate(&point, 1, &strain));
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkExtractImageFilter.h"
+#include "itkStrainImageFilter.h"
+#include "itkStrainSequenceImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+int
+itkStrainSequenceImageFilterTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " strainForm";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  constexpr unsigned int FrameDimension = 2;
+  constexpr unsigned int Dimension = FrameDimension + 1;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, FrameDimension>;
+  using SequenceImageType = itk::Image<DisplacementVectorType, Dimension>;
+  using FrameImageType = itk::Image<DisplacementVectorType, FrameDimension>;
+
+  using SequenceFilterType = itk::StrainSequenceImageFilter<SequenceImageType, PixelType, PixelType>;
+  using StrainFilterType = itk::StrainImageFilter<FrameImageType, PixelType, PixelType>;
+  using ExtractFilterType = itk::ExtractImageFilter<SequenceImageType, FrameImageType>;
+  using SequenceTensorImageType = SequenceFilterType::OutputImageType;
+  using FrameTensorImageType = StrainFilterType::OutputImageType;
+  using TensorType = SequenceFilterType::OutputPixelType;
+
+  int strainForm = 0;
+  if (!strcmp(argv[1], "INFINITESIMAL"))
+  {
+    strainForm = 0;
+  }
+  else if (!strcmp(argv[1], "GREENLAGRANGIAN"))
+  {
+    strainForm = 1;
+  }
+  else if (!strcmp(argv[1], "EULERIANALMANSI"))
+  {
+    strainForm = 2;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown strain form: " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A sequence of 7 frames, 40 ms apart, of a smooth motion plus noise.
+  SequenceImageType::SizeType size;
+  size[0] = 19;
+  size[1] = 14;
+  size[2] = 7;
+  SequenceImageType::IndexType start;
+  start[0] = -3;
+  start[1] = 2;
+  start[2] = 1;
+  SequenceImageType::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.1;
+  spacing[2] = 0.04;
+  SequenceImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[0][0] = direction[1][1] = std::cos(0.4);
+  direction[0][1] = -std::sin(0.4);
+  direction[1][0] = std::sin(0.4);
+
+  auto sequence = SequenceImageType::New();
+  sequence->SetRegions(SequenceImageType::RegionType(start, size));
+  sequence->SetSpacing(spacing);
+  sequence->SetDirection(direction);
+  sequence->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(13);
+  for (itk::ImageRegionIterator<SequenceImageType> it(sequence, sequence->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    const SequenceImageType::IndexType index = it.GetIndex();
+    const double                       phase = std::sin(0.5 * index[2]);
+    DisplacementVectorType             displacement;
+    displacement[0] = 0.05 * phase * index[0] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[1] = -0.03 * phase * index[1] + 0.02 * index[0] + generator->GetUniformVariate(-0.01, 0.01);
+    it.Set(displacement);
+  }
+
+  auto sequenceFilter = SequenceFilterType::New();
+
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(sequenceFilter, StrainSequenceImageFilter, ImageToImageFilter);
+
+  sequenceFilter->SetInput(sequence);
+  sequenceFilter->SetStrainForm(static_cast<SequenceFilterType::StrainFormType>(strainForm));
+  ITK_TEST_SET_GET_VALUE(static_cast<SequenceFilterType::StrainFormType>(strainForm),
+                         sequenceFilter->GetStrainForm());
+  ITK_TEST_SET_GET_BOOLEAN(sequenceFilter, ComputeStrainRate, false);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sequenceFilter->Update());
+  if (sequenceFilter->GetStrainRateOutput()->GetBufferPointer() != nullptr)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The strain rate is allocated without ComputeStrainRate." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The strain of each frame is that of the fused StrainImageFilter.
+  const SequenceTensorImageType *                        strain = sequenceFilter->GetStrainOutput();
+  std::vector<FrameTensorImageType::Pointer>             frameStrains;
+  SequenceImageType::RegionType                          frameRegion = sequence->GetLargestPossibleRegion();
+  frameRegion.SetSize(FrameDimension, 0);
+  for (itk::IndexValueType frame = start[2]; frame < start[2] + static_cast<itk::IndexValueType>(size[2]); ++frame)
+  {
+    frameRegion.SetIndex(FrameDimension, frame);
+    auto extractFilter = ExtractFilterType::New();
+    extractFilter->SetInput(sequence);
+    extractFilter->SetExtractionRegion(frameRegion);
+    extractFilter->SetDirectionCollapseToSubmatrix();
+
+    auto strainFilter = StrainFilterType::New();
+    strainFilter->SetInput(extractFilter->GetOutput());
+    strainFilter->SetStrainForm(static_cast<StrainFilterType::StrainFormType>(strainForm));
+    strainFilter->FusedGradientOn();
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+    frameStrains.push_back(strainFilter->GetOutput());
+
+    itk::ImageRegionConstIterator<FrameTensorImageType> frameStrainIt(strainFilter->GetOutput(),
+                                                                      strainFilter->GetOutput()->GetBufferedRegion());
+    for (; !frameStrainIt.IsAtEnd(); ++frameStrainIt)
+    {
+      SequenceImageType::IndexType index;
+      index[0] = frameStrainIt.GetIndex()[0];
+      index[1] = frameStrainIt.GetIndex()[1];
+      index[2] = frame;
+      const TensorType & expected = frameStrainIt.Get();
+      const TensorType & computed = strain->GetPixel(index);
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (std::abs(computed[c] - expected[c]) > 1e-6 * (1.0 + std::abs(expected[c])))
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Strain differs at index " << index << ": expected " << expected << " but got " << computed
+                    << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  // The strain rate is the central difference of the strain of the frames, or
+  // a one-sided difference at the first and last frames.
+  sequenceFilter->ComputeStrainRateOn();
+  ITK_TRY_EXPECT_NO_EXCEPTION(sequenceFilter->Update());
+  const SequenceTensorImageType * strainRate = sequenceFilter->GetStrainRateOutput();
+  for (itk::ImageRegionConstIterator<SequenceTensorImageType> it(strainRate, strainRate->GetBufferedRegion());
+       !it.IsAtEnd();
+       ++it)
+  {
+    const SequenceImageType::IndexType index = it.GetIndex();
+    const size_t                       frame = index[2] - start[2];
+    const size_t                       previous = frame > 0 ? frame - 1 : frame;
+    const size_t                       next = frame + 1 < size[2] ? frame + 1 : frame;
+    FrameTensorImageType::IndexType    frameIndex;
+    frameIndex[0] = index[0];
+    frameIndex[1] = index[1];
+    const TensorType & nextStrain = frameStrains[next]->GetPixel(frameIndex);
+    const TensorType & previousStrain = frameStrains[previous]->GetPixel(frameIndex);
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      const double expected = (nextStrain[c] - previousStrain[c]) / ((next - previous) * spacing[2]);
+      if (std::abs(it.Get()[c] - expected) > 1e-4 * (1.0 + std::abs(expected)))
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Strain rate differs at index " << index << ": expected component " << c << " " << expected
+                  << " but got " << it.Get() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Streamed frame by frame, the strain rate still uses the neighbor frames,
+  // and the strain is unchanged.
+  auto streamedSequenceFilter = SequenceFilterType::New();
+  streamedSequenceFilter->SetInput(sequence);
+  streamedSequenceFilter->SetStrainForm(static_cast<SequenceFilterType::StrainFormType>(strainForm));
+  streamedSequenceFilter->ComputeStrainRateOn();
+  using StreamingFilterType = itk::StreamingImageFilter<SequenceTensorImageType, SequenceTensorImageType>;
+  auto streamingFilter = StreamingFilterType::New();
+  streamingFilter->SetInput(streamedSequenceFilter->GetStrainRateOutput());
+  streamingFilter->SetNumberOfStreamDivisions(size[2]);
+  ITK_TRY_EXPECT_NO_EXCEPTION(streamingFilter->Update());
+
+  itk::ImageRegionConstIterator<SequenceTensorImageType> streamedIt(streamingFilter->GetOutput(),
+                                                                    strainRate->GetBufferedRegion());
+  itk::ImageRegionConstIterator<SequenceTensorImageType> strainRateIt(strainRate, strainRate->GetBufferedRegion());
+  for (; !strainRateIt.IsAtEnd(); ++strainRateIt, ++streamedIt)
+  {
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (streamedIt.Get()[c] != strainRateIt.Get()[c])
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Streamed strain rate differs at index " << strainRateIt.GetIndex() << ": expected "
+                  << strainRateIt.Get() << " but got " << streamedIt.Get() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // A single frame has no strain rate.
+  frameRegion.SetIndex(FrameDimension, start[2]);
+  frameRegion.SetSize(FrameDimension, 1);
+  auto singleFrame = SequenceImageType::New();
+  singleFrame->CopyInformation(sequence);
+  singleFrame->SetRegions(frameRegion);
+  singleFrame->Allocate(true);
+  sequenceFilter->SetInput(singleFrame);
+  ITK_TRY_EXPECT_EXCEPTION(sequenceFilter->Update());
+
+  // A direction that mixes time with space is rejected.
+  SequenceImageType::DirectionType mixedDirection = direction;
+  mixedDirection[0][2] = mixedDirection[2][0] = 0.1;
+  auto mixedSequence = SequenceImageType::New();
+  mixedSequence->Graft(sequence);
+  mixedSequence->SetDirection(mixedDirection);
+  sequenceFilter->SetInput(mixedSequence);
+  sequenceFilter->ComputeStrainRateOff();
+  ITK_TRY_EXPECT_EXCEPTION(sequenceFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
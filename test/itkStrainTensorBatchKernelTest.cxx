@@ -0,0 +1,167 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkStrainTensorBatchKernel.h"
+#include "itkStrainTensorKernel.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+// Compare the batches of every instruction set supported by the processor to
+// the scalar kernel.  The count is not a multiple of the lanes, so that the
+// padded last block is exercised.
+template <unsigned int VStrainForm, unsigned int VDimension, typename TValue>
+bool
+CompareBatchKernel(itk::SizeValueType count)
+{
+  using KernelType = itk::StrainTensorKernel<VStrainForm, VDimension, TValue>;
+  using BatchKernelType = itk::StrainTensorBatchKernel<VStrainForm, VDimension, TValue>;
+  using TensorType = itk::SymmetricSecondRankTensor<TValue, VDimension>;
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(121);
+
+  // The Hencky and Biot strains are ill-conditioned when the deformation
+  // gradient I + du/dx is nearly singular, so their displacement gradients are
+  // smaller.
+  const double        range = VStrainForm > 2 ? 0.3 : 1.0;
+  std::vector<TValue> gradients(VDimension * VDimension * count);
+  for (auto & value : gradients)
+  {
+    value = static_cast<TValue>(generator->GetUniformVariate(-range, range));
+  }
+  const TValue * gradientComponents[VDimension * VDimension];
+  for (unsigned int k = 0; k < VDimension * VDimension; ++k)
+  {
+    gradientComponents[k] = gradients.data() + k * count;
+  }
+
+  std::vector<TensorType> expected(count);
+  for (itk::SizeValueType n = 0; n < count; ++n)
+  {
+    TValue gradient[VDimension][VDimension];
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      for (unsigned int j = 0; j < VDimension; ++j)
+      {
+        gradient[i][j] = gradientComponents[i * VDimension + j][n];
+      }
+    }
+    KernelType::Compute(gradient, expected[n]);
+  }
+
+  bool               passed = true;
+  const TValue       tolerance = 10 * std::numeric_limits<TValue>::epsilon();
+  const unsigned int detected = BatchKernelType::GetDetectedInstructionSet();
+  for (unsigned int instructionSet = BatchKernelType::SCALAR; instructionSet <= detected; ++instructionSet)
+  {
+    std::vector<TensorType> tensors(count);
+    BatchKernelType::Compute(static_cast<typename BatchKernelType::InstructionSetType>(instructionSet),
+                             gradientComponents,
+                             reinterpret_cast<TValue *>(tensors.data()),
+                             count);
+    for (itk::SizeValueType n = 0; n < count; ++n)
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (std::abs(tensors[n][c] - expected[n][c]) > tolerance)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Strain form " << VStrainForm << ", dimension " << VDimension << ", instruction set "
+                    << instructionSet << ": expected " << expected[n] << " at voxel " << n << " but got "
+                    << tensors[n] << std::endl;
+          passed = false;
+          break;
+        }
+      }
+    }
+
+    // Separate component planes, with a stride of 1.
+    std::vector<TValue> planes(TensorType::InternalDimension * count);
+    TValue *            planeComponents[TensorType::InternalDimension];
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      planeComponents[c] = planes.data() + c * count;
+    }
+    BatchKernelType::Compute(static_cast<typename BatchKernelType::InstructionSetType>(instructionSet),
+                             gradientComponents,
+                             planeComponents,
+                             1,
+                             count);
+    for (itk::SizeValueType n = 0; n < count; ++n)
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (planeComponents[c][n] != tensors[n][c])
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Strain form " << VStrainForm << ", dimension " << VDimension << ", instruction set "
+                    << instructionSet << ": component " << c << " of voxel " << n << " is " << planeComponents[c][n]
+                    << " in its plane but " << tensors[n][c] << " interleaved" << std::endl;
+          passed = false;
+          break;
+        }
+      }
+    }
+  }
+  return passed;
+}
+
+template <unsigned int VDimension, typename TValue>
+bool
+CompareBatchKernels(itk::SizeValueType count)
+{
+  bool passed = CompareBatchKernel<0, VDimension, TValue>(count);
+  passed &= CompareBatchKernel<1, VDimension, TValue>(count);
+  passed &= CompareBatchKernel<2, VDimension, TValue>(count);
+  // The Hencky and Biot forms are computed in blocks of 64 voxels.
+  passed &= CompareBatchKernel<3, VDimension, TValue>(3 * count);
+  passed &= CompareBatchKernel<4, VDimension, TValue>(3 * count);
+  return passed;
+}
+
+} // namespace
+
+int
+itkStrainTensorBatchKernelTest(int, char *[])
+{
+  std::cout << "Detected instruction set: " << itk::StrainTensorBatchKernelBase::GetDetectedInstructionSet()
+            << std::endl;
+
+  constexpr itk::SizeValueType count = 37;
+  bool                         passed = CompareBatchKernels<2, float>(count);
+  passed &= CompareBatchKernels<3, float>(count);
+  passed &= CompareBatchKernels<2, double>(count);
+  passed &= CompareBatchKernels<3, double>(count);
+  if (!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
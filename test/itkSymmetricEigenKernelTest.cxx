@@ -0,0 +1,242 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkSymmetricEigenKernel.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+// Tensors R diag(e) R^T with random rotations R, and eigenvalues e that are
+// distinct, repeated, all equal, or that differ by a few ulps, so that the
+// near-degenerate cases are exercised.
+template <unsigned int VDimension, typename TValue>
+std::vector<TValue>
+MakeTensors(unsigned int count)
+{
+  using TensorType = itk::SymmetricSecondRankTensor<TValue, VDimension>;
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  std::vector<TValue> tensors(count * TensorType::InternalDimension);
+  for (unsigned int n = 0; n < count; ++n)
+  {
+    double eigenValues[VDimension];
+    for (auto & eigenValue : eigenValues)
+    {
+      eigenValue = generator->GetUniformVariate(-1.0, 1.0);
+    }
+    switch (n % 5)
+    {
+      case 1:
+        eigenValues[1] = eigenValues[0];
+        break;
+      case 2:
+        std::fill_n(eigenValues, VDimension, eigenValues[0]);
+        break;
+      case 3:
+        eigenValues[1] = eigenValues[0] * (1.0 + 8.0 * std::numeric_limits<TValue>::epsilon());
+        break;
+      case 4:
+        eigenValues[VDimension - 1] = eigenValues[0] + 1e-4;
+        break;
+      default:
+        break;
+    }
+
+    // Orthonormalize random vectors into the rotation.
+    double rotation[VDimension][VDimension];
+    for (unsigned int k = 0; k < VDimension; ++k)
+    {
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        rotation[k][i] = generator->GetUniformVariate(-1.0, 1.0);
+      }
+      for (unsigned int l = 0; l < k; ++l)
+      {
+        double dot = 0.0;
+        for (unsigned int i = 0; i < VDimension; ++i)
+        {
+          dot += rotation[k][i] * rotation[l][i];
+        }
+        for (unsigned int i = 0; i < VDimension; ++i)
+        {
+          rotation[k][i] -= dot * rotation[l][i];
+        }
+      }
+      double norm = 0.0;
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        norm += rotation[k][i] * rotation[k][i];
+      }
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        rotation[k][i] /= std::sqrt(norm);
+      }
+    }
+
+    TensorType tensor;
+    for (unsigned int i = 0; i < VDimension; ++i)
+    {
+      for (unsigned int j = i; j < VDimension; ++j)
+      {
+        double value = 0.0;
+        for (unsigned int k = 0; k < VDimension; ++k)
+        {
+          value += rotation[k][i] * eigenValues[k] * rotation[k][j];
+        }
+        tensor(i, j) = static_cast<TValue>(value);
+      }
+    }
+    if (n == 0)
+    {
+      tensor.Fill(0);
+    }
+    std::copy_n(
+      tensor.GetDataPointer(), TensorType::InternalDimension, tensors.data() + n * TensorType::InternalDimension);
+  }
+  return tensors;
+}
+
+// Check the residuals, the orthonormality and the handedness of the
+// eigenvectors, the order of the eigenvalues, and compare them to
+// SymmetricEigenAnalysis.
+template <unsigned int VDimension, typename TValue>
+bool
+CheckEigenKernel(unsigned int count)
+{
+  using KernelType = itk::SymmetricEigenKernel<VDimension, TValue>;
+  using TensorType = itk::SymmetricSecondRankTensor<TValue, VDimension>;
+
+  const std::vector<TValue> tensors = MakeTensors<VDimension, TValue>(count);
+  std::vector<TValue>       eigenValues(count * VDimension);
+  std::vector<TValue>       systemEigenValues(count * VDimension);
+  std::vector<TValue>       eigenVectors(count * VDimension * VDimension);
+  TValue *                  eigenVectorPointers[VDimension];
+  for (unsigned int k = 0; k < VDimension; ++k)
+  {
+    eigenVectorPointers[k] = eigenVectors.data() + k * count * VDimension;
+  }
+  KernelType::ComputeEigenValues(tensors.data(), eigenValues.data(), count);
+  KernelType::ComputeEigenSystem(tensors.data(), systemEigenValues.data(), eigenVectorPointers, count);
+
+  const double tolerance = 100.0 * std::numeric_limits<TValue>::epsilon();
+  for (unsigned int n = 0; n < count; ++n)
+  {
+    TensorType tensor;
+    std::copy_n(
+      tensors.data() + n * TensorType::InternalDimension, TensorType::InternalDimension, tensor.GetDataPointer());
+    typename TensorType::EigenValuesArrayType expectedEigenValues;
+    tensor.ComputeEigenValues(expectedEigenValues);
+
+    double scale = 0.0;
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      scale = std::max(scale, static_cast<double>(std::abs(tensor[c])));
+    }
+    scale = std::max(scale, 1e-30);
+
+    double error = 0.0;
+    for (unsigned int k = 0; k < VDimension; ++k)
+    {
+      const double eigenValue = systemEigenValues[n * VDimension + k];
+      error = std::max(error, std::abs(eigenValues[n * VDimension + k] - eigenValue) / scale);
+      error = std::max(error, std::abs(expectedEigenValues[k] - eigenValue) / scale);
+      if (k > 0 && eigenValue < systemEigenValues[n * VDimension + k - 1])
+      {
+        error = 1.0;
+      }
+
+      const TValue * eigenVector = eigenVectorPointers[k] + n * VDimension;
+      for (unsigned int i = 0; i < VDimension; ++i)
+      {
+        double residual = -eigenValue * eigenVector[i];
+        for (unsigned int j = 0; j < VDimension; ++j)
+        {
+          residual += tensor(i, j) * eigenVector[j];
+        }
+        error = std::max(error, std::abs(residual) / scale);
+      }
+      for (unsigned int l = 0; l <= k; ++l)
+      {
+        const TValue * otherEigenVector = eigenVectorPointers[l] + n * VDimension;
+        double         dot = 0.0;
+        for (unsigned int i = 0; i < VDimension; ++i)
+        {
+          dot += eigenVector[i] * otherEigenVector[i];
+        }
+        error = std::max(error, std::abs(dot - (l == k ? 1.0 : 0.0)));
+      }
+    }
+
+    double determinant = 0.0;
+    if constexpr (VDimension == 2)
+    {
+      determinant = eigenVectorPointers[0][2 * n] * eigenVectorPointers[1][2 * n + 1] -
+                    eigenVectorPointers[0][2 * n + 1] * eigenVectorPointers[1][2 * n];
+    }
+    else
+    {
+      const TValue * u = eigenVectorPointers[0] + 3 * n;
+      const TValue * v = eigenVectorPointers[1] + 3 * n;
+      const TValue * w = eigenVectorPointers[2] + 3 * n;
+      determinant = w[0] * (u[1] * v[2] - u[2] * v[1]) + w[1] * (u[2] * v[0] - u[0] * v[2]) +
+                    w[2] * (u[0] * v[1] - u[1] * v[0]);
+    }
+    if (determinant < 0.5)
+    {
+      error = 1.0;
+    }
+
+    if (error > tolerance)
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Dimension " << VDimension << ": the eigen system of " << tensor << " is off by " << error
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int
+itkSymmetricEigenKernelTest(int, char *[])
+{
+  constexpr unsigned int count = 1003;
+  bool                   passed = CheckEigenKernel<2, float>(count);
+  passed &= CheckEigenKernel<3, float>(count);
+  passed &= CheckEigenKernel<2, double>(count);
+  passed &= CheckEigenKernel<3, double>(count);
+  if (!passed)
+  {
+    return EXIT_FAILURE;
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <string>
+#include <utility>
+
+int
+itkTransformToStrainFilterLargeDeformationTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " transform";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string transformName = argv[1];
+
+  constexpr unsigned int Dimension = 2;
+  using ScalarPixelType = float;
+  using CoordRepresentationType = double;
+
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldType = DisplacementFieldTransformType::DisplacementFieldType;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, ScalarPixelType, ScalarPixelType>;
+  using TensorImageType = TransformToStrainFilterType::OutputImageType;
+  using TensorType = TensorImageType::PixelType;
+  using MatrixType = AffineTransformType::MatrixType;
+
+  // A homogeneous deformation F = R U, with U = Q diag(s) Q^T, whose material
+  // strains do not depend on the rotation R.
+  const double stretches[Dimension] = { 0.55, 1.8 };
+  const auto   rotation = [](double angle) {
+    MatrixType matrix;
+    matrix(0, 0) = std::cos(angle);
+    matrix(0, 1) = -std::sin(angle);
+    matrix(1, 0) = std::sin(angle);
+    matrix(1, 1) = std::cos(angle);
+    return matrix;
+  };
+  const MatrixType principalAxes = rotation(0.6);
+  MatrixType       principalStretches;
+  principalStretches.Fill(0.0);
+  for (unsigned int k = 0; k < Dimension; ++k)
+  {
+    principalStretches(k, k) = stretches[k];
+  }
+  const MatrixType deformationGradient =
+    rotation(-1.1) * principalAxes * principalStretches * MatrixType(principalAxes.GetTranspose());
+
+  TransformToStrainFilterType::SizeType size;
+  size[0] = 23;
+  size[1] = 16;
+  TransformToStrainFilterType::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 1.3;
+  TransformToStrainFilterType::PointType origin;
+  origin[0] = -4.0;
+  origin[1] = 2.5;
+
+  TransformType::Pointer transform;
+  if (transformName == "Affine")
+  {
+    AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+    affineTransform->SetMatrix(deformationGradient);
+    transform = affineTransform;
+  }
+  else if (transformName == "DisplacementField")
+  {
+    // The field has the geometry of the output, so its finite differences are
+    // used.
+    auto field = DisplacementFieldType::New();
+    field->SetRegions(size);
+    field->SetSpacing(spacing);
+    field->SetOrigin(origin);
+    field->Allocate();
+    for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    {
+      DisplacementFieldType::PointType point;
+      field->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      DisplacementFieldType::PixelType displacement;
+      for (unsigned int i = 0; i < Dimension; ++i)
+      {
+        double value = -point[i];
+        for (unsigned int j = 0; j < Dimension; ++j)
+        {
+          value += deformationGradient(i, j) * point[j];
+        }
+        displacement[i] = value;
+      }
+      it.Set(displacement);
+    }
+    DisplacementFieldTransformType::Pointer displacementFieldTransform = DisplacementFieldTransformType::New();
+    displacementFieldTransform->SetDisplacementField(field);
+    transform = displacementFieldTransform;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown transform: " << transformName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TransformToStrainFilterType::Pointer strainFilter = TransformToStrainFilterType::New();
+  strainFilter->SetTransform(transform);
+  strainFilter->SetSize(size);
+  strainFilter->SetSpacing(spacing);
+  strainFilter->SetOrigin(origin);
+
+  // The finite differences of a linear displacement are exact away from the
+  // boundary.
+  TensorImageType::RegionType interiorRegion(size);
+  interiorRegion.ShrinkByRadius(1);
+
+  const std::pair<TransformToStrainFilterType::StrainFormType, double (*)(double)> strainForms[] = {
+    { TransformToStrainFilterType::HENCKY, [](double stretch) { return std::log(stretch); } },
+    { TransformToStrainFilterType::BIOT, [](double stretch) { return stretch - 1.0; } }
+  };
+  for (const auto & strainForm : strainForms)
+  {
+    strainFilter->SetStrainForm(strainForm.first);
+    ITK_TEST_SET_GET_VALUE(strainForm.first, strainFilter->GetStrainForm());
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+    // Q diag(f(s)) Q^T
+    TensorType expected;
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      for (unsigned int j = i; j < Dimension; ++j)
+      {
+        double value = 0.0;
+        for (unsigned int k = 0; k < Dimension; ++k)
+        {
+          value += strainForm.second(stretches[k]) * principalAxes(i, k) * principalAxes(j, k);
+        }
+        expected(i, j) = value;
+      }
+    }
+
+    constexpr double tolerance = 1e-4;
+    for (itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilter->GetOutput(), interiorRegion);
+         !strainIt.IsAtEnd();
+         ++strainIt)
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (std::abs(strainIt.Get()[c] - expected[c]) > tolerance)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Strain form " << strainForm.first << ": expected " << expected << " at index "
+                    << strainIt.GetIndex() << " but got " << strainIt.Get() << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  strainFilter->SetStrainForm(
+    static_cast<TransformToStrainFilterType::StrainFormType>(TransformToStrainFilterType::BIOT + 1));
+  ITK_TRY_EXPECT_EXCEPTION(strainFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineTransform.h"
+#include "itkBSplineTransform.h"
+#include "itkCompositeTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+
+int
+itkTransformToStrainFilterMaskTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " transform";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string transformName = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  constexpr unsigned int SplineOrder = 3;
+  using ScalarPixelType = float;
+  using CoordRepresentationType = double;
+
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, Dimension>;
+  using BSplineTransformType = itk::BSplineTransform<CoordRepresentationType, Dimension, SplineOrder>;
+  using CompositeTransformType = itk::CompositeTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldType = DisplacementFieldTransformType::DisplacementFieldType;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, ScalarPixelType, ScalarPixelType>;
+  using TensorImageType = TransformToStrainFilterType::OutputImageType;
+  using TensorType = TensorImageType::PixelType;
+  using MaskImageType = TransformToStrainFilterType::MaskImageType;
+
+  TransformToStrainFilterType::SizeType size;
+  size[0] = 24;
+  size[1] = 20;
+  size[2] = 16;
+  TransformToStrainFilterType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.0;
+  spacing[2] = 1.2;
+  TransformToStrainFilterType::PointType origin;
+  origin.Fill(-5.0);
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(5);
+
+  TransformType::Pointer transform;
+  bool                   useNumericalJacobian = false;
+  if (transformName == "Affine")
+  {
+    AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+    AffineTransformType::ParametersType parameters = affineTransform->GetParameters();
+    for (unsigned int p = 0; p < Dimension * Dimension; ++p)
+    {
+      parameters[p] += generator->GetUniformVariate(-0.1, 0.1);
+    }
+    affineTransform->SetParameters(parameters);
+    transform = affineTransform;
+  }
+  else if (transformName == "BSpline" || transformName == "NumericalJacobian")
+  {
+    BSplineTransformType::Pointer                bSplineTransform = BSplineTransformType::New();
+    BSplineTransformType::OriginType             domainOrigin;
+    BSplineTransformType::PhysicalDimensionsType domainDimensions;
+    BSplineTransformType::MeshSizeType           meshSize;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      domainOrigin[d] = origin[d] - 4.0 * spacing[d];
+      domainDimensions[d] = spacing[d] * (size[d] + 7.0);
+      meshSize[d] = 3;
+    }
+    bSplineTransform->SetTransformDomainOrigin(domainOrigin);
+    bSplineTransform->SetTransformDomainPhysicalDimensions(domainDimensions);
+    bSplineTransform->SetTransformDomainMeshSize(meshSize);
+    BSplineTransformType::ParametersType parameters(bSplineTransform->GetNumberOfParameters());
+    for (unsigned int p = 0; p < parameters.GetSize(); ++p)
+    {
+      parameters[p] = generator->GetUniformVariate(-0.2, 0.2);
+    }
+    bSplineTransform->SetParametersByValue(parameters);
+    transform = bSplineTransform;
+
+    if (transformName == "NumericalJacobian")
+    {
+      // A CompositeTransform hides the BSplineTransform from the analytic path.
+      CompositeTransformType::Pointer compositeTransform = CompositeTransformType::New();
+      compositeTransform->AddTransform(bSplineTransform);
+      transform = compositeTransform;
+      useNumericalJacobian = true;
+    }
+  }
+  else if (transformName == "DisplacementField")
+  {
+    auto field = DisplacementFieldType::New();
+    field->SetRegions(size);
+    field->SetSpacing(spacing);
+    field->SetOrigin(origin);
+    field->Allocate();
+    for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    {
+      DisplacementFieldType::PixelType displacement;
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        displacement[d] = generator->GetUniformVariate(-0.1, 0.1);
+      }
+      it.Set(displacement);
+    }
+    DisplacementFieldTransformType::Pointer displacementFieldTransform = DisplacementFieldTransformType::New();
+    displacementFieldTransform->SetDisplacementField(field);
+    transform = displacementFieldTransform;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown transform: " << transformName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // An irregular mask: random pixels, many isolated, plus a ball, so that the
+  // runs have very different lengths.
+  const TensorImageType::RegionType region(size);
+  auto                              mask = MaskImageType::New();
+  mask->SetRegions(region);
+  mask->SetSpacing(spacing);
+  mask->SetOrigin(origin);
+  mask->Allocate();
+  for (itk::ImageRegionIterator<MaskImageType> it(mask, region); !it.IsAtEnd(); ++it)
+  {
+    double squaredRadius = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double distance = (it.GetIndex()[d] - 0.5 * size[d]) / (0.3 * size[d]);
+      squaredRadius += distance * distance;
+    }
+    it.Set(squaredRadius < 1.0 || generator->GetUniformVariate(0.0, 1.0) < 0.15 ? 1 : 0);
+  }
+
+  TransformToStrainFilterType::Pointer strainFilters[3];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = TransformToStrainFilterType::New();
+    strainFilter->SetTransform(transform);
+    strainFilter->SetSize(size);
+    strainFilter->SetSpacing(spacing);
+    strainFilter->SetOrigin(origin);
+    strainFilter->SetStrainForm(TransformToStrainFilterType::GREENLAGRANGIAN);
+    strainFilter->SetUseNumericalJacobian(useNumericalJacobian);
+  }
+
+  // The work units split the runs of the mask.
+  strainFilters[1]->SetMaskImage(mask);
+  ITK_TEST_SET_GET_VALUE(mask.GetPointer(), strainFilters[1]->GetMaskImage());
+  strainFilters[1]->SetNumberOfWorkUnits(7);
+  strainFilters[2]->SetMaskImage(mask);
+  ITK_TEST_SET_GET_BOOLEAN(strainFilters[2], CompactMaskedOutput, true);
+
+  for (auto & strainFilter : strainFilters)
+  {
+    ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  }
+
+  if (strainFilters[2]->GetOutput()->GetBufferPointer() != nullptr)
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "The output is allocated with CompactMaskedOutput." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The strain matches the unmasked strain at the mask pixels, and is zero
+  // elsewhere.  The compact list holds the mask pixels in buffer order.
+  const TransformToStrainFilterType::MaskedIndicesType & maskedIndices = strainFilters[2]->GetMaskedIndices();
+  const TransformToStrainFilterType::MaskedTensorsType & maskedTensors = strainFilters[2]->GetMaskedTensors();
+  ITK_TEST_EXPECT_EQUAL(maskedIndices.size(), maskedTensors.size());
+
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilters[0]->GetOutput(), region);
+  itk::ImageRegionConstIterator<TensorImageType> maskedStrainIt(strainFilters[1]->GetOutput(), region);
+  itk::ImageRegionConstIterator<MaskImageType>   maskIt(mask, region);
+  size_t                                         maskPixel = 0;
+  for (; !strainIt.IsAtEnd(); ++strainIt, ++maskedStrainIt, ++maskIt)
+  {
+    const TensorType & strain = strainIt.Get();
+    const TensorType & maskedStrain = maskedStrainIt.Get();
+    if (!maskIt.Get())
+    {
+      for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+      {
+        if (maskedStrain[c] != 0.0f)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Nonzero strain " << maskedStrain << " outside of the mask at index " << strainIt.GetIndex()
+                    << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+      continue;
+    }
+
+    if (maskPixel >= maskedIndices.size() || maskedIndices[maskPixel] != strainIt.GetIndex())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Mask pixel " << maskPixel << " at index " << strainIt.GetIndex()
+                << " is missing from the compact list." << std::endl;
+      return EXIT_FAILURE;
+    }
+    // The BSpline coefficients are not contracted along short runs, which
+    // changes the rounding.
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (std::abs(maskedStrain[c] - strain[c]) > 1e-5 * (1.0 + std::abs(strain[c])) ||
+          maskedTensors[maskPixel][c] != maskedStrain[c])
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Masked strain differs at index " << strainIt.GetIndex() << ": expected " << strain
+                  << " but got " << maskedStrain << " and " << maskedTensors[maskPixel] << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    ++maskPixel;
+  }
+  ITK_TEST_EXPECT_EQUAL(maskPixel, maskedIndices.size());
+
+  // An empty mask produces a zero output.
+  mask->FillBuffer(0);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[1]->Update());
+  for (itk::ImageRegionConstIterator<TensorImageType> emptyMaskStrainIt(strainFilters[1]->GetOutput(), region);
+       !emptyMaskStrainIt.IsAtEnd();
+       ++emptyMaskStrainIt)
+  {
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (emptyMaskStrainIt.Get()[c] != 0.0f)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Nonzero strain with an empty mask at index " << emptyMaskStrainIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // A mask that is not on the output grid is rejected.
+  mask->SetOrigin(origin + TransformToStrainFilterType::SpacingType(0.5));
+  ITK_TRY_EXPECT_EXCEPTION(strainFilters[1]->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
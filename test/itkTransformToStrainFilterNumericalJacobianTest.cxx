@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkBSplineTransform.h"
+#include "itkCompositeTransform.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Compare the strain of the numerical Jacobian of a BSplineTransform, hidden
+// in a CompositeTransform, to its analytic strain.
+template <unsigned int VDimension>
+int
+CompareNumericalJacobian(unsigned int numericalJacobianStep, double tolerance)
+{
+  constexpr unsigned int Dimension = VDimension;
+  constexpr unsigned int SplineOrder = 3;
+  using ScalarPixelType = float;
+  using CoordRepresentationType = double;
+
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using BSplineTransformType = itk::BSplineTransform<CoordRepresentationType, Dimension, SplineOrder>;
+  using CompositeTransformType = itk::CompositeTransform<CoordRepresentationType, Dimension>;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, ScalarPixelType, ScalarPixelType>;
+  using TensorImageType = typename TransformToStrainFilterType::OutputImageType;
+
+  typename TransformToStrainFilterType::SizeType    size;
+  typename TransformToStrainFilterType::SpacingType spacing;
+  for (unsigned int d = 0; d < Dimension; ++d)
+  {
+    size[d] = 24 - 4 * d;
+    spacing[d] = 0.8 + 0.2 * d;
+  }
+  typename TransformToStrainFilterType::PointType origin;
+  origin.Fill(-5.0);
+
+  // The domain of the transform extends beyond the output grid, so that the
+  // numerical stencil does not cross the boundary of its support.
+  typename BSplineTransformType::Pointer                bSplineTransform = BSplineTransformType::New();
+  typename BSplineTransformType::OriginType             domainOrigin;
+  typename BSplineTransformType::PhysicalDimensionsType domainDimensions;
+  typename BSplineTransformType::MeshSizeType           meshSize;
+  for (unsigned int d = 0; d < Dimension; ++d)
+  {
+    domainOrigin[d] = origin[d] - 4.0 * spacing[d];
+    domainDimensions[d] = spacing[d] * (size[d] + 7.0);
+    meshSize[d] = 3;
+  }
+  bSplineTransform->SetTransformDomainOrigin(domainOrigin);
+  bSplineTransform->SetTransformDomainPhysicalDimensions(domainDimensions);
+  bSplineTransform->SetTransformDomainMeshSize(meshSize);
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(7);
+  typename BSplineTransformType::ParametersType parameters(bSplineTransform->GetNumberOfParameters());
+  for (unsigned int p = 0; p < parameters.GetSize(); ++p)
+  {
+    parameters[p] = generator->GetUniformVariate(-0.2, 0.2);
+  }
+  bSplineTransform->SetParametersByValue(parameters);
+
+  // A CompositeTransform hides the BSplineTransform from the analytic path,
+  // and its Jacobian with respect to the position is not implemented.
+  typename CompositeTransformType::Pointer compositeTransform = CompositeTransformType::New();
+  compositeTransform->AddTransform(bSplineTransform);
+
+  typename TransformToStrainFilterType::Pointer strainFilters[2];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = TransformToStrainFilterType::New();
+    strainFilter->SetSize(size);
+    strainFilter->SetSpacing(spacing);
+    strainFilter->SetOrigin(origin);
+    strainFilter->SetStrainForm(TransformToStrainFilterType::GREENLAGRANGIAN);
+  }
+  strainFilters[0]->SetTransform(bSplineTransform);
+  strainFilters[1]->SetTransform(compositeTransform);
+
+  ITK_TEST_SET_GET_BOOLEAN(strainFilters[1], UseNumericalJacobian, true);
+  strainFilters[1]->SetNumericalJacobianStep(numericalJacobianStep);
+  ITK_TEST_SET_GET_VALUE(numericalJacobianStep, strainFilters[1]->GetNumericalJacobianStep());
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[0]->Update());
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[1]->Update());
+
+
+  const TensorImageType *                        analytic = strainFilters[0]->GetOutput();
+  const TensorImageType *                        numerical = strainFilters[1]->GetOutput();
+  itk::ImageRegionConstIterator<TensorImageType> analyticIt(analytic, analytic->GetBufferedRegion());
+  itk::ImageRegionConstIterator<TensorImageType> numericalIt(numerical, analytic->GetBufferedRegion());
+  double                                         maximumDifference = 0.0;
+  for (; !analyticIt.IsAtEnd(); ++analyticIt, ++numericalIt)
+  {
+    for (unsigned int c = 0; c < TensorImageType::PixelType::InternalDimension; ++c)
+    {
+      const double difference = std::abs(analyticIt.Get()[c] - numericalIt.Get()[c]);
+      maximumDifference = std::max(maximumDifference, difference);
+      if (difference > tolerance)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << Dimension << "-D numerical strain differs at index " << analyticIt.GetIndex() << ": expected "
+                  << analyticIt.Get() << " but got " << numericalIt.Get() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  std::cout << Dimension << "-D maximum difference to the analytic strain: " << maximumDifference << std::endl;
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int
+itkTransformToStrainFilterNumericalJacobianTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " numericalJacobianStep tolerance";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const unsigned int numericalJacobianStep = std::stoi(argv[1]);
+  const double       tolerance = std::stod(argv[2]);
+
+  if (CompareNumericalJacobian<3>(numericalJacobianStep, tolerance) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  // A 1-D image has no second index axis for the scanline cache.
+  if (CompareNumericalJacobian<1>(numericalJacobianStep, tolerance) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineTransform.h"
+#include "itkBSplineTransform.h"
+#include "itkCompositeTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <string>
+
+int
+itkTransformToStrainFilterOutputLayoutTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " transform";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string transformName = argv[1];
+
+  constexpr unsigned int Dimension = 2;
+  constexpr unsigned int SplineOrder = 3;
+  using ScalarPixelType = float;
+  using CoordRepresentationType = double;
+
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, Dimension>;
+  using BSplineTransformType = itk::BSplineTransform<CoordRepresentationType, Dimension, SplineOrder>;
+  using CompositeTransformType = itk::CompositeTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldType = DisplacementFieldTransformType::DisplacementFieldType;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, ScalarPixelType, ScalarPixelType>;
+  using TensorImageType = TransformToStrainFilterType::OutputImageType;
+  using ComponentImageType = TransformToStrainFilterType::ComponentImageType;
+  using VoigtImageType = TransformToStrainFilterType::VoigtImageType;
+  using MaskImageType = TransformToStrainFilterType::MaskImageType;
+
+  TransformToStrainFilterType::SizeType size;
+  size[0] = 31;
+  size[1] = 26;
+  TransformToStrainFilterType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.1;
+  TransformToStrainFilterType::PointType origin;
+  origin.Fill(-6.0);
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(23);
+
+  TransformType::Pointer transform;
+  bool                   useNumericalJacobian = false;
+  if (transformName == "Affine")
+  {
+    AffineTransformType::Pointer        affineTransform = AffineTransformType::New();
+    AffineTransformType::ParametersType parameters = affineTransform->GetParameters();
+    for (unsigned int p = 0; p < Dimension * Dimension; ++p)
+    {
+      parameters[p] += generator->GetUniformVariate(-0.1, 0.1);
+    }
+    affineTransform->SetParameters(parameters);
+    transform = affineTransform;
+  }
+  else if (transformName == "BSpline" || transformName == "NumericalJacobian")
+  {
+    BSplineTransformType::Pointer                bSplineTransform = BSplineTransformType::New();
+    BSplineTransformType::OriginType             domainOrigin;
+    BSplineTransformType::PhysicalDimensionsType domainDimensions;
+    BSplineTransformType::MeshSizeType           meshSize;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      domainOrigin[d] = origin[d] - 4.0 * spacing[d];
+      domainDimensions[d] = spacing[d] * (size[d] + 7.0);
+      meshSize[d] = 4;
+    }
+    bSplineTransform->SetTransformDomainOrigin(domainOrigin);
+    bSplineTransform->SetTransformDomainPhysicalDimensions(domainDimensions);
+    bSplineTransform->SetTransformDomainMeshSize(meshSize);
+    BSplineTransformType::ParametersType parameters(bSplineTransform->GetNumberOfParameters());
+    for (unsigned int p = 0; p < parameters.GetSize(); ++p)
+    {
+      parameters[p] = generator->GetUniformVariate(-0.2, 0.2);
+    }
+    bSplineTransform->SetParametersByValue(parameters);
+    transform = bSplineTransform;
+
+    if (transformName == "NumericalJacobian")
+    {
+      // A CompositeTransform hides the BSplineTransform from the analytic path.
+      CompositeTransformType::Pointer compositeTransform = CompositeTransformType::New();
+      compositeTransform->AddTransform(bSplineTransform);
+      transform = compositeTransform;
+      useNumericalJacobian = true;
+    }
+  }
+  else if (transformName == "DisplacementField")
+  {
+    auto field = DisplacementFieldType::New();
+    field->SetRegions(size);
+    field->SetSpacing(spacing);
+    field->SetOrigin(origin);
+    field->Allocate();
+    for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    {
+      DisplacementFieldType::PixelType displacement;
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        displacement[d] = generator->GetUniformVariate(-0.1, 0.1);
+      }
+      it.Set(displacement);
+    }
+    DisplacementFieldTransformType::Pointer displacementFieldTransform = DisplacementFieldTransformType::New();
+    displacementFieldTransform->SetDisplacementField(field);
+    transform = displacementFieldTransform;
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown transform: " << transformName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const TensorImageType::RegionType region(size);
+  auto                              mask = MaskImageType::New();
+  mask->SetRegions(region);
+  mask->SetSpacing(spacing);
+  mask->SetOrigin(origin);
+  mask->Allocate();
+  for (itk::ImageRegionIterator<MaskImageType> it(mask, region); !it.IsAtEnd(); ++it)
+  {
+    it.Set(generator->GetUniformVariate(0.0, 1.0) < 0.5 ? 1 : 0);
+  }
+
+  TransformToStrainFilterType::Pointer strainFilters[3];
+  for (auto & strainFilter : strainFilters)
+  {
+    strainFilter = TransformToStrainFilterType::New();
+    strainFilter->SetTransform(transform);
+    strainFilter->SetSize(size);
+    strainFilter->SetSpacing(spacing);
+    strainFilter->SetOrigin(origin);
+    strainFilter->SetStrainForm(TransformToStrainFilterType::EULERIANALMANSI);
+    strainFilter->SetUseNumericalJacobian(useNumericalJacobian);
+  }
+  ITK_TEST_SET_GET_VALUE(TransformToStrainFilterType::TENSORIMAGE, strainFilters[0]->GetOutputLayout());
+  strainFilters[1]->SetOutputLayout(TransformToStrainFilterType::COMPONENTIMAGES);
+  ITK_TEST_SET_GET_VALUE(TransformToStrainFilterType::COMPONENTIMAGES, strainFilters[1]->GetOutputLayout());
+  strainFilters[2]->SetOutputLayout(TransformToStrainFilterType::VOIGTIMAGE);
+  ITK_TEST_SET_GET_VALUE(TransformToStrainFilterType::VOIGTIMAGE, strainFilters[2]->GetOutputLayout());
+
+  // The components are xx, yy, xy, with or without a mask.
+  constexpr unsigned int voigtComponents[3][2] = { { 0, 0 }, { 1, 1 }, { 0, 1 } };
+  for (unsigned int masked = 0; masked < 2; ++masked)
+  {
+    for (auto & strainFilter : strainFilters)
+    {
+      strainFilter->SetMaskImage(masked ? mask.GetPointer() : nullptr);
+      ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+    }
+
+    // Only the outputs of the layout are allocated, with the geometry of the
+    // tensor image.
+    const VoigtImageType * voigtImage = strainFilters[2]->GetVoigtOutput();
+    ITK_TEST_EXPECT_TRUE(strainFilters[1]->GetOutput()->GetBufferPointer() == nullptr);
+    ITK_TEST_EXPECT_TRUE(strainFilters[2]->GetOutput()->GetBufferPointer() == nullptr);
+    ITK_TEST_EXPECT_TRUE(strainFilters[1]->GetVoigtOutput()->GetBufferPointer() == nullptr);
+    for (unsigned int k = 0; k < TransformToStrainFilterType::TensorComponents; ++k)
+    {
+      ITK_TEST_EXPECT_TRUE(strainFilters[2]->GetComponentOutput(k)->GetBufferPointer() == nullptr);
+    }
+    ITK_TEST_EXPECT_EQUAL(voigtImage->GetNumberOfComponentsPerPixel(), 3u);
+    ITK_TEST_EXPECT_EQUAL(voigtImage->GetSpacing(), strainFilters[0]->GetOutput()->GetSpacing());
+    ITK_TEST_EXPECT_EQUAL(strainFilters[1]->GetComponentOutput(0)->GetOrigin(),
+                          strainFilters[0]->GetOutput()->GetOrigin());
+
+    for (itk::ImageRegionConstIterator<TensorImageType> it(strainFilters[0]->GetOutput(), region); !it.IsAtEnd(); ++it)
+    {
+      for (unsigned int k = 0; k < TransformToStrainFilterType::TensorComponents; ++k)
+      {
+        const ComponentImageType * componentImage = strainFilters[1]->GetComponentOutput(k);
+        const float                expected = it.Get()(voigtComponents[k][0], voigtComponents[k][1]);
+        if (componentImage->GetPixel(it.GetIndex()) != expected || voigtImage->GetPixel(it.GetIndex())[k] != expected)
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Component " << k << " differs at index " << it.GetIndex() << ": expected " << expected
+                    << " but got " << componentImage->GetPixel(it.GetIndex()) << " and "
+                    << voigtImage->GetPixel(it.GetIndex())[k] << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
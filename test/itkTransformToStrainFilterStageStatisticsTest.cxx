@@ -0,0 +1,250 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineTransform.h"
+#include "itkBSplineTransform.h"
+#include "itkCompositeTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkTransformToStrainFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <string>
+#include <vector>
+
+int
+itkTransformToStrainFilterStageStatisticsTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " transform";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const std::string transformName = argv[1];
+
+  constexpr unsigned int Dimension = 2;
+  constexpr unsigned int SplineOrder = 3;
+  using ScalarPixelType = float;
+  using CoordRepresentationType = double;
+
+  using TransformType = itk::Transform<CoordRepresentationType, Dimension, Dimension>;
+  using AffineTransformType = itk::AffineTransform<CoordRepresentationType, Dimension>;
+  using BSplineTransformType = itk::BSplineTransform<CoordRepresentationType, Dimension, SplineOrder>;
+  using CompositeTransformType = itk::CompositeTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  using DisplacementFieldType = DisplacementFieldTransformType::DisplacementFieldType;
+  using TransformToStrainFilterType = itk::TransformToStrainFilter<TransformType, ScalarPixelType, ScalarPixelType>;
+  using TensorImageType = TransformToStrainFilterType::OutputImageType;
+
+  TransformToStrainFilterType::SizeType size;
+  size[0] = 37;
+  size[1] = 29;
+  TransformToStrainFilterType::SpacingType spacing;
+  spacing[0] = 0.9;
+  spacing[1] = 1.2;
+  TransformToStrainFilterType::PointType origin;
+  origin.Fill(-5.0);
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(29);
+
+  // The displacement field is sampled on the output grid, or, for the
+  // Jacobian of the transform, on a finer grid.
+  auto makeDisplacementField = [&](double fieldSpacingFactor) {
+    auto                               field = DisplacementFieldType::New();
+    DisplacementFieldType::SpacingType fieldSpacing = spacing;
+    DisplacementFieldType::SizeType    fieldSize = size;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      fieldSpacing[d] *= fieldSpacingFactor;
+      fieldSize[d] = static_cast<itk::SizeValueType>(size[d] / fieldSpacingFactor);
+    }
+    field->SetRegions(fieldSize);
+    field->SetSpacing(fieldSpacing);
+    field->SetOrigin(origin);
+    field->Allocate();
+    for (itk::ImageRegionIterator<DisplacementFieldType> it(field, field->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    {
+      DisplacementFieldType::PixelType displacement;
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        displacement[d] = generator->GetUniformVariate(-0.1, 0.1);
+      }
+      it.Set(displacement);
+    }
+    DisplacementFieldTransformType::Pointer displacementFieldTransform = DisplacementFieldTransformType::New();
+    displacementFieldTransform->SetDisplacementField(field);
+    return displacementFieldTransform;
+  };
+
+  TransformType::Pointer transform;
+  bool                   useNumericalJacobian = false;
+  if (transformName == "Affine")
+  {
+    AffineTransformType::Pointer        affineTransform = AffineTransformType::New();
+    AffineTransformType::ParametersType parameters = affineTransform->GetParameters();
+    for (unsigned int p = 0; p < Dimension * Dimension; ++p)
+    {
+      parameters[p] += generator->GetUniformVariate(-0.1, 0.1);
+    }
+    affineTransform->SetParameters(parameters);
+    transform = affineTransform;
+  }
+  else if (transformName == "BSpline" || transformName == "NumericalJacobian")
+  {
+    BSplineTransformType::Pointer                bSplineTransform = BSplineTransformType::New();
+    BSplineTransformType::OriginType             domainOrigin;
+    BSplineTransformType::PhysicalDimensionsType domainDimensions;
+    BSplineTransformType::MeshSizeType           meshSize;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      domainOrigin[d] = origin[d] - 4.0 * spacing[d];
+      domainDimensions[d] = spacing[d] * (size[d] + 7.0);
+      meshSize[d] = 5;
+    }
+    bSplineTransform->SetTransformDomainOrigin(domainOrigin);
+    bSplineTransform->SetTransformDomainPhysicalDimensions(domainDimensions);
+    bSplineTransform->SetTransformDomainMeshSize(meshSize);
+    BSplineTransformType::ParametersType parameters(bSplineTransform->GetNumberOfParameters());
+    for (unsigned int p = 0; p < parameters.GetSize(); ++p)
+    {
+      parameters[p] = generator->GetUniformVariate(-0.2, 0.2);
+    }
+    bSplineTransform->SetParametersByValue(parameters);
+    transform = bSplineTransform;
+
+    if (transformName == "NumericalJacobian")
+    {
+      // A CompositeTransform hides the BSplineTransform from the analytic path.
+      CompositeTransformType::Pointer compositeTransform = CompositeTransformType::New();
+      compositeTransform->AddTransform(bSplineTransform);
+      transform = compositeTransform;
+      useNumericalJacobian = true;
+    }
+  }
+  else if (transformName == "DisplacementField")
+  {
+    transform = makeDisplacementField(1.0);
+  }
+  else if (transformName == "Jacobian")
+  {
+    transform = makeDisplacementField(0.5);
+  }
+  else
+  {
+    std::cerr << "Test failed!" << std::endl;
+    std::cerr << "Unknown transform: " << transformName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TransformToStrainFilterType::Pointer strainFilters[2];
+  for (auto & filter : strainFilters)
+  {
+    filter = TransformToStrainFilterType::New();
+    filter->SetTransform(transform);
+    filter->SetSize(size);
+    filter->SetSpacing(spacing);
+    filter->SetOrigin(origin);
+    filter->SetStrainForm(TransformToStrainFilterType::GREENLAGRANGIAN);
+    filter->SetUseNumericalJacobian(useNumericalJacobian);
+  }
+  TransformToStrainFilterType * strainFilter = strainFilters[1];
+
+  std::vector<itk::StrainStageEvent> events;
+  strainFilter->AddObserver(itk::StrainStageEvent(), [&events](const itk::EventObject & event) {
+    events.push_back(dynamic_cast<const itk::StrainStageEvent &>(event));
+  });
+  ITK_TEST_SET_GET_VALUE(false, strainFilter->GetCollectStageStatistics());
+  ITK_TEST_SET_GET_BOOLEAN(strainFilter, CollectStageStatistics, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilters[0]->Update());
+
+  // The tensors assembled apart from the Jacobians are the same.
+  const TensorImageType::RegionType              region(size);
+  itk::ImageRegionConstIterator<TensorImageType> expectedIt(strainFilters[0]->GetOutput(), region);
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(strainFilter->GetOutput(), region);
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++strainIt)
+  {
+    if (strainIt.Get() != expectedIt.Get())
+    {
+      std::cerr << "Test failed!" << std::endl;
+      std::cerr << "Strain differs at index " << expectedIt.GetIndex() << ": expected " << expectedIt.Get()
+                << " but got " << strainIt.Get() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  ITK_TEST_EXPECT_EQUAL(events.size(), static_cast<size_t>(TransformToStrainFilterType::NumberOfStages));
+  if (events.size() != TransformToStrainFilterType::NumberOfStages)
+  {
+    return EXIT_FAILURE;
+  }
+  for (unsigned int stage = 0; stage < TransformToStrainFilterType::NumberOfStages; ++stage)
+  {
+    const auto   stageType = static_cast<TransformToStrainFilterType::StageType>(stage);
+    const auto & statistics = strainFilter->GetStageStatistics(stageType);
+    std::cout << TransformToStrainFilterType::GetStageName(stageType) << ": " << statistics << std::endl;
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStage(), stage);
+    ITK_TEST_EXPECT_EQUAL(std::string(events[stage].GetStageName()),
+                          std::string(TransformToStrainFilterType::GetStageName(stageType)));
+    ITK_TEST_EXPECT_EQUAL(events[stage].GetStatistics().WallTime, statistics.WallTime);
+    ITK_TEST_EXPECT_TRUE(statistics.WallTime >= 0.0);
+    ITK_TEST_EXPECT_TRUE(statistics.Threads > 0);
+  }
+
+  const auto & jacobians = strainFilter->GetStageStatistics(TransformToStrainFilterType::JACOBIANEVALUATION);
+  const auto & assembly = strainFilter->GetStageStatistics(TransformToStrainFilterType::TENSORASSEMBLY);
+  ITK_TEST_EXPECT_EQUAL(assembly.BytesAllocated,
+                        region.GetNumberOfPixels() * TransformToStrainFilterType::TensorComponents *
+                          sizeof(ScalarPixelType));
+  if (transformName == "Affine")
+  {
+    // The Jacobian of a linear transform is evaluated once.
+    ITK_TEST_EXPECT_EQUAL(jacobians.Threads, 1u);
+  }
+  else
+  {
+    ITK_TEST_EXPECT_TRUE(jacobians.WallTime > 0.0);
+    ITK_TEST_EXPECT_EQUAL(jacobians.Threads, assembly.Threads);
+  }
+
+  // Nothing is measured when off.
+  strainFilter->CollectStageStatisticsOff();
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+  ITK_TEST_EXPECT_EQUAL(events.size(), static_cast<size_t>(TransformToStrainFilterType::NumberOfStages));
+  for (unsigned int stage = 0; stage < TransformToStrainFilterType::NumberOfStages; ++stage)
+  {
+    const auto & statistics =
+      strainFilter->GetStageStatistics(static_cast<TransformToStrainFilterType::StageType>(stage));
+    ITK_TEST_EXPECT_EQUAL(statistics.WallTime, 0.0);
+    ITK_TEST_EXPECT_EQUAL(statistics.BytesAllocated, 0u);
+    ITK_TEST_EXPECT_EQUAL(statistics.Threads, 0u);
+  }
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
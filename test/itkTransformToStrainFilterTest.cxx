@@ -17,9 +17,12 @@
  *=========================================================================*/
 #include "itkAffineTransform.h"
 #include "itkBSplineTransform.h"
+#include "itkDisplacementFieldTransform.h"
 #include "itkSimilarity2DTransform.h"
 #include "itkTransformToStrainFilter.h"
 #include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
 #include "itkTransformToDisplacementFieldFilter.h"
 #include "itkStrainImageFilter.h"
 #include "itkTestingMacros.h"
@@ -134,6 +137,9 @@ itkTransformToStrainFilterTest(int argc, char * argv[])
   using SimilarityTransformType = itk::Similarity2DTransform<CoordRepresentationType>;
   SimilarityTransformType::Pointer similarityTransform = SimilarityTransformType::New();
 
+  using DisplacementFieldTransformType = itk::DisplacementFieldTransform<CoordRepresentationType, Dimension>;
+  DisplacementFieldTransformType::Pointer displacementFieldTransform = DisplacementFieldTransformType::New();
+
   if (transformName == "Similarity")
   {
     transformToStrainFilter->SetTransform(similarityTransform.GetPointer());
@@ -222,6 +228,34 @@ itkTransformToStrainFilterTest(int argc, char * argv[])
     }
     bSplineTransform->SetParametersByValue(parameters);
   }
+  else if (transformName == "DisplacementField")
+  {
+    transformToStrainFilter->SetTransform(displacementFieldTransform);
+    ITK_TEST_SET_GET_VALUE(displacementFieldTransform, transformToStrainFilter->GetTransform());
+
+    transformToDisplacement->SetTransform(displacementFieldTransform);
+
+    // A smooth field on the output grid.
+    using FieldType = DisplacementFieldTransformType::DisplacementFieldType;
+    FieldType::Pointer    field = FieldType::New();
+    FieldType::RegionType fieldRegion;
+    fieldRegion.SetSize(size);
+    field->SetRegions(fieldRegion);
+    field->SetSpacing(spacing);
+    field->SetOrigin(origin);
+    field->Allocate();
+    itk::ImageRegionIteratorWithIndex<FieldType> fieldIt(field, fieldRegion);
+    for (; !fieldIt.IsAtEnd(); ++fieldIt)
+    {
+      FieldType::PointType point;
+      field->TransformIndexToPhysicalPoint(fieldIt.GetIndex(), point);
+      FieldType::PixelType displacement;
+      displacement[0] = 0.05 * point[0] + 0.002 * point[1] * point[1];
+      displacement[1] = 0.3 * std::sin(0.2 * point[0]) - 0.04 * point[1];
+      fieldIt.Set(displacement);
+    }
+    displacementFieldTransform->SetDisplacementField(field);
+  }
   else
   {
     std::cerr << "Test failed!" << std::endl;
@@ -253,6 +287,108 @@ itkTransformToStrainFilterTest(int argc, char * argv[])
   ITK_TRY_EXPECT_NO_EXCEPTION(writer->Update());
 
 
+  // The strain of a linear transform is the same at every pixel.
+  using OutputPixelType = TransformToStrainFilterType::OutputPixelType;
+  OutputPixelType constantStrain;
+  const bool      linearTransform = transformToStrainFilter->ComputeConstantStrain(constantStrain);
+  ITK_TEST_EXPECT_EQUAL(linearTransform, transformName == "Affine" || transformName == "Similarity");
+  if (linearTransform)
+  {
+    const TransformToStrainFilterType::OutputImageType * strainField = transformToStrainFilter->GetOutput();
+    itk::ImageRegionConstIterator<TransformToStrainFilterType::OutputImageType> strainIt(
+      strainField, strainField->GetBufferedRegion());
+    for (; !strainIt.IsAtEnd(); ++strainIt)
+    {
+      if (strainIt.Get() != constantStrain)
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Expected the constant strain " << constantStrain << " but got " << strainIt.Get()
+                  << " at index " << strainIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+
+  // The strain of a displacement field on the output grid is computed with the
+  // fused stencil of StrainImageFilter.
+  if (transformName == "DisplacementField")
+  {
+    using FieldType = DisplacementFieldTransformType::DisplacementFieldType;
+    using FusedStrainImageFilterType = itk::StrainImageFilter<FieldType, ScalarPixelType, ScalarPixelType>;
+    FusedStrainImageFilterType::Pointer fusedStrainImageFilter = FusedStrainImageFilterType::New();
+    fusedStrainImageFilter->SetInput(displacementFieldTransform->GetDisplacementField());
+    fusedStrainImageFilter->SetStrainForm(static_cast<FusedStrainImageFilterType::StrainFormType>(strainForm));
+    fusedStrainImageFilter->FusedGradientOn();
+    ITK_TRY_EXPECT_NO_EXCEPTION(fusedStrainImageFilter->Update());
+
+    const TransformToStrainFilterType::OutputImageType * strainField = transformToStrainFilter->GetOutput();
+    itk::ImageRegionConstIterator<TransformToStrainFilterType::OutputImageType> strainIt(
+      strainField, strainField->GetBufferedRegion());
+    itk::ImageRegionConstIterator<FusedStrainImageFilterType::OutputImageType> fusedIt(
+      fusedStrainImageFilter->GetOutput(), strainField->GetBufferedRegion());
+    for (; !strainIt.IsAtEnd(); ++strainIt, ++fusedIt)
+    {
+      if (strainIt.Get() != fusedIt.Get())
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Expected the strain of the displacement field " << fusedIt.Get() << " but got "
+                  << strainIt.Get() << " at index " << strainIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    // A field that is only buffered around a requested region, with the
+    // neighbors the stencil reads, gives the strain of the whole field there.
+    const FieldType *     field = displacementFieldTransform->GetDisplacementField();
+    FieldType::RegionType requestedRegion;
+    requestedRegion.SetIndex(0, 0);
+    requestedRegion.SetIndex(1, 6);
+    requestedRegion.SetSize(0, 9);
+    requestedRegion.SetSize(1, 8);
+    FieldType::RegionType croppedFieldRegion = requestedRegion;
+    croppedFieldRegion.PadByRadius(1);
+    croppedFieldRegion.Crop(field->GetLargestPossibleRegion());
+
+    FieldType::Pointer croppedField = FieldType::New();
+    croppedField->CopyInformation(field);
+    croppedField->SetRegions(croppedFieldRegion);
+    croppedField->SetLargestPossibleRegion(field->GetLargestPossibleRegion());
+    croppedField->Allocate();
+    itk::ImageRegionIteratorWithIndex<FieldType> croppedFieldIt(croppedField, croppedFieldRegion);
+    for (; !croppedFieldIt.IsAtEnd(); ++croppedFieldIt)
+    {
+      croppedFieldIt.Set(field->GetPixel(croppedFieldIt.GetIndex()));
+    }
+    DisplacementFieldTransformType::Pointer croppedFieldTransform = DisplacementFieldTransformType::New();
+    croppedFieldTransform->SetDisplacementField(croppedField);
+
+    TransformToStrainFilterType::Pointer croppedStrainFilter = TransformToStrainFilterType::New();
+    croppedStrainFilter->SetTransform(croppedFieldTransform);
+    croppedStrainFilter->SetStrainForm(static_cast<TransformToStrainFilterType::StrainFormType>(strainForm));
+    croppedStrainFilter->SetSize(size);
+    croppedStrainFilter->SetSpacing(spacing);
+    croppedStrainFilter->SetOrigin(origin);
+    croppedStrainFilter->UpdateOutputInformation();
+    croppedStrainFilter->GetOutput()->SetRequestedRegion(requestedRegion);
+    ITK_TRY_EXPECT_NO_EXCEPTION(croppedStrainFilter->GetOutput()->Update());
+
+    itk::ImageRegionConstIterator<TransformToStrainFilterType::OutputImageType> croppedIt(
+      croppedStrainFilter->GetOutput(), requestedRegion);
+    itk::ImageRegionConstIterator<TransformToStrainFilterType::OutputImageType> wholeIt(strainField, requestedRegion);
+    for (; !croppedIt.IsAtEnd(); ++croppedIt, ++wholeIt)
+    {
+      if (croppedIt.Get() != wholeIt.Get())
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Expected the strain of the whole field " << wholeIt.Get() << " but got " << croppedIt.Get()
+                  << " at index " << croppedIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+
   // Write strain computed from the displacement field.
   using StrainImageFilterType = itk::StrainImageFilter<DisplacementFieldType, CoordRepresentationType>;
   StrainImageFilterType::Pointer strainImageFilter = StrainImageFilterType::New();
@@ -0,0 +1,197 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkVectorGradientRecursiveGaussianImageFilter.h"
+#include "itkGradientRecursiveGaussianImageFilter.h"
+#include "itkSplitComponentsImageFilter.h"
+#include "itkStrainImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <cstdlib>
+
+int
+itkVectorGradientRecursiveGaussianImageFilterTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0];
+    std::cerr << " sigma normalizeAcrossScale";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+
+  const double sigma = std::atof(argv[1]);
+  const bool   normalizeAcrossScale = std::atoi(argv[2]) != 0;
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using DisplacementVectorType = itk::Vector<PixelType, Dimension>;
+  using InputImageType = itk::Image<DisplacementVectorType, Dimension>;
+  using ComponentImageType = itk::Image<PixelType, Dimension>;
+
+  using StrainFilterType = itk::StrainImageFilter<InputImageType, PixelType, PixelType>;
+  using TensorImageType = StrainFilterType::OutputImageType;
+  using TensorType = TensorImageType::PixelType;
+  using GradientOutputImageType = StrainFilterType::GradientOutputImageType;
+  using GradientType = GradientOutputImageType::PixelType;
+
+  using VectorGradientFilterType =
+    itk::VectorGradientRecursiveGaussianImageFilter<InputImageType, GradientOutputImageType>;
+  using GradientFilterType = itk::GradientRecursiveGaussianImageFilter<ComponentImageType, GradientOutputImageType>;
+  using SplitFilterType = itk::SplitComponentsImageFilter<InputImageType, ComponentImageType>;
+
+  // A smooth displacement plus noise, with an anisotropic spacing and an
+  // oblique direction.
+  InputImageType::SizeType size;
+  size[0] = 23;
+  size[1] = 17;
+  size[2] = 11;
+  InputImageType::IndexType start;
+  start[0] = 4;
+  start[1] = -2;
+  start[2] = 0;
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.1;
+  spacing[2] = 1.6;
+  InputImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[0][0] = direction[1][1] = std::cos(0.3);
+  direction[0][1] = -std::sin(0.3);
+  direction[1][0] = std::sin(0.3);
+
+  auto displacements = InputImageType::New();
+  displacements->SetRegions(InputImageType::RegionType(start, size));
+  displacements->SetSpacing(spacing);
+  displacements->SetDirection(direction);
+  displacements->Allocate();
+
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(7);
+  for (itk::ImageRegionIterator<InputImageType> it(displacements, displacements->GetBufferedRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    DisplacementVectorType          displacement;
+    displacement[0] = 0.1 * std::sin(0.3 * index[0]) + 0.02 * index[2] + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[1] = 0.05 * index[0] - 0.03 * index[1] * index[2] / 10.0 + generator->GetUniformVariate(-0.01, 0.01);
+    displacement[2] = 0.2 * std::cos(0.2 * index[1]) + generator->GetUniformVariate(-0.01, 0.01);
+    it.Set(displacement);
+  }
+
+  auto vectorGradientFilter = VectorGradientFilterType::New();
+
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(
+    vectorGradientFilter, VectorGradientRecursiveGaussianImageFilter, ImageToImageFilter);
+
+  vectorGradientFilter->SetInput(displacements);
+  ITK_TEST_SET_GET_VALUE(1.0, vectorGradientFilter->GetSigma());
+  vectorGradientFilter->SetSigma(sigma);
+  ITK_TEST_SET_GET_VALUE(sigma, vectorGradientFilter->GetSigma());
+  ITK_TEST_SET_GET_BOOLEAN(vectorGradientFilter, NormalizeAcrossScale, normalizeAcrossScale);
+  ITK_TEST_SET_GET_BOOLEAN(vectorGradientFilter, UseImageDirection, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(vectorGradientFilter->Update());
+
+  // Each output is the gradient of one component with
+  // GradientRecursiveGaussianImageFilter.
+  auto splitFilter = SplitFilterType::New();
+  splitFilter->SetInput(displacements);
+  for (unsigned int i = 0; i < Dimension; ++i)
+  {
+    auto gradientFilter = GradientFilterType::New();
+    gradientFilter->SetInput(splitFilter->GetOutput(i));
+    gradientFilter->SetSigma(sigma);
+    gradientFilter->SetNormalizeAcrossScale(normalizeAcrossScale);
+    ITK_TRY_EXPECT_NO_EXCEPTION(gradientFilter->Update());
+
+    itk::ImageRegionConstIterator<GradientOutputImageType> expectedIt(gradientFilter->GetOutput(),
+                                                                      displacements->GetBufferedRegion());
+    itk::ImageRegionConstIterator<GradientOutputImageType> gradientIt(vectorGradientFilter->GetOutput(i),
+                                                                      displacements->GetBufferedRegion());
+    for (; !expectedIt.IsAtEnd(); ++expectedIt, ++gradientIt)
+    {
+      const GradientType & expected = expectedIt.Get();
+      const GradientType & computed = gradientIt.Get();
+      for (unsigned int k = 0; k < Dimension; ++k)
+      {
+        if (std::abs(computed[k] - expected[k]) > 1e-5 + 1e-4 * std::abs(expected[k]))
+        {
+          std::cerr << "Test failed!" << std::endl;
+          std::cerr << "Gradient of component " << i << " differs at index " << expectedIt.GetIndex() << ": expected "
+                    << expected << " but got " << computed << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  // As the VectorGradientFilter of StrainImageFilter, it gives the strain of
+  // the GradientFilter.
+  auto gradientFilter = GradientFilterType::New();
+  gradientFilter->SetSigma(sigma);
+  gradientFilter->SetNormalizeAcrossScale(normalizeAcrossScale);
+  auto strainFilter = StrainFilterType::New();
+  strainFilter->SetInput(displacements);
+  strainFilter->SetGradientFilter(gradientFilter);
+  ITK_TRY_EXPECT_NO_EXCEPTION(strainFilter->Update());
+
+  auto vectorStrainFilter = StrainFilterType::New();
+  vectorStrainFilter->SetInput(displacements);
+  vectorStrainFilter->SetVectorGradientFilter(vectorGradientFilter);
+  ITK_TEST_SET_GET_VALUE(vectorGradientFilter.GetPointer(), vectorStrainFilter->GetVectorGradientFilter());
+  ITK_TRY_EXPECT_NO_EXCEPTION(vectorStrainFilter->Update());
+
+  itk::ImageRegionConstIterator<TensorImageType> expectedIt(strainFilter->GetOutput(),
+                                                            displacements->GetBufferedRegion());
+  itk::ImageRegionConstIterator<TensorImageType> strainIt(vectorStrainFilter->GetOutput(),
+                                                          displacements->GetBufferedRegion());
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++strainIt)
+  {
+    const TensorType & expected = expectedIt.Get();
+    const TensorType & computed = strainIt.Get();
+    for (unsigned int c = 0; c < TensorType::InternalDimension; ++c)
+    {
+      if (std::abs(computed[c] - expected[c]) > 1e-5 + 1e-4 * std::abs(expected[c]))
+      {
+        std::cerr << "Test failed!" << std::endl;
+        std::cerr << "Strain differs at index " << expectedIt.GetIndex() << ": expected " << expected << " but got "
+                  << computed << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // The recursions need at least four pixels along each axis.
+  size[2] = 3;
+  auto thinDisplacements = InputImageType::New();
+  thinDisplacements->SetRegions(size);
+  thinDisplacements->Allocate(true);
+  vectorGradientFilter->SetInput(thinDisplacements);
+  ITK_TRY_EXPECT_EXCEPTION(vectorGradientFilter->Update());
+
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
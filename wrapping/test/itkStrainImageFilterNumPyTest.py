@@ -0,0 +1,91 @@
+# ==========================================================================
+#
+#   Copyright NumFOCUS
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#          https://www.apache.org/licenses/LICENSE-2.0.txt
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# ==========================================================================
+
+# The strain of a NumPy displacement array is computed without copying the
+# array or the strain tensors.
+
+import gc
+
+import itk
+import numpy as np
+
+Dimension = 3
+PixelType = itk.F
+
+rng = np.random.default_rng(11)
+displacement_array = (rng.random((9, 11, 13, Dimension)) * 0.1).astype(np.float32)
+
+# The VectorImage views the array.
+displacement_image = itk.image_view_from_array(displacement_array, is_vector=True)
+displacement_image.SetSpacing([0.7, 1.0, 1.3])
+assert displacement_image.GetNumberOfComponentsPerPixel() == Dimension
+assert itk.array_view_from_image(displacement_image).ctypes.data == displacement_array.ctypes.data
+
+StrainFilterType = itk.StrainImageFilter[type(displacement_image), PixelType, PixelType]
+
+
+def buffer_address(image):
+    return int(image.GetBufferPointer())
+
+
+# The functional interface accepts the VectorImage, and its filter reads the
+# buffer of the array.  The tensor image is the first output.
+functional_input_addresses = []
+internal_call = StrainFilterType.__internal_call__
+
+
+def recording_internal_call(self):
+    functional_input_addresses.append(buffer_address(self.GetInput()))
+    return internal_call(self)
+
+
+StrainFilterType.__internal_call__ = recording_internal_call
+try:
+    strain_image = itk.strain_image_filter(displacement_image, fused_gradient=True)[0]
+finally:
+    StrainFilterType.__internal_call__ = internal_call
+assert functional_input_addresses == [displacement_array.ctypes.data]
+strain_array = itk.array_view_from_image(strain_image)
+assert strain_array.ctypes.data == buffer_address(strain_image)
+assert strain_array.shape == displacement_array.shape[:-1] + (6,)
+assert strain_array.dtype == np.float32
+
+# The fused gradient reads the buffer of the array, and the views share the
+# buffer of the outputs, also once the filter is gone.
+strain_filter = StrainFilterType.New(displacement_image, fused_gradient=True)
+strain_filter.SetOutputLayout(StrainFilterType.VOIGTIMAGE)
+strain_filter.Update()
+assert buffer_address(strain_filter.GetInput()) == displacement_array.ctypes.data
+voigt_image = strain_filter.GetVoigtOutput()
+voigt_array = itk.array_view_from_image(voigt_image)
+assert voigt_array.ctypes.data == buffer_address(voigt_image)
+assert voigt_array.shape == strain_array.shape
+voigt_values = voigt_array.copy()
+del strain_filter
+gc.collect()
+assert voigt_array.ctypes.data == buffer_address(voigt_image)
+assert np.array_equal(voigt_array, voigt_values)
+
+# xx, yy, zz, yz, xz, xy from the tensors xx, xy, xz, yy, yz, zz.
+assert np.array_equal(voigt_array, strain_array[..., [0, 3, 5, 4, 2, 1]])
+
+# The same strain as with an Image of Vectors.
+VectorImageType = itk.Image[itk.Vector[PixelType, Dimension], Dimension]
+vector_image = itk.cast_image_filter(displacement_image, ttype=[type(displacement_image), VectorImageType])
+expected_image = itk.strain_image_filter(vector_image, fused_gradient=True)[0]
+assert np.allclose(strain_array, itk.array_view_from_image(expected_image), rtol=1e-5, atol=1e-6)